@@ -0,0 +1,272 @@
+/**
+ * Offline baker for the HUD font. Takes a bitmap font laid out as a 16 x 16
+ * ASCII grid (assets/font1.png) and writes a signed distance field atlas for the
+ * printable characters, plus a text file of per-glyph metrics that SdfFont reads.
+ *
+ * Each texel of the atlas holds how far it is from the glyph's edge, 0.5 on the
+ * edge and more inside, so the shader can cut a sharp edge at any scale out of a
+ * bilinear sample. The bitmap's glyphs are white with a black outline, so there
+ * are two fields: the fill in red and the whole shape, outline included, in green.
+ *
+ * There's no TrueType rasteriser in the tree, so the bitmap is the source. The
+ * distances are measured at its resolution, which is plenty at HUD sizes.
+ *
+ * The default paths are the game's, so run it from Lunar_lander/ and commit
+ * what it writes alongside the source bitmap.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+//  CONSTANTS  //
+constexpr int SOURCE_GRID = 16;           // cells across and down the source
+constexpr int FIRST_GLYPH = 32,           // space
+LAST_GLYPH = 126;                         // tilde
+constexpr int GLYPH_COUNT = LAST_GLYPH - FIRST_GLYPH + 1;
+constexpr int ATLAS_COLUMNS = 10;
+
+constexpr int DEFAULT_SPREAD = 4;         // texels either side of the edge the field covers
+constexpr int INK_THRESHOLD = 128;        // alpha, and red for the fill
+
+constexpr const char* DEFAULT_SOURCE = "assets/font1.png";
+constexpr const char* DEFAULT_ATLAS = "assets/font_sdf.tga";
+constexpr const char* DEFAULT_METRICS = "assets/font_sdf.txt";
+
+//  BAKING  //
+struct Options
+{
+    std::string source = DEFAULT_SOURCE;
+    std::string atlas = DEFAULT_ATLAS;
+    std::string metrics = DEFAULT_METRICS;
+    int spread = DEFAULT_SPREAD;
+};
+
+// One source cell as two masks, true where there's ink
+struct GlyphMask
+{
+    int size = 0;
+    std::vector<bool> fill;
+    std::vector<bool> shape;
+
+    bool at(const std::vector<bool>& mask, int x, int y) const
+    {
+        return x >= 0 && y >= 0 && x < size && y < size && mask[y * size + x];
+    }
+};
+
+// Where a glyph ended up and how to place it, all in atlas texels
+struct GlyphMetrics
+{
+    int code;
+    int x, y, width, height;   // rectangle in the atlas, the field's margin included
+    int x_offset, y_offset;    // rectangle's top left from the pen, y down from the top of the line
+    int advance;
+};
+
+// Texel centre to the nearest texel on the other side of the edge, less half a
+// texel so the edge itself sits at 0. Positive inside, clamped to the spread.
+float signed_distance(const GlyphMask& glyph, const std::vector<bool>& mask, int x, int y, int spread)
+{
+    bool inside = glyph.at(mask, x, y);
+    float nearest = (float)(spread + 1);
+
+    for (int dy = -spread - 1; dy <= spread + 1; dy++)
+    {
+        for (int dx = -spread - 1; dx <= spread + 1; dx++)
+        {
+            if (glyph.at(mask, x + dx, y + dy) == inside) continue;
+            nearest = std::min(nearest, sqrtf((float)(dx * dx + dy * dy)));
+        }
+    }
+
+    float distance = std::min(nearest - 0.5f, (float)spread);
+    return inside ? distance : -distance;
+}
+
+unsigned char encode(float distance, int spread)
+{
+    float value = 0.5f + distance / (2.0f * spread);
+    return (unsigned char)std::min(255.0f, std::max(0.0f, value * 255.0f + 0.5f));
+}
+
+// Uncompressed 24-bit TGA, top row first. stb_image reads it back, and it's one fwrite.
+bool write_tga(const std::string& path, int width, int height, const std::vector<unsigned char>& bgr)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+
+    unsigned char header[18] = {};
+    header[2] = 2;                          // true colour, no compression
+    header[12] = (unsigned char)(width & 0xff);
+    header[13] = (unsigned char)(width >> 8);
+    header[14] = (unsigned char)(height & 0xff);
+    header[15] = (unsigned char)(height >> 8);
+    header[16] = 24;
+    header[17] = 0x20;                      // origin at the top left
+
+    bool written = fwrite(header, sizeof(header), 1, file) == 1 && fwrite(bgr.data(), bgr.size(), 1, file) == 1;
+    fclose(file);
+    return written;
+}
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            std::cout << "Missing a value after " << flag << std::endl;
+            return false;
+        }
+
+        if (flag == "--source") options.source = value;
+        else if (flag == "--atlas") options.atlas = value;
+        else if (flag == "--metrics") options.metrics = value;
+        else if (flag == "--spread") options.spread = std::max(1, atoi(value));
+        else
+        {
+            std::cout << "Unknown option " << flag << std::endl;
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cout << "Usage: FontBaker [--source PNG] [--atlas TGA] [--metrics TXT] [--spread N]" << std::endl;
+        return 1;
+    }
+
+    int width, height, components;
+    unsigned char* image = stbi_load(options.source.c_str(), &width, &height, &components, STBI_rgb_alpha);
+    if (image == nullptr || width != height || width % SOURCE_GRID != 0)
+    {
+        std::cout << "Couldn't read " << options.source << " as a square " << SOURCE_GRID << " x " << SOURCE_GRID << " font" << std::endl;
+        if (image != nullptr) stbi_image_free(image);
+        return 1;
+    }
+
+    int cell = width / SOURCE_GRID;
+    int spread = options.spread;
+    int atlas_cell = cell + 2 * spread;
+    int atlas_width = ATLAS_COLUMNS * atlas_cell;
+    int atlas_height = (GLYPH_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS * atlas_cell;
+
+    // Both fields start fully outside
+    std::vector<unsigned char> atlas(atlas_width * atlas_height * 3, 0);
+    std::vector<GlyphMetrics> metrics;
+    int widest_digit = 0;
+
+    for (int code = FIRST_GLYPH; code <= LAST_GLYPH; code++)
+    {
+        GlyphMask glyph;
+        glyph.size = cell;
+        glyph.fill.assign(cell * cell, false);
+        glyph.shape.assign(cell * cell, false);
+
+        int source_x = (code % SOURCE_GRID) * cell;
+        int source_y = (code / SOURCE_GRID) * cell;
+        int min_x = cell, min_y = cell, max_x = -1, max_y = -1;
+
+        for (int y = 0; y < cell; y++)
+        {
+            for (int x = 0; x < cell; x++)
+            {
+                const unsigned char* pixel = image + 4 * ((source_y + y) * width + source_x + x);
+                bool shape = pixel[3] >= INK_THRESHOLD;
+                glyph.shape[y * cell + x] = shape;
+                glyph.fill[y * cell + x] = shape && pixel[0] >= INK_THRESHOLD;
+                if (!shape) continue;
+
+                min_x = std::min(min_x, x);
+                min_y = std::min(min_y, y);
+                max_x = std::max(max_x, x);
+                max_y = std::max(max_y, y);
+            }
+        }
+
+        int index = code - FIRST_GLYPH;
+        int cell_x = (index % ATLAS_COLUMNS) * atlas_cell;
+        int cell_y = (index / ATLAS_COLUMNS) * atlas_cell;
+
+        // Blank glyphs (space) still move the pen, by a third of a cell
+        GlyphMetrics glyph_metrics = { code, cell_x, cell_y, 0, 0, 0, 0, cell / 3 };
+        if (max_x >= 0)
+        {
+            // The ink and a margin of `spread` round it, so the field has room to fall off
+            glyph_metrics.width = max_x - min_x + 1 + 2 * spread;
+            glyph_metrics.height = max_y - min_y + 1 + 2 * spread;
+            glyph_metrics.x_offset = -spread;
+            glyph_metrics.y_offset = min_y - spread;
+            glyph_metrics.advance = max_x - min_x + 1 + cell / 16;
+
+            for (int y = 0; y < glyph_metrics.height; y++)
+            {
+                for (int x = 0; x < glyph_metrics.width; x++)
+                {
+                    int glyph_x = min_x - spread + x;
+                    int glyph_y = min_y - spread + y;
+                    unsigned char* texel = &atlas[3 * ((cell_y + y) * atlas_width + cell_x + x)];
+
+                    // BGR, so the fill lands in red and the shape in green
+                    texel[2] = encode(signed_distance(glyph, glyph.fill, glyph_x, glyph_y, spread), spread);
+                    texel[1] = encode(signed_distance(glyph, glyph.shape, glyph_x, glyph_y, spread), spread);
+                }
+            }
+        }
+
+        if (code >= '0' && code <= '9') widest_digit = std::max(widest_digit, glyph_metrics.advance);
+        metrics.push_back(glyph_metrics);
+    }
+    stbi_image_free(image);
+
+    // Digits all take the widest one's room, so counters don't jiggle as they change
+    for (GlyphMetrics& glyph : metrics)
+    {
+        if (glyph.code < '0' || glyph.code > '9') continue;
+        glyph.x_offset += (widest_digit - glyph.advance) / 2;
+        glyph.advance = widest_digit;
+    }
+
+    if (!write_tga(options.atlas, atlas_width, atlas_height, atlas))
+    {
+        std::cout << "Couldn't write " << options.atlas << std::endl;
+        return 1;
+    }
+
+    std::ofstream file(options.metrics);
+    if (file.fail())
+    {
+        std::cout << "Couldn't write " << options.metrics << std::endl;
+        return 1;
+    }
+
+    file << "# Made by FontBaker from " << options.source << ", rebake rather than edit.\n"
+        << "#   font <atlas> <atlas width> <atlas height> <line height> <spread>\n"
+        << "#   glyph <code> <x> <y> <width> <height> <x offset> <y offset> <advance>\n"
+        << "# All in atlas texels, offsets from the pen at the top of the line.\n\n"
+        << "font " << options.atlas << " " << atlas_width << " " << atlas_height << " " << cell << " " << spread << "\n";
+    for (const GlyphMetrics& glyph : metrics)
+    {
+        file << "glyph " << glyph.code << " " << glyph.x << " " << glyph.y << " " << glyph.width << " " << glyph.height
+            << " " << glyph.x_offset << " " << glyph.y_offset << " " << glyph.advance << "\n";
+    }
+
+    std::cout << "Baked " << metrics.size() << " glyphs into a " << atlas_width << " x " << atlas_height << " atlas" << std::endl;
+    return 0;
+}
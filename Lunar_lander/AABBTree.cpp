@@ -0,0 +1,265 @@
+#include <cmath>
+#include <algorithm>
+#include "AABBTree.h"
+
+AABBTree::AABBTree(int initial_capacity)
+{
+    m_nodes.reserve(initial_capacity);
+}
+
+int AABBTree::allocate_node()
+{
+    if (m_free_list == NULL_NODE)
+    {
+        // Grow the pool and thread the new nodes onto the free list
+        int first = (int)m_nodes.size();
+        int grown = std::max(16, first);
+        m_nodes.resize(first + grown);
+
+        for (int i = first; i < first + grown; i++)
+        {
+            m_nodes[i].parent = i + 1 < first + grown ? i + 1 : NULL_NODE;
+            m_nodes[i].height = -1;
+        }
+        m_free_list = first;
+    }
+
+    int node = m_free_list;
+    m_free_list = m_nodes[node].parent;
+
+    m_nodes[node].parent = NULL_NODE;
+    m_nodes[node].left = NULL_NODE;
+    m_nodes[node].right = NULL_NODE;
+    m_nodes[node].height = 0;
+    m_nodes[node].user_data = nullptr;
+    return node;
+}
+
+void AABBTree::free_node(int node)
+{
+    m_nodes[node].parent = m_free_list;
+    m_nodes[node].height = -1;
+    m_free_list = node;
+}
+
+int AABBTree::create_proxy(const AABB& box, void* user_data)
+{
+    int proxy = allocate_node();
+
+    glm::vec2 margin(AABB_FAT_MARGIN);
+    m_nodes[proxy].box = { box.min - margin, box.max + margin };
+    m_nodes[proxy].user_data = user_data;
+
+    insert_leaf(proxy);
+    m_proxy_count++;
+    return proxy;
+}
+
+void AABBTree::destroy_proxy(int proxy)
+{
+    remove_leaf(proxy);
+    free_node(proxy);
+    m_proxy_count--;
+}
+
+bool AABBTree::move_proxy(int proxy, const AABB& box, glm::vec2 displacement)
+{
+    // Still inside the fat box: nothing to do, which is the common case
+    if (m_nodes[proxy].box.contains(box)) return false;
+
+    remove_leaf(proxy);
+
+    // Fatten, then stretch towards where the body is heading
+    glm::vec2 margin(AABB_FAT_MARGIN);
+    AABB fat = { box.min - margin, box.max + margin };
+
+    glm::vec2 stretch = displacement * AABB_DISPLACEMENT_MULTIPLIER;
+    fat.min += glm::min(stretch, glm::vec2(0.0f));
+    fat.max += glm::max(stretch, glm::vec2(0.0f));
+
+    m_nodes[proxy].box = fat;
+    insert_leaf(proxy);
+    return true;
+}
+
+void AABBTree::shift_origin(glm::vec2 offset)
+{
+    // Free nodes too, it's cheaper than skipping them and their boxes are never read
+    for (Node& node : m_nodes)
+    {
+        node.box.min -= offset;
+        node.box.max -= offset;
+    }
+}
+
+void AABBTree::insert_leaf(int leaf)
+{
+    if (m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down picking whichever child grows the total perimeter the least
+    AABB leaf_box = m_nodes[leaf].box;
+    int index = m_root;
+    while (!m_nodes[index].is_leaf())
+    {
+        const Node& node = m_nodes[index];
+        float area = node.box.perimeter();
+        float combined_area = AABB::merge(node.box, leaf_box).perimeter();
+
+        // Cost of making a new parent here, and the minimum cost pushed down to the children
+        float cost = 2.0f * combined_area;
+        float inheritance_cost = 2.0f * (combined_area - area);
+
+        float child_costs[2];
+        int children[2] = { node.left, node.right };
+        for (int i = 0; i < 2; i++)
+        {
+            const Node& child = m_nodes[children[i]];
+            float merged = AABB::merge(leaf_box, child.box).perimeter();
+            child_costs[i] = child.is_leaf() ? merged + inheritance_cost
+                                             : (merged - child.box.perimeter()) + inheritance_cost;
+        }
+
+        if (cost < child_costs[0] && cost < child_costs[1]) break;
+        index = child_costs[0] < child_costs[1] ? children[0] : children[1];
+    }
+
+    int sibling = index;
+    int old_parent = m_nodes[sibling].parent;
+    int new_parent = allocate_node();
+
+    m_nodes[new_parent].parent = old_parent;
+    m_nodes[new_parent].box = AABB::merge(leaf_box, m_nodes[sibling].box);
+    m_nodes[new_parent].height = m_nodes[sibling].height + 1;
+    m_nodes[new_parent].left = sibling;
+    m_nodes[new_parent].right = leaf;
+    m_nodes[sibling].parent = new_parent;
+    m_nodes[leaf].parent = new_parent;
+
+    if (old_parent == NULL_NODE)
+    {
+        m_root = new_parent;
+    }
+    else if (m_nodes[old_parent].left == sibling)
+    {
+        m_nodes[old_parent].left = new_parent;
+    }
+    else
+    {
+        m_nodes[old_parent].right = new_parent;
+    }
+
+    // Refit (and rebalance) only the path we touched
+    for (index = m_nodes[leaf].parent; index != NULL_NODE; index = m_nodes[index].parent)
+    {
+        index = balance(index);
+
+        Node& node = m_nodes[index];
+        node.height = 1 + std::max(m_nodes[node.left].height, m_nodes[node.right].height);
+        node.box = AABB::merge(m_nodes[node.left].box, m_nodes[node.right].box);
+    }
+}
+
+void AABBTree::remove_leaf(int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    int parent = m_nodes[leaf].parent;
+    int grand_parent = m_nodes[parent].parent;
+    int sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+    if (grand_parent == NULL_NODE)
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        free_node(parent);
+        return;
+    }
+
+    // Splice the sibling into the parent's slot and refit upwards
+    if (m_nodes[grand_parent].left == parent)
+    {
+        m_nodes[grand_parent].left = sibling;
+    }
+    else
+    {
+        m_nodes[grand_parent].right = sibling;
+    }
+    m_nodes[sibling].parent = grand_parent;
+    free_node(parent);
+
+    for (int index = grand_parent; index != NULL_NODE; index = m_nodes[index].parent)
+    {
+        index = balance(index);
+
+        Node& node = m_nodes[index];
+        node.height = 1 + std::max(m_nodes[node.left].height, m_nodes[node.right].height);
+        node.box = AABB::merge(m_nodes[node.left].box, m_nodes[node.right].box);
+    }
+}
+
+int AABBTree::balance(int a)
+{
+    // Single AVL-style rotation when one side is more than one level taller
+    Node& node_a = m_nodes[a];
+    if (node_a.is_leaf() || node_a.height < 2) return a;
+
+    int b = node_a.left;
+    int c = node_a.right;
+    int difference = m_nodes[c].height - m_nodes[b].height;
+
+    if (difference > 1 || difference < -1)
+    {
+        // `up` is the taller child that gets rotated into a's place
+        int up = difference > 1 ? c : b;
+        int down = difference > 1 ? b : c;
+        Node& node_up = m_nodes[up];
+
+        int f = node_up.left;
+        int g = node_up.right;
+
+        node_up.left = a;
+        node_up.parent = node_a.parent;
+        node_a.parent = up;
+
+        if (node_up.parent == NULL_NODE)
+        {
+            m_root = up;
+        }
+        else if (m_nodes[node_up.parent].left == a)
+        {
+            m_nodes[node_up.parent].left = up;
+        }
+        else
+        {
+            m_nodes[node_up.parent].right = up;
+        }
+
+        // The taller grandchild stays with `up`, the other one moves under `a`
+        int keep = m_nodes[f].height > m_nodes[g].height ? f : g;
+        int give = keep == f ? g : f;
+
+        node_up.right = keep;
+        node_a.left = down;
+        node_a.right = give;
+        m_nodes[give].parent = a;
+
+        node_a.box = AABB::merge(m_nodes[down].box, m_nodes[give].box);
+        node_a.height = 1 + std::max(m_nodes[down].height, m_nodes[give].height);
+
+        node_up.box = AABB::merge(node_a.box, m_nodes[keep].box);
+        node_up.height = 1 + std::max(node_a.height, m_nodes[keep].height);
+
+        return up;
+    }
+
+    return a;
+}
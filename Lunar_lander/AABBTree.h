@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include "glm/vec2.hpp"
+#include "glm/common.hpp"
+
+constexpr int NULL_NODE = -1;
+
+// Leaves are stored this much bigger than the body, so small moves don't touch the tree
+constexpr float AABB_FAT_MARGIN = 0.1f;
+// ...and stretched this many frames ahead along the body's displacement
+constexpr float AABB_DISPLACEMENT_MULTIPLIER = 4.0f;
+
+// Plenty for any balanced tree we could fit in memory, so a query never allocates
+constexpr int AABB_TREE_STACK_SIZE = 256;
+
+struct AABB
+{
+    glm::vec2 min;
+    glm::vec2 max;
+
+    bool overlaps(const AABB& other) const
+    {
+        return min.x <= other.max.x && other.min.x <= max.x &&
+               min.y <= other.max.y && other.min.y <= max.y;
+    }
+
+    bool contains(const AABB& other) const
+    {
+        return min.x <= other.min.x && min.y <= other.min.y &&
+               other.max.x <= max.x && other.max.y <= max.y;
+    }
+
+    float perimeter() const { return 2.0f * ((max.x - min.x) + (max.y - min.y)); }
+
+    static AABB merge(const AABB& a, const AABB& b) { return { glm::min(a.min, b.min), glm::max(a.max, b.max) }; }
+};
+
+/**
+ * The node stack a query walks. It starts out on the stack frame and only moves to
+ * the heap if a lopsided tree outgrows that, so nothing below it ever gets skipped.
+ */
+class AABBTreeStack
+{
+private:
+    int m_fixed[AABB_TREE_STACK_SIZE];
+    std::vector<int> m_spill;
+    int* m_items = m_fixed;
+    int m_capacity = AABB_TREE_STACK_SIZE;
+    int m_count = 0;
+
+public:
+    AABBTreeStack() {}
+    AABBTreeStack(const AABBTreeStack&) = delete;
+    AABBTreeStack& operator=(const AABBTreeStack&) = delete;
+
+    void push(int node)
+    {
+        if (m_count == m_capacity)
+        {
+            // The vector keeps what it holds as it grows, it's only the fixed part that needs copying over
+            if (m_items == m_fixed) m_spill.assign(m_fixed, m_fixed + m_count);
+            m_spill.resize(m_capacity * 2);
+            m_items = m_spill.data();
+            m_capacity *= 2;
+        }
+        m_items[m_count++] = node;
+    }
+
+    int pop() { return m_items[--m_count]; }
+    bool empty() const { return m_count == 0; }
+};
+
+/**
+ * Dynamic bounding volume tree (in the style of Box2D's b2DynamicTree).
+ * Leaves hold fat boxes, so static bodies never move in the tree and moving
+ * ones only get re-inserted once they leave their fat box. Nodes live in one
+ * contiguous array with a free list, and queries walk an AABBTreeStack.
+ */
+class AABBTree
+{
+private:
+    struct Node
+    {
+        AABB box;
+        void* user_data;
+        int parent;    // doubles as the next link while the node is on the free list
+        int left;
+        int right;
+        int height;    // 0 for leaves, -1 while free
+
+        bool is_leaf() const { return left == NULL_NODE; }
+    };
+
+    std::vector<Node> m_nodes;
+    int m_root = NULL_NODE;
+    int m_free_list = NULL_NODE;
+    int m_proxy_count = 0;
+
+    int allocate_node();
+    void free_node(int node);
+
+    void insert_leaf(int leaf);
+    void remove_leaf(int leaf);
+    int balance(int node);
+
+public:
+    AABBTree(int initial_capacity = 64);
+
+    int create_proxy(const AABB& box, void* user_data);
+    void destroy_proxy(int proxy);
+
+    // Returns true if the proxy had to be re-inserted
+    bool move_proxy(int proxy, const AABB& box, glm::vec2 displacement);
+
+    // Moves every box by -offset, for when the world's origin moves. The shape of the tree doesn't change.
+    void shift_origin(glm::vec2 offset);
+
+    void* get_user_data(int proxy) const { return m_nodes[proxy].user_data; }
+    const AABB& get_fat_aabb(int proxy) const { return m_nodes[proxy].box; }
+
+    int const get_proxy_count() const { return m_proxy_count; }
+    int const get_height() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+
+    // Calls callback(proxy) for every leaf whose fat box overlaps `box`.
+    // Return false from the callback to stop early.
+    template <typename Callback>
+    void query(const AABB& box, Callback callback) const;
+
+    // Calls callback(proxy, max_fraction) for every leaf whose fat box the segment
+    // origin -> end passes through. The callback returns the new max fraction: 0 stops
+    // the cast, the hit fraction clips it (closest hit), max_fraction leaves it be.
+    template <typename Callback>
+    void raycast(glm::vec2 origin, glm::vec2 end, Callback callback) const;
+};
+
+template <typename Callback>
+void AABBTree::query(const AABB& box, Callback callback) const
+{
+    if (m_root == NULL_NODE) return;
+
+    AABBTreeStack stack;
+    stack.push(m_root);
+
+    while (!stack.empty())
+    {
+        int index = stack.pop();
+        const Node& node = m_nodes[index];
+        if (!node.box.overlaps(box)) continue;
+
+        if (node.is_leaf())
+        {
+            if (!callback(index)) return;
+        }
+        else
+        {
+            stack.push(node.left);
+            stack.push(node.right);
+        }
+    }
+}
+
+template <typename Callback>
+void AABBTree::raycast(glm::vec2 origin, glm::vec2 end, Callback callback) const
+{
+    if (m_root == NULL_NODE) return;
+
+    glm::vec2 direction = end - origin;
+    float max_fraction = 1.0f;
+
+    AABBTreeStack stack;
+    stack.push(m_root);
+
+    while (!stack.empty())
+    {
+        int index = stack.pop();
+        const Node& node = m_nodes[index];
+
+        // Slab test against the node's box for the still-live part of the segment
+        float t_min = 0.0f, t_max = max_fraction;
+        bool missed = false;
+        for (int axis = 0; axis < 2 && !missed; axis++)
+        {
+            if (fabsf(direction[axis]) < 1e-8f)
+            {
+                missed = origin[axis] < node.box.min[axis] || origin[axis] > node.box.max[axis];
+                continue;
+            }
+
+            float inverse = 1.0f / direction[axis];
+            float t1 = (node.box.min[axis] - origin[axis]) * inverse;
+            float t2 = (node.box.max[axis] - origin[axis]) * inverse;
+            if (t1 > t2) { float t = t1; t1 = t2; t2 = t; }
+
+            t_min = fmaxf(t_min, t1);
+            t_max = fminf(t_max, t2);
+            missed = t_min > t_max;
+        }
+        if (missed) continue;
+
+        if (node.is_leaf())
+        {
+            float fraction = callback(index, max_fraction);
+            if (fraction == 0.0f) return;
+            if (fraction > 0.0f && fraction < max_fraction) max_fraction = fraction;
+        }
+        else
+        {
+            stack.push(node.left);
+            stack.push(node.right);
+        }
+    }
+}
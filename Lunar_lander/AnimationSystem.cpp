@@ -0,0 +1,194 @@
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include "AnimationSystem.h"
+
+bool AnimationSystem::load(const char* path)
+{
+    std::ifstream file(path);
+    if (file.fail()) {
+        std::cout << "Error opening animation file:" << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind) || kind[0] == '#') continue;
+
+        if (kind == "sheet")
+        {
+            SpriteSheet sheet;
+            if (!(fields >> sheet.name >> sheet.texture_path >> sheet.cols >> sheet.rows) || sheet.cols <= 0 || sheet.rows <= 0) {
+                std::cout << path << ":" << line_number << ": bad sheet" << std::endl;
+                return false;
+            }
+            m_sheets.push_back(sheet);
+        }
+        else if (kind == "clip")
+        {
+            if (m_sheets.empty()) {
+                std::cout << path << ":" << line_number << ": clip before any sheet" << std::endl;
+                return false;
+            }
+
+            SpriteSheet& sheet = m_sheets.back();
+            AnimationClip clip;
+            std::string name, mode;
+            if (!(fields >> name >> clip.frames_per_second >> mode) || clip.frames_per_second <= 0.0f) {
+                std::cout << path << ":" << line_number << ": bad clip" << std::endl;
+                return false;
+            }
+
+            clip.name = sheet.name + "." + name;
+            clip.sheet = (int)m_sheets.size() - 1;
+            clip.loop = mode == "loop";
+            clip.first_frame = (uint16_t)sheet.frames.size();
+
+            int cell;
+            while (fields >> cell)
+            {
+                if (cell < 0 || cell >= sheet.cols * sheet.rows) {
+                    std::cout << path << ":" << line_number << ": cell " << cell << " is off the sheet" << std::endl;
+                    return false;
+                }
+                sheet.frames.push_back((uint16_t)cell);
+            }
+
+            clip.frame_count = (uint16_t)(sheet.frames.size() - clip.first_frame);
+            if (clip.frame_count == 0) {
+                std::cout << path << ":" << line_number << ": clip has no frames" << std::endl;
+                return false;
+            }
+            m_clips.push_back(clip);
+        }
+        else
+        {
+            std::cout << path << ":" << line_number << ": don't know what a " << kind << " is" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int AnimationSystem::find_sheet(const std::string& name) const
+{
+    for (size_t i = 0; i < m_sheets.size(); i++)
+    {
+        if (m_sheets[i].name == name) return (int)i;
+    }
+    return -1;
+}
+
+int AnimationSystem::find_clip(const std::string& name) const
+{
+    for (size_t i = 0; i < m_clips.size(); i++)
+    {
+        if (m_clips[i].name == name) return (int)i;
+    }
+    return -1;
+}
+
+int AnimationSystem::create_player(int clip)
+{
+    if (clip < 0 || clip >= (int)m_clips.size()) return -1;
+
+    int player;
+    if (!m_free_players.empty())
+    {
+        player = m_free_players.back();
+        m_free_players.pop_back();
+    }
+    else
+    {
+        player = (int)m_players.size();
+        m_players.push_back(AnimationPlayer());
+    }
+
+    m_players[player].clip = NO_CLIP;
+    play(player, clip, true);
+    return player;
+}
+
+void AnimationSystem::destroy_player(int player)
+{
+    m_players[player].clip = NO_CLIP;
+    m_free_players.push_back(player);
+}
+
+void AnimationSystem::play(int player, int clip, bool restart)
+{
+    AnimationPlayer& state = m_players[player];
+    if (state.clip == clip && !restart) return;
+
+    state.clip = (uint16_t)clip;
+    state.time = 0.0f;
+
+    const AnimationClip& definition = m_clips[clip];
+    state.cell = m_sheets[definition.sheet].frames[definition.first_frame];
+}
+
+bool AnimationSystem::is_finished(int player) const
+{
+    const AnimationPlayer& state = m_players[player];
+    const AnimationClip& clip = m_clips[state.clip];
+    return !clip.loop && state.time * clip.frames_per_second >= clip.frame_count;
+}
+
+void AnimationSystem::update(float delta_time)
+{
+    for (AnimationPlayer& state : m_players)
+    {
+        if (state.clip == NO_CLIP) continue;
+
+        const AnimationClip& clip = m_clips[state.clip];
+        state.time += delta_time;
+
+        int frame = (int)(state.time * clip.frames_per_second);
+        if (frame >= clip.frame_count)
+        {
+            if (clip.loop)
+            {
+                // Keep time inside one cycle so it doesn't lose precision over a long session
+                state.time = fmodf(state.time, clip.frame_count / clip.frames_per_second);
+                frame %= clip.frame_count;
+            }
+            else frame = clip.frame_count - 1;
+        }
+
+        state.cell = m_sheets[clip.sheet].frames[clip.first_frame + frame];
+    }
+}
+
+Animator::Animator(AnimationSystem* system, int clip)
+    : m_system(system), m_player(system->create_player(clip))
+{
+}
+
+Animator::Animator(const Animator& other)
+    : m_system(other.m_system),
+    m_player(other.m_player >= 0 ? other.m_system->create_player(other.m_system->get_player(other.m_player).clip) : -1)
+{
+}
+
+Animator& Animator::operator=(const Animator& other)
+{
+    if (this == &other) return *this;
+
+    if (m_player >= 0) m_system->destroy_player(m_player);
+
+    m_system = other.m_system;
+    m_player = other.m_player >= 0 ? m_system->create_player(m_system->get_player(other.m_player).clip) : -1;
+    return *this;
+}
+
+Animator::~Animator()
+{
+    if (m_player >= 0) m_system->destroy_player(m_player);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ShaderProgram.h"
+
+constexpr uint16_t NO_CLIP = 0xFFFF;
+
+// A texture cut into a grid of cells, plus the frame table every clip on it indexes into
+struct SpriteSheet
+{
+    std::string name;
+    std::string texture_path;
+    GLuint texture = 0;
+    int cols = 1, rows = 1;
+    std::vector<uint16_t> frames;   // cell indices, each clip owns a contiguous run
+};
+
+struct AnimationClip
+{
+    std::string name;               // "<sheet>.<clip>"
+    int sheet;
+    uint16_t first_frame, frame_count;
+    float frames_per_second;
+    bool loop;
+};
+
+// All the per-entity playback state there is
+struct AnimationPlayer
+{
+    uint16_t clip;
+    uint16_t cell;                  // output of the last update, what to draw
+    float time;
+};
+
+/**
+ * Sheets and clips come from a data file, and playback state for every animated
+ * thing lives in one packed array here, so advancing all of them is a single pass
+ * over that array no matter how many there are.
+ *
+ * The file is line based:
+ *   sheet <name> <texture> <columns> <rows>
+ *   clip <name> <frames per second> <loop|once> <cell> [<cell> ...]
+ * with each clip belonging to the sheet above it. Cells count left to right, top to bottom.
+ */
+class AnimationSystem
+{
+private:
+    std::vector<SpriteSheet> m_sheets;
+    std::vector<AnimationClip> m_clips;
+    std::vector<AnimationPlayer> m_players;
+    std::vector<int> m_free_players;
+
+public:
+    bool load(const char* path);
+
+    int find_sheet(const std::string& name) const;   // -1 if there's no such sheet
+    int find_clip(const std::string& name) const;    // likewise
+
+    const SpriteSheet& get_sheet(int sheet) const { return m_sheets[sheet]; };
+    void set_sheet_texture(int sheet, GLuint texture) { m_sheets[sheet].texture = texture; };
+
+    int create_player(int clip);
+    void destroy_player(int player);
+
+    // Switches clip, from the start unless it's already playing this one
+    void play(int player, int clip, bool restart = false);
+    bool is_finished(int player) const;
+
+    const AnimationPlayer& get_player(int player) const { return m_players[player]; };
+    const SpriteSheet& get_player_sheet(int player) const { return m_sheets[m_clips[m_players[player].clip].sheet]; };
+
+    void update(float delta_time);
+};
+
+/**
+ * An entity's handle on a player. Copying one starts a fresh player on the same
+ * clip, so copied entities animate on their own instead of sharing a slot.
+ */
+class Animator
+{
+private:
+    AnimationSystem* m_system = nullptr;
+    int m_player = -1;
+
+public:
+    Animator() {}
+    Animator(AnimationSystem* system, int clip);
+    Animator(const Animator& other);
+    Animator& operator=(const Animator& other);
+    ~Animator();
+
+    void play(int clip, bool restart = false) { if (m_player >= 0) m_system->play(m_player, clip, restart); };
+
+    bool const is_valid() const { return m_player >= 0; };
+    const AnimationSystem* get_system() const { return m_system; };
+    int const get_player() const { return m_player; };
+};
@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "Autopilot.h"
+#include "ConvexHull.h"
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LUNAR_USE_SSE2 1
+#endif
+
+namespace
+{
+    constexpr float INITIAL_SIGMA = 0.7f;
+    constexpr float MIN_SIGMA = 0.1f;
+    constexpr float REFIT_SMOOTHING = 0.7f;   // how far the mean moves towards the elites each iteration
+    constexpr float CONTROL_DEADZONE = 1.0f / 3.0f;
+
+    // Costs. A soft landing on the pad only pays for fuel; anything else pays a
+    // flat price for how badly it went plus something for how far off the pad it is.
+    constexpr float CRASH_COST = 1000.0f;
+    constexpr float OFF_PAD_COST = 400.0f;
+    constexpr float UNFINISHED_COST = 200.0f;
+    constexpr float DISTANCE_WEIGHT = 20.0f;
+    constexpr float ALTITUDE_WEIGHT = 10.0f;
+    constexpr float SPEED_WEIGHT = 30.0f;
+    constexpr float FUEL_WEIGHT = 1.0f;
+
+    // xorshift32, one per batch so the threads don't share any state
+    float random_unit(uint32_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Sum of four uniforms, close enough to a normal for exploration and far cheaper than Box-Muller
+    float random_normal(uint32_t& state)
+    {
+        float sum = random_unit(state) + random_unit(state) + random_unit(state) + random_unit(state);
+        return (sum - 2.0f) * 1.7320508f;
+    }
+
+    float landing_cost(const LanderState& state, const LanderState& start, const AutopilotGoal& goal, const PhysicsParams& params)
+    {
+        float landing_speed = sqrtf(state.movement.x * state.movement.x + state.movement.y * state.movement.y) * params.speed;
+        float off_pad = fabsf(state.position.x - goal.pad_x);
+        float fuel_used = start.fuel - state.fuel;
+
+        if (landing_speed > SOFT_LANDING_MAX_SPEED) return CRASH_COST + DISTANCE_WEIGHT * off_pad;
+        if (off_pad > goal.pad_half_width - goal.ship_half_extents.x) return OFF_PAD_COST + DISTANCE_WEIGHT * off_pad;
+        return FUEL_WEIGHT * fuel_used;
+    }
+
+    // Still in the air at the end of the horizon: the closer to the pad, the lower and the slower the better
+    float unfinished_cost(const LanderState& state, const LanderState& start, float ground, const AutopilotGoal& goal, const PhysicsParams& params)
+    {
+        float speed = sqrtf(state.movement.x * state.movement.x + state.movement.y * state.movement.y) * params.speed;
+        float excess_speed = std::max(0.0f, speed - SOFT_LANDING_MAX_SPEED);
+        float altitude = std::max(0.0f, state.position.y - goal.ship_half_extents.y - ground);
+
+        return UNFINISHED_COST + DISTANCE_WEIGHT * fabsf(state.position.x - goal.pad_x) + ALTITUDE_WEIGHT * altitude
+            + SPEED_WEIGHT * excess_speed * excess_speed + FUEL_WEIGHT * (start.fuel - state.fuel);
+    }
+}
+
+float TerrainProfile::height_at(float x) const
+{
+    float t = (x - origin_x) / TERRAIN_PROFILE_SPACING;
+    if (t <= 0.0f) return heights[0];
+    if (t >= TERRAIN_PROFILE_SAMPLES - 1) return heights[TERRAIN_PROFILE_SAMPLES - 1];
+
+    int i = (int)t;
+    return heights[i] + (heights[i + 1] - heights[i]) * (t - i);
+}
+
+void Autopilot::init(ThreadPool* pool, const PhysicsParams& params)
+{
+    m_pool = pool;
+    m_params = params;
+
+    m_samples_x.assign(AUTOPILOT_HORIZON * AUTOPILOT_SAMPLES, 0.0f);
+    m_samples_y.assign(AUTOPILOT_HORIZON * AUTOPILOT_SAMPLES, 0.0f);
+    m_costs.assign(AUTOPILOT_SAMPLES, 0.0f);
+    m_order.assign(AUTOPILOT_SAMPLES, 0);
+
+    reset();
+}
+
+void Autopilot::reset()
+{
+    for (int k = 0; k < AUTOPILOT_HORIZON; k++)
+    {
+        m_mean_x[k] = m_mean_y[k] = 0.0f;
+        m_sigma_x[k] = m_sigma_y[k] = INITIAL_SIGMA;
+    }
+    m_time_since_shift = 0.0f;
+}
+
+void Autopilot::run_batch(void* autopilot, int batch)
+{
+    Autopilot* self = static_cast<Autopilot*>(autopilot);
+
+    // Batch 0 holds the mean and enough samples for the elites, so there's always a plan
+    self->m_batch_skipped[batch] = batch > 0 && std::chrono::steady_clock::now() >= self->m_deadline;
+    if (self->m_batch_skipped[batch])
+    {
+        std::fill(&self->m_costs[batch * AUTOPILOT_BATCH], &self->m_costs[batch * AUTOPILOT_BATCH] + AUTOPILOT_BATCH, INFINITY);
+        return;
+    }
+
+    self->sample_batch(batch);
+    self->rollout_batch(batch);
+}
+
+void Autopilot::sample_batch(int batch)
+{
+    uint32_t random = m_seed * 2654435761u + batch * 40503u + m_iteration * 9176u + 1u;
+    int first = batch * AUTOPILOT_BATCH;
+
+    for (int k = 0; k < AUTOPILOT_HORIZON; k++)
+    {
+        float* xs = &m_samples_x[k * AUTOPILOT_SAMPLES + first];
+        float* ys = &m_samples_y[k * AUTOPILOT_SAMPLES + first];
+
+        for (int i = 0; i < AUTOPILOT_BATCH; i++)
+        {
+            xs[i] = std::min(1.0f, std::max(-1.0f, m_mean_x[k] + m_sigma_x[k] * random_normal(random)));
+            ys[i] = std::min(1.0f, std::max(-1.0f, m_mean_y[k] + m_sigma_y[k] * random_normal(random)));
+        }
+    }
+
+    // Always try the mean as it stands, so an iteration can never lose the plan it started from
+    if (batch == 0)
+    {
+        for (int k = 0; k < AUTOPILOT_HORIZON; k++)
+        {
+            m_samples_x[k * AUTOPILOT_SAMPLES] = m_mean_x[k];
+            m_samples_y[k * AUTOPILOT_SAMPLES] = m_mean_y[k];
+        }
+    }
+}
+
+void Autopilot::rollout_batch(int batch)
+{
+    const PhysicsParams& p = m_params;
+    const float dt = AUTOPILOT_STEP;
+    const float half_height = m_goal.ship_half_extents.y;
+
+    for (int first = batch * AUTOPILOT_BATCH; first < (batch + 1) * AUTOPILOT_BATCH; first += 4)
+    {
+        float px[4], py[4], ground[4];
+        bool done[4] = { false, false, false, false };
+
+#ifdef LUNAR_USE_SSE2
+        // Four rollouts at once, one per lane, mirroring step_lander() exactly
+        __m128 pos_x = _mm_set1_ps(m_start.position.x), pos_y = _mm_set1_ps(m_start.position.y);
+        __m128 mov_x = _mm_set1_ps(m_start.movement.x), mov_y = _mm_set1_ps(m_start.movement.y);
+        __m128 fuel = _mm_set1_ps(m_start.fuel);
+        __m128 alive = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        const __m128 deadzone = _mm_set1_ps(CONTROL_DEADZONE), minus_deadzone = _mm_set1_ps(-CONTROL_DEADZONE);
+        const __m128 side_thrust = _mm_set1_ps(p.side_thrust), up_thrust = _mm_set1_ps(p.up_thrust);
+        const __m128 idle = _mm_set1_ps(p.idle_vertical), gravity_step = _mm_set1_ps(p.gravity * dt);
+        const __m128 dt4 = _mm_set1_ps(dt), speed_dt = _mm_set1_ps(p.speed * dt), decay = _mm_set1_ps(p.acceleration_decay);
+        const __m128 burn = _mm_set1_ps(p.fuel_burn * dt), threshold = _mm_set1_ps(0.01f);
+        const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 highest_ground = _mm_set1_ps(m_highest_ground);
+
+        for (int k = 0; k < AUTOPILOT_HORIZON; k++)
+        {
+            __m128 ux = _mm_loadu_ps(&m_samples_x[k * AUTOPILOT_SAMPLES + first]);
+            __m128 uy = _mm_loadu_ps(&m_samples_y[k * AUTOPILOT_SAMPLES + first]);
+
+            // Snap to keys: -1, 0 or 1 sideways, and W or not
+            __m128 side = _mm_sub_ps(_mm_and_ps(_mm_cmpgt_ps(ux, deadzone), one), _mm_and_ps(_mm_cmplt_ps(ux, minus_deadzone), one));
+            __m128 has_fuel = _mm_cmpgt_ps(fuel, zero);
+            __m128 thrusting = _mm_and_ps(has_fuel, _mm_cmpgt_ps(uy, zero));
+
+            __m128 acc_x = _mm_and_ps(has_fuel, _mm_mul_ps(side, side_thrust));
+            __m128 acc_y = _mm_or_ps(_mm_and_ps(thrusting, up_thrust), _mm_andnot_ps(thrusting, idle));
+            acc_y = _mm_add_ps(acc_y, gravity_step);
+
+            __m128 new_mov_x = _mm_add_ps(mov_x, _mm_mul_ps(acc_x, dt4));
+            __m128 new_mov_y = _mm_add_ps(mov_y, _mm_mul_ps(acc_y, dt4));
+            __m128 new_pos_x = _mm_add_ps(pos_x, _mm_mul_ps(new_mov_x, speed_dt));
+            __m128 new_pos_y = _mm_add_ps(pos_y, _mm_mul_ps(new_mov_y, speed_dt));
+
+            __m128 burning = _mm_or_ps(
+                _mm_cmpgt_ps(_mm_and_ps(_mm_mul_ps(acc_x, decay), abs_mask), threshold),
+                _mm_cmpgt_ps(_mm_and_ps(_mm_mul_ps(acc_y, decay), abs_mask), threshold));
+            __m128 new_fuel = _mm_max_ps(zero, _mm_sub_ps(fuel, _mm_and_ps(_mm_and_ps(burning, has_fuel), burn)));
+
+            // Lanes that have already touched down keep their final state
+            mov_x = _mm_or_ps(_mm_and_ps(alive, new_mov_x), _mm_andnot_ps(alive, mov_x));
+            mov_y = _mm_or_ps(_mm_and_ps(alive, new_mov_y), _mm_andnot_ps(alive, mov_y));
+            pos_x = _mm_or_ps(_mm_and_ps(alive, new_pos_x), _mm_andnot_ps(alive, pos_x));
+            pos_y = _mm_or_ps(_mm_and_ps(alive, new_pos_y), _mm_andnot_ps(alive, pos_y));
+            fuel = _mm_or_ps(_mm_and_ps(alive, new_fuel), _mm_andnot_ps(alive, fuel));
+
+            // Nothing can have touched down while every live lane is above the highest ground
+            __m128 bottom = _mm_sub_ps(pos_y, _mm_set1_ps(half_height));
+            if ((_mm_movemask_ps(_mm_and_ps(alive, _mm_cmple_ps(bottom, highest_ground)))) == 0) continue;
+
+            // The ground lookup is a gather, so that part goes lane by lane
+            _mm_storeu_ps(px, pos_x);
+            _mm_storeu_ps(py, pos_y);
+            for (int lane = 0; lane < 4; lane++) ground[lane] = m_footprint.height_at(px[lane]);
+
+            __m128 touched = _mm_and_ps(alive, _mm_cmple_ps(bottom, _mm_loadu_ps(ground)));
+            int touched_bits = _mm_movemask_ps(touched);
+
+            if (touched_bits != 0)
+            {
+                float mx[4], my[4], f[4];
+                _mm_storeu_ps(mx, mov_x);
+                _mm_storeu_ps(my, mov_y);
+                _mm_storeu_ps(f, fuel);
+
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    if (!(touched_bits & (1 << lane))) continue;
+
+                    LanderState landed = { glm::vec2(px[lane], py[lane]), glm::vec2(mx[lane], my[lane]), glm::vec2(0.0f), f[lane] };
+                    m_costs[first + lane] = landing_cost(landed, m_start, m_goal, p);
+                    done[lane] = true;
+                }
+                alive = _mm_andnot_ps(touched, alive);
+            }
+
+            if (_mm_movemask_ps(alive) == 0) break;
+        }
+
+        float mx[4], my[4], f[4];
+        _mm_storeu_ps(px, pos_x);
+        _mm_storeu_ps(py, pos_y);
+        _mm_storeu_ps(mx, mov_x);
+        _mm_storeu_ps(my, mov_y);
+        _mm_storeu_ps(f, fuel);
+
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (done[lane]) continue;
+
+            LanderState state = { glm::vec2(px[lane], py[lane]), glm::vec2(mx[lane], my[lane]), glm::vec2(0.0f), f[lane] };
+            m_costs[first + lane] = unfinished_cost(state, m_start, m_footprint.height_at(px[lane]), m_goal, p);
+        }
+#else
+        for (int lane = 0; lane < 4; lane++)
+        {
+            LanderState state = m_start;
+            int sample = first + lane;
+
+            for (int k = 0; k < AUTOPILOT_HORIZON && !done[lane]; k++)
+            {
+                float ux = m_samples_x[k * AUTOPILOT_SAMPLES + sample];
+                float uy = m_samples_y[k * AUTOPILOT_SAMPLES + sample];
+
+                LanderControl control;
+                control.x = ux > CONTROL_DEADZONE ? 1 : (ux < -CONTROL_DEADZONE ? -1 : 0);
+                control.up = uy > 0.0f;
+                step_lander(state, control, dt, p);
+
+                ground[lane] = m_footprint.height_at(state.position.x);
+                if (state.position.y - half_height <= ground[lane])
+                {
+                    m_costs[sample] = landing_cost(state, m_start, m_goal, p);
+                    done[lane] = true;
+                }
+            }
+
+            if (!done[lane]) m_costs[sample] = unfinished_cost(state, m_start, m_footprint.height_at(state.position.x), m_goal, p);
+        }
+#endif
+    }
+}
+
+void Autopilot::refit()
+{
+    for (int i = 0; i < AUTOPILOT_SAMPLES; i++) m_order[i] = i;
+
+    const float* costs = m_costs.data();
+    std::partial_sort(m_order.begin(), m_order.begin() + AUTOPILOT_ELITES, m_order.end(),
+        [costs](int a, int b) { return costs[a] < costs[b]; });
+
+    for (int k = 0; k < AUTOPILOT_HORIZON; k++)
+    {
+        const float* xs = &m_samples_x[k * AUTOPILOT_SAMPLES];
+        const float* ys = &m_samples_y[k * AUTOPILOT_SAMPLES];
+
+        float mean_x = 0.0f, mean_y = 0.0f;
+        for (int e = 0; e < AUTOPILOT_ELITES; e++)
+        {
+            mean_x += xs[m_order[e]];
+            mean_y += ys[m_order[e]];
+        }
+        mean_x /= AUTOPILOT_ELITES;
+        mean_y /= AUTOPILOT_ELITES;
+
+        float variance_x = 0.0f, variance_y = 0.0f;
+        for (int e = 0; e < AUTOPILOT_ELITES; e++)
+        {
+            float dx = xs[m_order[e]] - mean_x, dy = ys[m_order[e]] - mean_y;
+            variance_x += dx * dx;
+            variance_y += dy * dy;
+        }
+
+        m_mean_x[k] += (mean_x - m_mean_x[k]) * REFIT_SMOOTHING;
+        m_mean_y[k] += (mean_y - m_mean_y[k]) * REFIT_SMOOTHING;
+        m_sigma_x[k] = std::max(MIN_SIGMA, sqrtf(variance_x / AUTOPILOT_ELITES));
+        m_sigma_y[k] = std::max(MIN_SIGMA, sqrtf(variance_y / AUTOPILOT_ELITES));
+    }
+}
+
+LanderControl Autopilot::plan(const LanderState& state, const TerrainProfile& profile, const AutopilotGoal& goal, float delta_time)
+{
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Slide the plan along by however many whole steps have gone by since the last one
+    m_time_since_shift += delta_time;
+    while (m_time_since_shift >= AUTOPILOT_STEP)
+    {
+        m_time_since_shift -= AUTOPILOT_STEP;
+        for (int k = 0; k + 1 < AUTOPILOT_HORIZON; k++)
+        {
+            m_mean_x[k] = m_mean_x[k + 1];
+            m_mean_y[k] = m_mean_y[k + 1];
+        }
+    }
+
+    // Re-open the search each frame; the refits narrow it again
+    for (int k = 0; k < AUTOPILOT_HORIZON; k++) m_sigma_x[k] = m_sigma_y[k] = INITIAL_SIGMA;
+
+    m_start = state;
+    m_goal = goal;
+    m_seed++;
+
+    // Widen every height to cover the ship's footprint, once, rather than three lookups per rollout step
+    int reach = (int)ceilf(goal.ship_half_extents.x / TERRAIN_PROFILE_SPACING);
+    m_footprint.origin_x = profile.origin_x;
+    m_highest_ground = -INFINITY;
+    for (int i = 0; i < TERRAIN_PROFILE_SAMPLES; i++)
+    {
+        float highest = -INFINITY;
+        for (int j = std::max(0, i - reach); j <= std::min(TERRAIN_PROFILE_SAMPLES - 1, i + reach); j++) highest = std::max(highest, profile.heights[j]);
+
+        m_footprint.heights[i] = highest;
+        m_highest_ground = std::max(m_highest_ground, highest);
+    }
+
+    int best_sample = 0;
+    float elapsed_ms = 0.0f, iteration_ms = 0.0f;
+    m_last_rollouts = 0;
+    m_deadline = start_time + std::chrono::microseconds((int)((AUTOPILOT_BUDGET_MS - AUTOPILOT_HEADROOM_MS) * 1000.0f));
+
+    for (m_iteration = 0; m_iteration < AUTOPILOT_MAX_ITERATIONS; m_iteration++)
+    {
+        // Don't start an iteration that would only get cut short
+        if (m_iteration > 0 && elapsed_ms + iteration_ms > AUTOPILOT_BUDGET_MS - AUTOPILOT_HEADROOM_MS) break;
+
+        m_pool->run(AUTOPILOT_SAMPLES / AUTOPILOT_BATCH, &Autopilot::run_batch, this);
+        refit();
+        best_sample = m_order[0];
+
+        int skipped = (int)std::count(m_batch_skipped, m_batch_skipped + AUTOPILOT_SAMPLES / AUTOPILOT_BATCH, true);
+        m_last_rollouts += AUTOPILOT_SAMPLES - skipped * AUTOPILOT_BATCH;
+
+        float now_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+        iteration_ms = now_ms - elapsed_ms;
+        elapsed_ms = now_ms;
+        if (skipped > 0) break;
+    }
+
+    m_last_plan_ms = elapsed_ms;
+    m_last_cost = m_costs[best_sample];
+
+    // Fly the first step of the best sequence we actually simulated
+    float ux = m_samples_x[best_sample], uy = m_samples_y[best_sample];
+    LanderControl control;
+    control.x = ux > CONTROL_DEADZONE ? 1 : (ux < -CONTROL_DEADZONE ? -1 : 0);
+    control.up = uy > 0.0f;
+    return control;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "glm/vec2.hpp"
+#include "Simulation.h"
+
+class ThreadPool;
+
+// Plans cover AUTOPILOT_HORIZON steps of AUTOPILOT_STEP seconds each
+constexpr int AUTOPILOT_HORIZON = 40;
+constexpr float AUTOPILOT_STEP = 0.1f;
+
+// Candidate control sequences per iteration, handed to the pool in batches.
+// Both are multiples of 4 so the rollouts can run four lanes to a register.
+constexpr int AUTOPILOT_SAMPLES = 1024;
+constexpr int AUTOPILOT_BATCH = 64;
+constexpr int AUTOPILOT_ELITES = 64;        // best samples the next iteration is fitted to
+constexpr int AUTOPILOT_MAX_ITERATIONS = 4;
+static_assert(AUTOPILOT_ELITES <= AUTOPILOT_BATCH, "the first batch alone has to be able to fill the elites");
+constexpr float AUTOPILOT_BUDGET_MS = 2.0f;
+constexpr float AUTOPILOT_HEADROOM_MS = 0.8f; // kept back for the last refit and the odd preempted frame
+
+// Heights under and around the ship, copied out once a frame so the planning
+// threads never have to touch the streamed terrain
+constexpr int TERRAIN_PROFILE_SAMPLES = 512;
+constexpr float TERRAIN_PROFILE_SPACING = 0.1f;
+
+struct TerrainProfile
+{
+    float origin_x;
+    float heights[TERRAIN_PROFILE_SAMPLES];
+
+    float height_at(float x) const;
+};
+
+// Where to put the ship down, and how big the ship is
+struct AutopilotGoal
+{
+    float pad_x;
+    float pad_half_width;
+    glm::vec2 ship_half_extents;
+};
+
+/**
+ * A sampling-based model-predictive controller. Every frame it rolls out
+ * AUTOPILOT_SAMPLES noisy control sequences on the headless flight model, keeps
+ * the cheapest few, refits the sampling distribution to them (the cross-entropy
+ * method), and repeats while there's time left in the budget. The first step of
+ * the best sequence is what gets flown, and the rest warm-starts the next frame.
+ *
+ * Cheap means landing softly on the target pad with as much fuel left as possible.
+ */
+class Autopilot
+{
+private:
+    PhysicsParams m_params;
+    ThreadPool* m_pool = nullptr;
+
+    // Sampling distribution per step, over a continuous control in [-1, 1]^2 that
+    // gets snapped to the keys: x below -1/3 is A, above 1/3 is D, y above 0 is W
+    float m_mean_x[AUTOPILOT_HORIZON], m_mean_y[AUTOPILOT_HORIZON];
+    float m_sigma_x[AUTOPILOT_HORIZON], m_sigma_y[AUTOPILOT_HORIZON];
+    float m_time_since_shift = 0.0f;
+
+    // [step * AUTOPILOT_SAMPLES + sample], so four samples at the same step sit side by side
+    std::vector<float> m_samples_x, m_samples_y;
+    std::vector<float> m_costs;
+    std::vector<int> m_order;
+
+    // Batches that start after the deadline skip their rollouts and cost infinity,
+    // so a plan stops on time even in its first iteration. Batch 0 always runs.
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_batch_skipped[AUTOPILOT_SAMPLES / AUTOPILOT_BATCH];
+
+    // What the current plan is working from, read by every batch
+    LanderState m_start;
+    AutopilotGoal m_goal;
+
+    // The profile with each height replaced by the highest point under the ship's
+    // width there, so a rollout only needs one lookup per step to test for touchdown
+    TerrainProfile m_footprint;
+    float m_highest_ground = 0.0f;
+    uint32_t m_seed = 1;
+    int m_iteration = 0;
+
+    float m_last_plan_ms = 0.0f;
+    int m_last_rollouts = 0;
+    float m_last_cost = 0.0f;
+
+    static void run_batch(void* autopilot, int batch);
+    void sample_batch(int batch);
+    void rollout_batch(int batch);
+    void refit();
+
+public:
+    void init(ThreadPool* pool, const PhysicsParams& params);
+    void reset();
+
+    // Call once a frame with however long the frame was, so the plan can slide along with time
+    LanderControl plan(const LanderState& state, const TerrainProfile& profile, const AutopilotGoal& goal, float delta_time);
+
+    void set_params(const PhysicsParams& params) { m_params = params; };
+
+    float const get_last_plan_ms()  const { return m_last_plan_ms;  };
+    int   const get_last_rollouts() const { return m_last_rollouts; };
+    float const get_last_cost()     const { return m_last_cost;     };
+};
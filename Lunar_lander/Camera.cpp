@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <cmath>
+#include "glm/geometric.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "Camera.h"
+
+void Camera::follow(glm::vec2 position, glm::vec2 velocity)
+{
+    m_target = position + velocity * CAMERA_LOOK_AHEAD;
+
+    float t = std::min(1.0f, glm::length(velocity) / CAMERA_ZOOM_OUT_SPEED);
+    m_target_zoom = CAMERA_MAX_ZOOM + (CAMERA_MIN_ZOOM - CAMERA_MAX_ZOOM) * t;
+}
+
+void Camera::snap()
+{
+    m_position = m_target;
+    m_zoom = m_target_zoom;
+    update(0.0f);
+}
+
+void Camera::shift_origin(glm::vec2 offset)
+{
+    m_position -= offset;
+    m_target -= offset;
+    update(0.0f);
+}
+
+void Camera::update(float delta_time)
+{
+    // Exponential easing, so the feel doesn't change with the frame rate
+    m_position += (m_target - m_position) * (1.0f - expf(-CAMERA_FOLLOW_RATE * delta_time));
+    m_zoom += (m_target_zoom - m_zoom) * (1.0f - expf(-CAMERA_ZOOM_RATE * delta_time));
+
+    m_view_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(m_zoom, m_zoom, 1.0f));
+    m_view_matrix = glm::translate(m_view_matrix, glm::vec3(-m_position, 0.0f));
+}
+
+AABB Camera::get_view_bounds(float margin) const
+{
+    glm::vec2 half = m_half_extents / m_zoom + glm::vec2(margin);
+    return { m_position - half, m_position + half };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "glm/vec2.hpp"
+#include "glm/mat4x4.hpp"
+#include "AABBTree.h"
+
+// How quickly the camera closes the gap to its target, per second. Higher is snappier.
+constexpr float CAMERA_FOLLOW_RATE = 4.0f;
+constexpr float CAMERA_ZOOM_RATE = 1.5f;
+
+// Seconds of the ship's velocity to look ahead by, so there's more screen in the direction of travel
+constexpr float CAMERA_LOOK_AHEAD = 0.3f;
+
+// Zoomed in at rest, pulled back out as the ship speeds up
+constexpr float CAMERA_MAX_ZOOM = 1.0f;
+constexpr float CAMERA_MIN_ZOOM = 0.6f;
+constexpr float CAMERA_ZOOM_OUT_SPEED = 4.0f;
+
+/**
+ * A 2D camera that eases towards whatever it's told to follow. The projection
+ * stays fixed; the camera only owns the view matrix, and the world-space rectangle
+ * that view covers, which is what everything else culls against.
+ */
+class Camera
+{
+private:
+    glm::vec2 m_position = glm::vec2(0.0f);
+    glm::vec2 m_target = glm::vec2(0.0f);
+    float m_zoom = CAMERA_MAX_ZOOM;
+    float m_target_zoom = CAMERA_MAX_ZOOM;
+
+    glm::vec2 m_half_extents;   // of the projection, before zoom
+
+    glm::mat4 m_view_matrix = glm::mat4(1.0f);
+
+public:
+    Camera(float half_width, float half_height) : m_half_extents(half_width, half_height) {}
+
+    // Aims at `position`, leading it a little along `velocity`, and picks a zoom from the speed
+    void follow(glm::vec2 position, glm::vec2 velocity);
+
+    // Jumps straight to the target, for the first frame or after a teleport
+    void snap();
+
+    void update(float delta_time);
+
+    // Moves the camera by -offset along with the world when its origin moves, so nothing on screen jumps
+    void shift_origin(glm::vec2 offset);
+
+    // The visible world rectangle, with `margin` world units of slack on every side
+    AABB get_view_bounds(float margin = 0.0f) const;
+
+    // For when the projection changes size
+    void set_half_extents(float half_width, float half_height) { m_half_extents = glm::vec2(half_width, half_height); };
+
+    glm::mat4 const get_view_matrix() const { return m_view_matrix; };
+    glm::vec2 const get_position()    const { return m_position;    };
+    float     const get_zoom()        const { return m_zoom;        };
+};
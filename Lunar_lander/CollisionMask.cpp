@@ -0,0 +1,110 @@
+#include <cmath>
+#include "CollisionMask.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LUNAR_USE_SSE2 1
+#endif
+
+void CollisionMask::build(const unsigned char* rgba, int width, int height, unsigned char alpha_threshold)
+{
+    m_width = width;
+    m_height = height;
+    m_words_per_row = (width + 63) / 64;
+    m_bits.assign((size_t)m_words_per_row * height, 0ull);
+
+    for (int y = 0; y < height; y++)
+    {
+        uint64_t* row = m_bits.data() + y * m_words_per_row;
+        const unsigned char* texel = rgba + (size_t)y * width * 4;
+
+        for (int x = 0; x < width; x++)
+        {
+            // Alpha is the 4th channel since the texture is always decoded as RGBA
+            if (texel[x * 4 + 3] >= alpha_threshold) row[x >> 6] |= 1ull << (x & 63);
+        }
+    }
+}
+
+namespace
+{
+    // Resamples the part of `mask` inside the overlap rectangle onto the
+    // narrowphase grid, so that each grid row ends up in a single word
+    void rasterise_overlap(const CollisionMask& mask, glm::vec3 position, glm::vec3 scale,
+        float left, float top, float cell_width, float cell_height, uint64_t* rows)
+    {
+        float sprite_left = position.x - scale.x / 2.0f;
+        float sprite_top = position.y + scale.y / 2.0f;
+
+        // The column -> texel mapping is the same for every row, so do it once
+        int columns[NARROWPHASE_RESOLUTION];
+        for (int c = 0; c < NARROWPHASE_RESOLUTION; c++)
+        {
+            float u = (left + (c + 0.5f) * cell_width - sprite_left) / scale.x;
+            int texel_x = (int)(u * mask.get_width());
+            if (texel_x < 0) texel_x = 0;
+            if (texel_x >= mask.get_width()) texel_x = mask.get_width() - 1;
+            columns[c] = texel_x;
+        }
+
+        for (int r = 0; r < NARROWPHASE_RESOLUTION; r++)
+        {
+            float v = (sprite_top - (top - (r + 0.5f) * cell_height)) / scale.y;
+            int texel_y = (int)(v * mask.get_height());
+            if (texel_y < 0) texel_y = 0;
+            if (texel_y >= mask.get_height()) texel_y = mask.get_height() - 1;
+
+            const uint64_t* source = mask.get_row(texel_y);
+            uint64_t word = 0ull;
+            for (int c = 0; c < NARROWPHASE_RESOLUTION; c++)
+            {
+                int texel_x = columns[c];
+                word |= ((source[texel_x >> 6] >> (texel_x & 63)) & 1ull) << c;
+            }
+            rows[r] = word;
+        }
+    }
+}
+
+bool masks_overlap(const CollisionMask& mask_a, glm::vec3 position_a, glm::vec3 scale_a,
+    const CollisionMask& mask_b, glm::vec3 position_b, glm::vec3 scale_b)
+{
+    // Without a mask on both sides there is nothing finer to test than the box
+    if (mask_a.is_empty() || mask_b.is_empty()) return true;
+
+    float left   = fmaxf(position_a.x - scale_a.x / 2.0f, position_b.x - scale_b.x / 2.0f);
+    float right  = fminf(position_a.x + scale_a.x / 2.0f, position_b.x + scale_b.x / 2.0f);
+    float bottom = fmaxf(position_a.y - scale_a.y / 2.0f, position_b.y - scale_b.y / 2.0f);
+    float top    = fminf(position_a.y + scale_a.y / 2.0f, position_b.y + scale_b.y / 2.0f);
+
+    if (right <= left || top <= bottom) return false;
+
+    float cell_width = (right - left) / NARROWPHASE_RESOLUTION;
+    float cell_height = (top - bottom) / NARROWPHASE_RESOLUTION;
+
+    alignas(16) uint64_t rows_a[NARROWPHASE_RESOLUTION];
+    alignas(16) uint64_t rows_b[NARROWPHASE_RESOLUTION];
+
+    rasterise_overlap(mask_a, position_a, scale_a, left, top, cell_width, cell_height, rows_a);
+    rasterise_overlap(mask_b, position_b, scale_b, left, top, cell_width, cell_height, rows_b);
+
+#ifdef LUNAR_USE_SSE2
+    // Two rows per AND, bail out on the first pair that shares a solid texel
+    const __m128i zero = _mm_setzero_si128();
+    for (int r = 0; r < NARROWPHASE_RESOLUTION; r += 2)
+    {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(rows_a + r));
+        __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(rows_b + r));
+        __m128i both = _mm_and_si128(a, b);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(both, zero)) != 0xFFFF) return true;
+    }
+#else
+    for (int r = 0; r < NARROWPHASE_RESOLUTION; r++)
+    {
+        if (rows_a[r] & rows_b[r]) return true;
+    }
+#endif
+
+    return false;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "glm/vec3.hpp"
+
+// Any texel at or above this alpha counts as solid
+constexpr unsigned char MASK_ALPHA_THRESHOLD = 128;
+
+// Both sprites are resampled onto a NARROWPHASE_RESOLUTION x 64 grid over their
+// overlap, so that every row of the test is exactly one 64-bit word
+constexpr int NARROWPHASE_RESOLUTION = 64;
+
+/**
+ * 1-bit alpha mask of a sprite, built once when its texture is loaded.
+ * Each row is packed into 64-bit words, texel x lives in bit (x % 64) of
+ * word (x / 64). Row 0 is the top of the image, same as stb_image gives it to us.
+ */
+class CollisionMask
+{
+private:
+    int m_width = 0;
+    int m_height = 0;
+    int m_words_per_row = 0;
+    std::vector<uint64_t> m_bits;
+
+public:
+    void build(const unsigned char* rgba, int width, int height,
+        unsigned char alpha_threshold = MASK_ALPHA_THRESHOLD);
+
+    bool is_solid(int x, int y) const
+    {
+        return (m_bits[y * m_words_per_row + (x >> 6)] >> (x & 63)) & 1ull;
+    }
+
+    bool const is_empty() const { return m_bits.empty(); }
+    int const get_width() const { return m_width; }
+    int const get_height() const { return m_height; }
+    const uint64_t* get_row(int y) const { return m_bits.data() + y * m_words_per_row; }
+};
+
+// Exact test between two axis-aligned sprites centred at `position` and spanning
+// `scale` world units. Only meant to be called once their boxes already overlap.
+bool masks_overlap(const CollisionMask& mask_a, glm::vec3 position_a, glm::vec3 scale_a,
+    const CollisionMask& mask_b, glm::vec3 position_b, glm::vec3 scale_b);
@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "Config.h"
+
+namespace
+{
+    bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    // Narrows [begin, end) down past any whitespace at either end
+    void trim(char*& begin, char*& end)
+    {
+        while (begin < end && is_space(*begin)) begin++;
+        while (end > begin && is_space(end[-1])) end--;
+    }
+}
+
+void Config::bind(const char* name, BindingType type, void* value)
+{
+    if (m_binding_count == MAX_CONFIG_BINDINGS)
+    {
+        std::cout << "Config: no room to bind " << name << ", raise MAX_CONFIG_BINDINGS" << std::endl;
+        return;
+    }
+
+    m_bindings[m_binding_count++] = { name, type, value };
+}
+
+const Config::Binding* Config::find(const char* section, int section_length, const char* key, int key_length) const
+{
+    for (int i = 0; i < m_binding_count; i++)
+    {
+        const char* name = m_bindings[i].name;
+        if (strncmp(name, section, section_length) != 0 || name[section_length] != '.') continue;
+
+        const char* name_key = name + section_length + 1;
+        if (strncmp(name_key, key, key_length) == 0 && name_key[key_length] == '\0') return &m_bindings[i];
+    }
+    return nullptr;
+}
+
+bool Config::load(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        std::cout << "Config: couldn't open " << path << std::endl;
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // One extra for the terminator the last line needs
+    m_text.resize(size + 1);
+    size_t read = fread(m_text.data(), 1, size, file);
+    fclose(file);
+    m_text[read] = '\0';
+
+    char* section = nullptr;
+    int section_length = 0;
+    int line_number = 0;
+
+    char* cursor = m_text.data();
+    char* text_end = cursor + read;
+    while (cursor < text_end)
+    {
+        char* line = cursor;
+        char* line_end = (char*)memchr(cursor, '\n', text_end - cursor);
+        if (line_end == nullptr) line_end = text_end;
+        cursor = line_end + 1;
+        line_number++;
+
+        // Comments run to the end of the line
+        for (char* c = line; c < line_end; c++)
+        {
+            if (*c == ';' || *c == '#') { line_end = c; break; }
+        }
+
+        trim(line, line_end);
+        if (line == line_end) continue;
+
+        if (*line == '[')
+        {
+            if (line_end[-1] != ']')
+            {
+                std::cout << path << ":" << line_number << ": section is missing its ]" << std::endl;
+                continue;
+            }
+
+            section = line + 1;
+            section_length = (int)(line_end - 1 - section);
+            continue;
+        }
+
+        char* equals = (char*)memchr(line, '=', line_end - line);
+        if (equals == nullptr || section == nullptr)
+        {
+            std::cout << path << ":" << line_number << ": expected key = value inside a [section]" << std::endl;
+            continue;
+        }
+
+        char* key = line;
+        char* key_end = equals;
+        char* value = equals + 1;
+        char* value_end = line_end;
+        trim(key, key_end);
+        trim(value, value_end);
+
+        const Binding* binding = find(section, section_length, key, (int)(key_end - key));
+        if (binding == nullptr)
+        {
+            std::cout << path << ":" << line_number << ": nothing called " << std::string(key, key_end) << " in [" << std::string(section, section_length) << "]" << std::endl;
+            continue;
+        }
+
+        // Parse in place; the buffer is ours, so the value can be terminated right where it ends
+        *value_end = '\0';
+        char* parsed_end = nullptr;
+        if (binding->type == FLOAT)
+        {
+            float parsed = strtof(value, &parsed_end);
+            if (parsed_end == value_end && value != value_end) *static_cast<float*>(binding->value) = parsed;
+        }
+        else
+        {
+            long parsed = strtol(value, &parsed_end, 10);
+            if (parsed_end == value_end && value != value_end) *static_cast<int*>(binding->value) = (int)parsed;
+        }
+
+        if (parsed_end != value_end || value == value_end)
+        {
+            std::cout << path << ":" << line_number << ": " << binding->name << " isn't a number" << std::endl;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+constexpr int MAX_CONFIG_BINDINGS = 64;
+
+/**
+ * INI-style settings, read straight into the variables they tune. Each setting is
+ * bound once to the variable it lives in, by "section.key"; load() then parses
+ * the whole file in place and writes every value it recognises through its
+ * binding. Anything missing from the file keeps whatever it had, so the file
+ * only needs the values that differ from the defaults.
+ *
+ *     ; comment
+ *     [physics]
+ *     gravity = -0.5
+ *
+ * The text buffer is kept between loads and the bindings are a fixed array, so
+ * reloading after the first load doesn't touch the heap unless the file grows.
+ */
+class Config
+{
+private:
+    enum BindingType { FLOAT, INT };
+
+    struct Binding
+    {
+        const char* name;   // "section.key", not copied, so keep it to string literals
+        BindingType type;
+        void* value;
+    };
+
+    Binding m_bindings[MAX_CONFIG_BINDINGS];
+    int m_binding_count = 0;
+
+    std::vector<char> m_text;
+
+    void bind(const char* name, BindingType type, void* value);
+    const Binding* find(const char* section, int section_length, const char* key, int key_length) const;
+
+public:
+    void bind(const char* name, float* value) { bind(name, FLOAT, value); };
+    void bind(const char* name, int* value)   { bind(name, INT, value);   };
+
+    // Returns false if the file couldn't be read, in which case nothing is changed.
+    // Lines that don't parse are reported and skipped, the rest still apply.
+    bool load(const char* path);
+};
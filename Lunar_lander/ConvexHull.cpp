@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "glm/geometric.hpp"
+#include "ConvexHull.h"
+#include "CollisionMask.h"
+
+namespace
+{
+    float cross(glm::vec2 o, glm::vec2 a, glm::vec2 b)
+    {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    }
+
+    // World-space copy of a hull along with its outward edge normals
+    struct WorldPolygon
+    {
+        glm::vec2 vertices[MAX_HULL_VERTICES];
+        glm::vec2 normals[MAX_HULL_VERTICES];
+        int count;
+    };
+
+    void to_world(const ConvexHull& hull, const HullTransform& transform, WorldPolygon& polygon)
+    {
+        polygon.count = hull.vertex_count;
+        hull.to_world(transform, polygon.vertices);
+
+        for (int i = 0; i < polygon.count; i++)
+        {
+            glm::vec2 edge = polygon.vertices[(i + 1) % polygon.count] - polygon.vertices[i];
+            polygon.normals[i] = glm::normalize(glm::vec2(edge.y, -edge.x));
+        }
+    }
+
+    // Largest distance between any face of `a` and the deepest vertex of `b` behind it
+    float max_separation(const WorldPolygon& a, const WorldPolygon& b, int& best_edge)
+    {
+        float best = -INFINITY;
+        best_edge = 0;
+
+        for (int i = 0; i < a.count; i++)
+        {
+            float deepest = INFINITY;
+            for (int j = 0; j < b.count; j++)
+            {
+                deepest = std::min(deepest, glm::dot(a.normals[i], b.vertices[j] - a.vertices[i]));
+            }
+
+            if (deepest > best)
+            {
+                best = deepest;
+                best_edge = i;
+            }
+        }
+
+        return best;
+    }
+
+    // Keeps the part of the segment on the negative side of the plane
+    int clip_segment(const glm::vec2 in[2], glm::vec2 out[2], glm::vec2 normal, float offset)
+    {
+        int count = 0;
+        float d0 = glm::dot(normal, in[0]) - offset;
+        float d1 = glm::dot(normal, in[1]) - offset;
+
+        if (d0 <= 0.0f) out[count++] = in[0];
+        if (d1 <= 0.0f) out[count++] = in[1];
+
+        if (d0 * d1 < 0.0f && count < 2)
+        {
+            float t = d0 / (d0 - d1);
+            out[count++] = in[0] + t * (in[1] - in[0]);
+        }
+
+        return count;
+    }
+}
+
+ConvexHull ConvexHull::unit_box()
+{
+    ConvexHull hull;
+    hull.vertices[0] = glm::vec2(-0.5f, -0.5f);
+    hull.vertices[1] = glm::vec2( 0.5f, -0.5f);
+    hull.vertices[2] = glm::vec2( 0.5f,  0.5f);
+    hull.vertices[3] = glm::vec2(-0.5f,  0.5f);
+    hull.vertex_count = 4;
+    return hull;
+}
+
+void ConvexHull::to_world(const HullTransform& transform, glm::vec2* out) const
+{
+    float c = cosf(transform.rotation);
+    float s = sinf(transform.rotation);
+
+    for (int i = 0; i < vertex_count; i++)
+    {
+        glm::vec2 local = vertices[i] * transform.scale;
+        out[i] = transform.position + glm::vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+    }
+}
+
+void ConvexHull::build_from_mask(const CollisionMask& mask, int max_vertices)
+{
+    *this = unit_box();
+    if (mask.is_empty()) return;
+
+    float texel_width = 1.0f / mask.get_width();
+    float texel_height = 1.0f / mask.get_height();
+
+    // Only the outermost solid texel of each row can be on the hull, so take
+    // the outer corners of those. This runs once at load, so the vector is fine.
+    std::vector<glm::vec2> points;
+    for (int y = 0; y < mask.get_height(); y++)
+    {
+        int first = -1, last = -1;
+        for (int x = 0; x < mask.get_width(); x++)
+        {
+            if (!mask.is_solid(x, y)) continue;
+            if (first < 0) first = x;
+            last = x;
+        }
+        if (first < 0) continue;
+
+        // Texel rows run top to bottom, local y runs bottom to top
+        float top = 0.5f - y * texel_height;
+        float bottom = top - texel_height;
+        float left = first * texel_width - 0.5f;
+        float right = (last + 1) * texel_width - 0.5f;
+
+        points.insert(points.end(), {
+            glm::vec2(left, top), glm::vec2(left, bottom),
+            glm::vec2(right, top), glm::vec2(right, bottom)
+            });
+    }
+    if (points.size() < 3) return;
+
+    // Andrew's monotone chain, gives us the hull counter-clockwise
+    std::sort(points.begin(), points.end(), [](glm::vec2 a, glm::vec2 b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+
+    std::vector<glm::vec2> hull(points.size() * 2);
+    int k = 0;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.0f) k--;
+        hull[k++] = points[i];
+    }
+    for (int i = (int)points.size() - 2, lower = k + 1; i >= 0; i--)
+    {
+        while (k >= lower && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.0f) k--;
+        hull[k++] = points[i];
+    }
+    hull.resize(k - 1);
+
+    // Drop the vertex that contributes the least area until we fit
+    if (max_vertices > MAX_HULL_VERTICES) max_vertices = MAX_HULL_VERTICES;
+    while ((int)hull.size() > max_vertices)
+    {
+        size_t smallest = 0;
+        float smallest_area = INFINITY;
+        for (size_t i = 0; i < hull.size(); i++)
+        {
+            glm::vec2 prev = hull[(i + hull.size() - 1) % hull.size()];
+            glm::vec2 next = hull[(i + 1) % hull.size()];
+            float area = fabsf(cross(prev, hull[i], next));
+            if (area < smallest_area)
+            {
+                smallest_area = area;
+                smallest = i;
+            }
+        }
+        hull.erase(hull.begin() + smallest);
+    }
+
+    vertex_count = (int)hull.size();
+    std::copy(hull.begin(), hull.end(), vertices);
+}
+
+bool ContactManifold::is_soft_landing() const
+{
+    return normal.y >= SOFT_LANDING_MIN_NORMAL_Y && glm::length(relative_velocity) <= SOFT_LANDING_MAX_SPEED;
+}
+
+bool collide_hulls(const ConvexHull& hull_a, const HullTransform& transform_a,
+    const ConvexHull& hull_b, const HullTransform& transform_b, ContactManifold& manifold)
+{
+    WorldPolygon a, b;
+    to_world(hull_a, transform_a, a);
+    to_world(hull_b, transform_b, b);
+
+    int edge_a, edge_b;
+    float separation_a = max_separation(a, b, edge_a);
+    if (separation_a > 0.0f) return false;
+
+    float separation_b = max_separation(b, a, edge_b);
+    if (separation_b > 0.0f) return false;
+
+    // Prefer A as the reference face unless B is clearly better, so that the
+    // normal doesn't flicker between two nearly equal faces from frame to frame
+    constexpr float REFERENCE_FACE_TOLERANCE = 0.0005f;
+    bool flip = separation_b > separation_a + REFERENCE_FACE_TOLERANCE;
+
+    const WorldPolygon& reference = flip ? b : a;
+    const WorldPolygon& incident = flip ? a : b;
+    int reference_edge = flip ? edge_b : edge_a;
+
+    // The incident edge is the one most anti-parallel to the reference face
+    glm::vec2 reference_normal = reference.normals[reference_edge];
+    int incident_edge = 0;
+    float most_opposed = INFINITY;
+    for (int i = 0; i < incident.count; i++)
+    {
+        float d = glm::dot(reference_normal, incident.normals[i]);
+        if (d < most_opposed)
+        {
+            most_opposed = d;
+            incident_edge = i;
+        }
+    }
+
+    glm::vec2 incident_segment[2] = {
+        incident.vertices[incident_edge],
+        incident.vertices[(incident_edge + 1) % incident.count]
+    };
+
+    glm::vec2 v1 = reference.vertices[reference_edge];
+    glm::vec2 v2 = reference.vertices[(reference_edge + 1) % reference.count];
+    glm::vec2 tangent = glm::normalize(v2 - v1);
+
+    // Trim the incident edge to the width of the reference face
+    glm::vec2 clipped_once[2], clipped[2];
+    if (clip_segment(incident_segment, clipped_once, -tangent, -glm::dot(tangent, v1)) < 2) return false;
+    if (clip_segment(clipped_once, clipped, tangent, glm::dot(tangent, v2)) < 2) return false;
+
+    float front = glm::dot(reference_normal, v1);
+
+    manifold.point_count = 0;
+    manifold.penetration = 0.0f;
+    for (int i = 0; i < 2; i++)
+    {
+        float separation = glm::dot(reference_normal, clipped[i]) - front;
+        if (separation > 0.0f) continue;
+
+        manifold.points[manifold.point_count++] = clipped[i];
+        manifold.penetration = std::max(manifold.penetration, -separation);
+    }
+    if (manifold.point_count == 0) return false;
+
+    // The reference normal points out of whichever hull owns it, flip it so it always pushes A out of B
+    manifold.normal = flip ? reference_normal : -reference_normal;
+    return true;
+}
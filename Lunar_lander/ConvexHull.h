@@ -0,0 +1,56 @@
+#pragma once
+
+#include "glm/vec2.hpp"
+
+class CollisionMask;
+
+// Fixed upper bounds so that hulls and manifolds never touch the heap
+constexpr int MAX_HULL_VERTICES = 16;
+constexpr int MAX_CONTACT_POINTS = 2;
+
+// A contact counts as a landing (rather than a crash) if the surface faces up
+// at least this much and the ship hits it slower than this
+constexpr float SOFT_LANDING_MIN_NORMAL_Y = 0.7f;
+constexpr float SOFT_LANDING_MAX_SPEED = 1.0f;
+
+// Where a hull sits in the world: same position/scale/rotation an Entity draws with
+struct HullTransform
+{
+    glm::vec2 position;
+    glm::vec2 scale;
+    float rotation;
+};
+
+/**
+ * Convex outline of a sprite in its local space, where the quad spans
+ * [-0.5, 0.5] on both axes. Vertices are stored counter-clockwise.
+ */
+struct ConvexHull
+{
+    glm::vec2 vertices[MAX_HULL_VERTICES];
+    int vertex_count = 0;
+
+    // The whole quad, used for anything that has no hull of its own
+    static ConvexHull unit_box();
+
+    // Wraps the solid texels of `mask` and simplifies the result down to `max_vertices`
+    void build_from_mask(const CollisionMask& mask, int max_vertices = MAX_HULL_VERTICES);
+
+    // Writes vertex_count world-space vertices into `out`
+    void to_world(const HullTransform& transform, glm::vec2* out) const;
+};
+
+struct ContactManifold
+{
+    glm::vec2 normal;            // unit, from B towards A, i.e. the way A gets pushed out
+    float penetration = 0.0f;    // deepest point, along the normal
+    glm::vec2 points[MAX_CONTACT_POINTS];
+    int point_count = 0;
+    glm::vec2 relative_velocity; // velocity of A minus velocity of B
+
+    bool is_soft_landing() const;
+};
+
+// Separating-axis test between two hulls, filling in `manifold` when they touch
+bool collide_hulls(const ConvexHull& hull_a, const HullTransform& transform_a,
+    const ConvexHull& hull_b, const HullTransform& transform_b, ContactManifold& manifold);
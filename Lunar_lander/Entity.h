@@ -1,57 +1,66 @@
 #include <vector>
 #include <GL/glew.h>
+#include "AnimationSystem.h"
 
-enum Animation { MOVE_STRAIGHT,EXPLODE};
+class CollisionMask;
+struct AABB;
+class Terrain;
+struct ConvexHull;
+struct ContactManifold;
+class FrameArena;
+class RenderQueue;
+class ShaderProgram;
 
 class Entity
 {
 private:
-    std::vector<GLuint> m_texture_ids;
-    std::vector<std::vector<int>> m_animations;
-
     glm::vec3 m_movement;
     glm::vec3 m_position;
     glm::vec3 m_scale;
+    float m_rotation = 0.0f; // radians, around z
 
     glm::mat4 m_model_matrix;
     float m_speed;
 
-    int m_animation_cols;
-    int m_animation_frames, m_animation_index, m_animation_rows;
-
-    Animation m_current_animation;
-    int* m_animation_indices = nullptr;
-    float m_animation_time = 0.0f;
-   
+    Animator m_animator; // clip and time live in the AnimationSystem, this is our slot in it
 
     glm::vec3 m_acceleration; // Acceleration vector (for movement)
     glm::vec3 m_velocity; // Velocity vector
     float m_gravity = -0.5f;  // Gravity constant
     float m_drag = 0.50f; // Drag factor (reduces movement over time)
+    float m_acceleration_decay = 0.98f; // acceleration is scaled by this every update
     float m_fuel = 100.0f; // starting fuel
 
-public:
-    static constexpr int SECONDS_PER_FRAME = 6;
+    const CollisionMask* m_collision_mask = nullptr; // per-pixel narrowphase, owned by whoever loaded the texture
+    const ConvexHull* m_hull = nullptr;              // convex narrowphase, the whole quad if not set
+    int m_broadphase_proxy = -1;                     // leaf in the broadphase tree, -1 if not in one
 
+public:
     Entity();
-    Entity(std::vector<GLuint> texture_ids, float speed,
-        std::vector<std::vector<int>> animations, float animation_time,
-        int animation_frames, int animation_index, int animation_cols,
-        int animation_rows, Animation animation);
+    Entity(AnimationSystem* animations, int clip, float speed);
     ~Entity();
 
-    void draw_sprite_from_texture_atlas(ShaderProgram* program);
+    void draw_sprite_from_texture_atlas(RenderQueue& queue, ShaderProgram* program);
     void update(float delta_time);
-    void render(ShaderProgram* program);
+    void render(RenderQueue& queue, ShaderProgram* program);
 
-    void set_animation_state(Animation new_animation);
+    void play_animation(int clip, bool restart = false) { m_animator.play(clip, restart); };
     void normalise_movement() { m_movement = glm::normalize(m_movement); };
 
+    glm::vec3 get_half_extents() const;
+    AABB get_bounds() const;
+
     bool check_collision(Entity* other);
+    bool check_contact(Entity* other, ContactManifold& manifold);
+    bool check_contact(const Terrain& terrain, ContactManifold& manifold);
+    void resolve_contact(const ContactManifold& manifold);
 
     glm::vec3 const get_acceleration() const { return m_acceleration; }
     void set_acceleration(glm::vec3 new_acceleration) { m_acceleration = new_acceleration; }
 
+    void set_gravity(float gravity) { m_gravity = gravity; }
+    void set_acceleration_decay(float decay) { m_acceleration_decay = decay; }
+
     glm::vec3 const get_velocity() const { return m_velocity; }
     void set_velocity(glm::vec3 new_velocity) { m_velocity = new_velocity; }
 
@@ -63,20 +72,29 @@ public:
             m_fuel = 0.0f;
     }
 
-    void move_straight();
-
     glm::vec3 const get_position() const { return m_position; }
     glm::vec3 const get_movement() const { return m_movement; }
     glm::vec3 const get_scale() const { return m_scale; }
     float const get_speed() const { return m_speed; }
+    float const get_rotation() const { return m_rotation; }
 
     void const set_position(glm::vec3 new_position) { m_position = new_position; }
     void const set_movement(glm::vec3 new_movement) { m_movement = new_movement; }
     void const set_scale(glm::vec3 new_scale) { m_scale = new_scale; }
     void const set_speed(float new_speed) { m_speed = new_speed; }
+    void const set_rotation(float new_rotation) { m_rotation = new_rotation; }
+
+    const CollisionMask* get_collision_mask() const { return m_collision_mask; }
+    void set_collision_mask(const CollisionMask* mask) { m_collision_mask = mask; }
+
+    const ConvexHull* get_hull() const { return m_hull; }
+    void set_hull(const ConvexHull* hull) { m_hull = hull; }
+
+    int const get_broadphase_proxy() const { return m_broadphase_proxy; }
+    void set_broadphase_proxy(int proxy) { m_broadphase_proxy = proxy; }
 
-    void draw_text(ShaderProgram* program, GLuint font_texture_id, std::string text, float font_size, float spacing, glm::vec3 position);
+    void draw_text(RenderQueue& queue, ShaderProgram* program, GLuint font_texture_id, const char* text, float font_size, float spacing, glm::vec3 position);
 
-    void display_fuel(ShaderProgram* program, GLuint font_texture_id, float font_size, float spacing);
+    void display_fuel(RenderQueue& queue, ShaderProgram* program, FrameArena& arena, GLuint font_texture_id, float font_size, float spacing);
 };
 
@@ -0,0 +1,97 @@
+#include <sys/stat.h>
+#include "FileWatcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+bool FileWatcher::read_stamp(long long& write_time, long long& size) const
+{
+    struct stat info;
+    if (stat(m_path.c_str(), &info) != 0) return false;
+
+    write_time = (long long)info.st_mtime;
+    size = (long long)info.st_size;
+    return true;
+}
+
+bool FileWatcher::watch(const char* path)
+{
+    stop();
+
+    m_path = path;
+    size_t slash = m_path.find_last_of("/\\");
+    m_directory = slash == std::string::npos ? "." : m_path.substr(0, slash);
+    m_file_name = slash == std::string::npos ? m_path : m_path.substr(slash + 1);
+
+#ifdef __linux__
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify >= 0)
+    {
+        // Not IN_CREATE: a new file can still be half written, and its close or rename comes after anyway
+        m_watch = inotify_add_watch(m_inotify, m_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (m_watch >= 0) return true;
+
+        close(m_inotify);
+        m_inotify = -1;
+    }
+#endif
+
+    // Fall back to polling, starting from however the file looks now
+    m_since_poll = 0.0f;
+    return read_stamp(m_last_write_time, m_last_size);
+}
+
+void FileWatcher::stop()
+{
+#ifdef __linux__
+    if (m_inotify >= 0) close(m_inotify);
+    m_inotify = m_watch = -1;
+#endif
+}
+
+bool FileWatcher::has_changed(float delta_time)
+{
+#ifdef __linux__
+    if (m_inotify >= 0)
+    {
+        // Drain everything that's queued up; a save is often several events
+        alignas(struct inotify_event) char buffer[sizeof(struct inotify_event) + NAME_MAX + 1];
+        bool changed = false;
+
+        while (true)
+        {
+            ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+            if (length <= 0) break;
+
+            for (char* cursor = buffer; cursor < buffer + length; )
+            {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(cursor);
+                if (event->len > 0 && m_file_name == event->name) changed = true;
+                cursor += sizeof(struct inotify_event) + event->len;
+            }
+        }
+
+        return changed;
+    }
+#endif
+
+    m_since_poll += delta_time;
+    if (m_since_poll < FILE_WATCH_POLL_INTERVAL) return false;
+    m_since_poll = 0.0f;
+
+    long long write_time, size;
+    if (!read_stamp(write_time, size)) return false;
+    if (write_time == m_last_write_time && size == m_last_size) return false;
+
+    m_last_write_time = write_time;
+    m_last_size = size;
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+// Without inotify we stat the file instead, but not every frame
+constexpr float FILE_WATCH_POLL_INTERVAL = 0.25f;
+
+/**
+ * Tells you when a file has been saved. On Linux that's inotify, watching the
+ * file's directory rather than the file itself, since most editors save by
+ * writing a new file and renaming it over the old one. Everywhere else it falls
+ * back to checking the modification time every FILE_WATCH_POLL_INTERVAL seconds.
+ *
+ * Neither way blocks, so has_changed() can go straight in the main loop.
+ */
+class FileWatcher
+{
+private:
+    std::string m_directory;
+    std::string m_file_name;
+
+#ifdef __linux__
+    int m_inotify = -1;
+    int m_watch = -1;
+#endif
+
+    // The fallback
+    std::string m_path;
+    long long m_last_write_time = 0;
+    long long m_last_size = 0;
+    float m_since_poll = 0.0f;
+
+    bool read_stamp(long long& write_time, long long& size) const;
+
+public:
+    FileWatcher() = default;
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    ~FileWatcher();
+
+    bool watch(const char* path);
+    void stop();
+
+    // True once for each save (or burst of saves) since the last call
+    bool has_changed(float delta_time);
+};
@@ -0,0 +1,108 @@
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include "FrameArena.h"
+
+FrameArena::~FrameArena()
+{
+    free(m_memory);
+}
+
+void FrameArena::init(size_t frame_size)
+{
+    free(m_memory);
+
+    m_frame_size = frame_size;
+    m_memory = static_cast<char*>(malloc(frame_size * FRAME_ARENA_BUFFERS));
+    m_current = 0;
+    m_top = m_memory;
+    m_end = m_memory + frame_size;
+}
+
+void FrameArena::begin_frame()
+{
+    size_t used = get_used();
+    if (used > m_high_water_mark) m_high_water_mark = used;
+
+    m_current = (m_current + 1) % FRAME_ARENA_BUFFERS;
+    m_top = m_memory + m_current * m_frame_size;
+    m_end = m_top + m_frame_size;
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+    uintptr_t aligned = ((uintptr_t)m_top + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (m_memory == nullptr || aligned + bytes > (uintptr_t)m_end)
+    {
+        // Only worth saying the first time, after that the count in the stats tells the story
+        if (m_overflow_count++ == 0) std::cout << "Frame arena out of space asking for " << bytes << " bytes" << std::endl;
+        return nullptr;
+    }
+
+    m_top = (char*)(aligned + bytes);
+    return (void*)aligned;
+}
+
+const char* FrameArena::format(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list measure;
+    va_copy(measure, args);
+    int length = vsnprintf(nullptr, 0, format, measure);
+    va_end(measure);
+
+    char* text = length >= 0 ? allocate_array<char>(length + 1) : nullptr;
+    if (text != nullptr) vsnprintf(text, length + 1, format, args);
+    va_end(args);
+
+    return text != nullptr ? text : "";
+}
+
+#ifdef LUNAR_TRACK_ALLOCATIONS
+namespace
+{
+    std::atomic<uint64_t> g_allocation_count(0);
+}
+
+uint64_t get_allocation_count()
+{
+    return g_allocation_count.load(std::memory_order_relaxed);
+}
+
+// Every other form of new ends up in one of these two
+void* operator new(size_t size)
+{
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = malloc(size != 0 ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    free(memory);
+}
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Per frame, and how many frames' worth are kept alive at once. Whatever was
+// allocated in a frame stays valid until that buffer comes round again, so a
+// consumer running up to two frames behind can still read it.
+constexpr size_t FRAME_ARENA_SIZE = 1 << 20;
+constexpr int FRAME_ARENA_BUFFERS = 3;
+
+// Debug builds count every global operator new, so we can tell if a frame allocated
+#if defined(_DEBUG) && !defined(LUNAR_TRACK_ALLOCATIONS)
+#define LUNAR_TRACK_ALLOCATIONS 1
+#endif
+
+/**
+ * A bump allocator for data that only has to live for a frame: vertex arrays
+ * built on the fly, formatted strings and the like. Allocating is a pointer bump,
+ * freeing is wholesale at begin_frame(), and nothing is ever handed back to the heap.
+ */
+class FrameArena
+{
+private:
+    char* m_memory = nullptr;
+    size_t m_frame_size = 0;
+    int m_current = 0;
+
+    char* m_top = nullptr;     // next free byte in the current frame's buffer
+    char* m_end = nullptr;
+
+    size_t m_high_water_mark = 0;
+    int m_overflow_count = 0;
+
+public:
+    FrameArena() {}
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    ~FrameArena();
+
+    void init(size_t frame_size = FRAME_ARENA_SIZE);
+
+    // Moves on to the next buffer, dropping everything allocated the last time it was used
+    void begin_frame();
+
+    // Null if the frame's buffer is full; that gets counted, and the caller should skip the work
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocate_array(size_t count) { return static_cast<T*>(allocate(sizeof(T) * count, alignof(T))); }
+
+    // printf into the arena. Empty string rather than null if it doesn't fit.
+    const char* format(const char* format, ...);
+
+    size_t const get_used()            const { return m_top - (m_end - m_frame_size); };
+    size_t const get_high_water_mark() const { return m_high_water_mark;             };
+    size_t const get_frame_size()      const { return m_frame_size;                  };
+    int    const get_overflow_count()  const { return m_overflow_count;              };
+};
+
+#ifdef LUNAR_TRACK_ALLOCATIONS
+// Global operator new calls since start-up, from any thread
+uint64_t get_allocation_count();
+#endif
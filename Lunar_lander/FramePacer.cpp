@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <iostream>
+#include "FramePacer.h"
+
+namespace
+{
+    Uint64 sdl_counter(void*)
+    {
+        return SDL_GetPerformanceCounter();
+    }
+
+    Uint64 sdl_frequency(void*)
+    {
+        return SDL_GetPerformanceFrequency();
+    }
+
+    void sdl_delay(void*, Uint32 ms)
+    {
+        SDL_Delay(ms);
+    }
+
+    int sdl_set_swap_interval(void*, int interval)
+    {
+        return SDL_GL_SetSwapInterval(interval);
+    }
+
+    void sdl_swap(void*, SDL_Window* window)
+    {
+        SDL_GL_SwapWindow(window);
+    }
+}
+
+FrameClock sdl_frame_clock()
+{
+    FrameClock clock;
+    clock.counter = sdl_counter;
+    clock.frequency = sdl_frequency;
+    clock.delay = sdl_delay;
+    clock.set_swap_interval = sdl_set_swap_interval;
+    clock.swap = sdl_swap;
+    return clock;
+}
+
+void FramePacer::init(int target_fps, SwapMode swap_mode, bool just_in_time, const FrameClock& clock)
+{
+    m_clock = clock;
+    m_frequency = (double)m_clock.frequency(m_clock.user);
+    set_target_fps(target_fps);
+    set_swap_mode(swap_mode);
+    m_just_in_time = just_in_time;
+    restart();
+}
+
+void FramePacer::restart()
+{
+    m_frame_end = now();
+    m_deadline = m_frame_end + ticks(frame_period());
+    m_input_sampled = m_frame_end;
+}
+
+void FramePacer::set_target_fps(int target_fps)
+{
+    m_target_seconds = target_fps > 0 ? 1.0 / target_fps : 0.0;
+}
+
+void FramePacer::set_swap_mode(SwapMode swap_mode)
+{
+    // -1 is adaptive, which plenty of drivers don't have
+    if (swap_mode == SWAP_ADAPTIVE && m_clock.set_swap_interval(m_clock.user, -1) != 0)
+    {
+        std::cout << "Adaptive vsync isn't supported here, using plain vsync: " << SDL_GetError() << std::endl;
+        swap_mode = SWAP_ON;
+    }
+    if (swap_mode != SWAP_ADAPTIVE && m_clock.set_swap_interval(m_clock.user, swap_mode == SWAP_ON ? 1 : 0) != 0)
+    {
+        std::cout << "Couldn't set the swap interval: " << SDL_GetError() << std::endl;
+    }
+    m_swap_mode = swap_mode;
+}
+
+double FramePacer::frame_period() const
+{
+    if (m_target_seconds > 0.0) return m_target_seconds;
+
+    // The quickest recent frame, which is the refresh when vsync is holding them.
+    // Not the average, which a missed refresh pushes up, so waiting longer would miss more.
+    float shortest = m_frame_times[0];
+    for (int i = 1; i < m_sample_count; i++) shortest = std::min(shortest, m_frame_times[i]);
+    return shortest / 1000.0;
+}
+
+void FramePacer::wait_until(Uint64 deadline) const
+{
+    Uint64 current = now();
+    if (current >= deadline) return;
+
+    // SDL_Delay only promises at least the time asked for, so leave the last bit to the spin
+    double sleep_seconds = seconds(deadline - current) - FRAME_PACER_SPIN;
+    if (sleep_seconds >= 0.001) m_clock.delay(m_clock.user, (Uint32)(sleep_seconds * 1000.0));
+
+    while (now() < deadline) {}
+}
+
+void FramePacer::wait_for_input()
+{
+    // Guessing the refresh before it's been measured would only make frames late,
+    // and late frames are what it's measured from
+    bool period_known = m_target_seconds > 0.0 || m_sample_count >= FRAME_PACER_WARMUP;
+    if (m_just_in_time && period_known)
+    {
+        double slack = m_work_seconds + JUST_IN_TIME_MARGIN;
+        Uint64 deadline = m_target_seconds > 0.0 ? m_deadline : m_frame_end + ticks(frame_period());
+        if (deadline > ticks(slack)) wait_until(deadline - ticks(slack));
+    }
+
+    m_input_sampled = now();
+}
+
+void FramePacer::present(SDL_Window* window)
+{
+    // One slow frame should make the next one start earlier, not just a bit earlier
+    double work = seconds(now() - m_input_sampled);
+    if (work > m_work_seconds) m_work_seconds = work;
+    else m_work_seconds += (work - m_work_seconds) * FRAME_PACER_SMOOTHING;
+
+    m_clock.swap(m_clock.user, window);
+    Uint64 swapped = now();
+
+    if (m_target_seconds > 0.0)
+    {
+        wait_until(m_deadline);
+
+        // Fell a whole frame behind: start again from now rather than rushing to catch up
+        Uint64 current = now();
+        m_deadline += ticks(m_target_seconds);
+        if (m_deadline < current) m_deadline = current + ticks(m_target_seconds);
+    }
+
+    Uint64 frame_end = now();
+    float frame_ms = (float)(seconds(frame_end - m_frame_end) * 1000.0);
+    m_frame_end = frame_end;
+
+    m_frame_times[m_sample_index] = frame_ms;
+    m_sample_index = (m_sample_index + 1) % FRAME_TIME_SAMPLES;
+    m_sample_count = std::min(m_sample_count + 1, FRAME_TIME_SAMPLES);
+
+    // Input that arrives at a random moment waits half a frame on average to be
+    // read, then goes through the work to the swap. With vsync on, the swap
+    // returns about when the frame goes out, so that's the photon; with it off
+    // the frame can show up any time in the next refresh, which this leaves out.
+    float input_to_photon_ms = frame_ms * 0.5f + (float)(seconds(swapped - m_input_sampled) * 1000.0);
+    m_input_to_photon_ms += (input_to_photon_ms - m_input_to_photon_ms) * FRAME_PACER_SMOOTHING;
+}
+
+FramePacerStats FramePacer::get_stats() const
+{
+    FramePacerStats stats;
+    if (m_sample_count == 0) return stats;
+
+    float total = 0.0f;
+    for (int i = 0; i < m_sample_count; i++)
+    {
+        total += m_frame_times[i];
+        stats.worst_ms = std::max(stats.worst_ms, m_frame_times[i]);
+    }
+    stats.mean_ms = total / m_sample_count;
+
+    float squares = 0.0f;
+    for (int i = 0; i < m_sample_count; i++)
+    {
+        float difference = m_frame_times[i] - stats.mean_ms;
+        squares += difference * difference;
+    }
+    stats.variance_ms = squares / m_sample_count;
+    stats.input_to_photon_ms = m_input_to_photon_ms;
+    return stats;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <SDL.h>
+
+// As config.ini has them under render.vsync
+enum SwapMode
+{
+    SWAP_OFF = 0,
+    SWAP_ON = 1,
+    SWAP_ADAPTIVE = 2   // vsync, but a late frame goes out straight away instead of waiting a whole refresh
+};
+
+constexpr int FRAME_TIME_SAMPLES = 120;         // the variance is over this many frames, about two seconds
+constexpr int FRAME_PACER_WARMUP = 30;          // frames to measure the refresh over before just-in-time waits on it
+constexpr double FRAME_PACER_SPIN = 0.002;      // seconds before a deadline to stop sleeping and spin
+constexpr double JUST_IN_TIME_MARGIN = 0.001;   // seconds left spare after the expected work, in case it runs long
+constexpr float FRAME_PACER_SMOOTHING = 0.1f;   // of the way to the new reading, each frame
+
+struct FramePacerStats
+{
+    float mean_ms = 0.0f;                       // frame to frame, over the last FRAME_TIME_SAMPLES
+    float variance_ms = 0.0f;                   // ms squared
+    float worst_ms = 0.0f;
+    float input_to_photon_ms = 0.0f;            // estimated, see present()
+};
+
+/**
+ * Everything FramePacer asks of SDL, so the tests can run it on a made-up clock.
+ * The counter has to keep moving between calls, since the spin waits on it.
+ */
+struct FrameClock
+{
+    void* user = nullptr;
+    Uint64 (*counter)(void* user) = nullptr;
+    Uint64 (*frequency)(void* user) = nullptr;     // counter ticks a second
+    void (*delay)(void* user, Uint32 ms) = nullptr;
+    int (*set_swap_interval)(void* user, int interval) = nullptr;  // 0 on success, like SDL's
+    void (*swap)(void* user, SDL_Window* window) = nullptr;
+};
+
+// The performance counter, SDL_Delay and the GL swap
+FrameClock sdl_frame_clock();
+
+/**
+ * Holds the main loop to a frame rate without burning a core: it sleeps until
+ * just short of each deadline, then spins the last stretch on the performance
+ * counter, since SDL_Delay can overshoot by a millisecond or more.
+ *
+ * A target of 0 doesn't limit anything, and leaves it to vsync if that's on.
+ *
+ * In just-in-time mode, wait_for_input() also holds off reading input until
+ * there's only about a frame's worth of work left before the deadline, so
+ * what gets drawn is as fresh as it can be. How long the work takes is
+ * learned from the last few frames, not counting the swap, which can block
+ * on vsync. With no target set, the deadline is guessed from the shortest
+ * recent frame, which with vsync on is the refresh.
+ */
+class FramePacer
+{
+private:
+    FrameClock m_clock = sdl_frame_clock();
+    double m_frequency = 1.0;           // performance counter ticks a second
+    double m_target_seconds = 0.0;      // 0 for no limit
+    SwapMode m_swap_mode = SWAP_ON;
+    bool m_just_in_time = false;
+
+    Uint64 m_deadline = 0;              // when this frame should be done, in counter ticks
+    Uint64 m_frame_end = 0;             // when the last one was
+    Uint64 m_input_sampled = 0;
+    double m_work_seconds = 0.0;        // input to just before the swap: up straight away, down slowly
+
+    float m_frame_times[FRAME_TIME_SAMPLES] = {};   // ms, a ring
+    int m_sample_index = 0;
+    int m_sample_count = 0;
+    float m_input_to_photon_ms = 0.0f;
+
+    double seconds(Uint64 ticks) const { return (double)ticks / m_frequency; };
+    Uint64 ticks(double seconds) const { return (Uint64)(seconds * m_frequency); };
+    Uint64 now() const { return m_clock.counter(m_clock.user); };
+    double frame_period() const;
+    void wait_until(Uint64 deadline) const;
+
+public:
+    // Needs the GL context current, for the swap interval, unless the clock's a fake
+    void init(int target_fps, SwapMode swap_mode, bool just_in_time, const FrameClock& clock = sdl_frame_clock());
+
+    // Starts timing afresh from now, so whatever came since init() isn't counted as a frame
+    void restart();
+
+    void set_target_fps(int target_fps);
+    void set_just_in_time(bool just_in_time) { m_just_in_time = just_in_time; };
+
+    // Falls back to plain vsync if the driver won't do adaptive
+    void set_swap_mode(SwapMode swap_mode);
+
+    // Right before input is read. Only ever waits in just-in-time mode.
+    void wait_for_input();
+
+    // Swaps, waits out the rest of the frame if there's a target, and takes the frame's timings
+    void present(SDL_Window* window);
+
+    FramePacerStats get_stats() const;
+    SwapMode const get_swap_mode() const { return m_swap_mode; };
+};
@@ -0,0 +1,68 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <iostream>
+#include "FrameUniforms.h"
+#include "ShaderProgram.h"
+#include "RenderBackend.h"
+
+bool frame_uniform_blocks_supported()
+{
+#ifdef LUNAR_UNIFORM_BUFFERS
+    static int supported = -1;
+    if (supported < 0)
+    {
+        // Core since 3.1, an extension before that
+        bool core = get_render_backend() == RENDER_BACKEND_CORE;
+        supported = core || has_gl_extension("GL_ARB_uniform_buffer_object") ? 1 : 0;
+    }
+    return supported == 1;
+#else
+    return false;
+#endif
+}
+
+void FrameUniforms::init()
+{
+#ifdef LUNAR_UNIFORM_BUFFERS
+    if (!frame_uniform_blocks_supported()) return;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), &m_data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // The binding is context state, so this only has to happen once
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, m_buffer);
+#endif
+}
+
+void FrameUniforms::release()
+{
+    if (m_buffer != 0) glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+}
+
+void FrameUniforms::add_program(ShaderProgram* program)
+{
+    if (m_program_count == MAX_FRAME_PROGRAMS)
+    {
+        std::cout << "FrameUniforms: no room for another program, raise MAX_FRAME_PROGRAMS" << std::endl;
+        return;
+    }
+    m_programs[m_program_count++] = program;
+}
+
+void FrameUniforms::upload()
+{
+#ifdef LUNAR_UNIFORM_BUFFERS
+    if (m_buffer != 0)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &m_data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < m_program_count; i++) m_programs[i]->set_frame_data(m_data);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+
+class ShaderProgram;
+
+// Uniform blocks aren't in the macOS legacy profile at all, so there it's always the fallback
+#if defined(_WINDOWS) || defined(__linux__)
+#define LUNAR_UNIFORM_BUFFERS 1
+#endif
+
+// Every program's FrameData block is bound to this slot
+constexpr GLuint FRAME_UNIFORM_BINDING = 0;
+constexpr int MAX_FRAME_PROGRAMS = 16;
+
+// Laid out to match the std140 block ShaderProgram declares in every vertex
+// shader: each mat4 is four vec4 columns, and a vec4 is 16 bytes, so there's no padding
+struct FrameData
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec4 time = glm::vec4(0.0f);     // seconds since start, seconds since last frame, unused, unused
+};
+
+// True if this driver can do uniform blocks (GL 3.1 or ARB_uniform_buffer_object)
+bool frame_uniform_blocks_supported();
+
+/**
+ * The per-frame data every shader shares, uploaded once a frame into one
+ * uniform buffer that every program reads through the same binding. Without
+ * uniform buffers it falls back to setting plain uniforms on each program it
+ * knows about, which is what every program did on its own before.
+ */
+class FrameUniforms
+{
+private:
+    FrameData m_data;
+    GLuint m_buffer = 0;
+
+    // Only used by the fallback
+    ShaderProgram* m_programs[MAX_FRAME_PROGRAMS];
+    int m_program_count = 0;
+
+public:
+    void init();
+    void release();
+
+    // Programs that should get frame data without uniform blocks
+    void add_program(ShaderProgram* program);
+
+    void set_view(const glm::mat4& view)             { m_data.view = view;             };
+    void set_projection(const glm::mat4& projection) { m_data.projection = projection; };
+    void set_time(float time, float delta_time)      { m_data.time = glm::vec4(time, delta_time, 0.0f, 0.0f); };
+
+    // Sends everything set since the last upload; once a frame, before anything draws
+    void upload();
+
+    const FrameData& get_data() const { return m_data; };
+};
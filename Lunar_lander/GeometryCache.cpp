@@ -0,0 +1,115 @@
+#define GL_SILENCE_DEPRECATION
+
+#include "GeometryCache.h"
+#include "ShaderProgram.h"
+#include "RenderBackend.h"
+
+namespace
+{
+    constexpr int FLOATS_PER_VERTEX = 4;   // x, y, u, v
+
+    // Half sizes as a share of the view's, so the default 5 x 3.75 view gets the
+    // 5 x 3.75 and 2.5 x 2 that render_background and render_end_screen used to draw
+    constexpr float QUAD_VIEW_SHARES[STATIC_QUAD_COUNT][2] =
+    {
+        { 1.0f, 1.0f       },   // QUAD_BACKGROUND
+        { 0.5f, 0.5333333f },   // QUAD_END_SCREEN
+    };
+}
+
+void GeometryCache::init(float view_half_width, float view_half_height)
+{
+    float vertices[STATIC_QUAD_COUNT * 4 * FLOATS_PER_VERTEX];
+    GLushort indices[STATIC_QUAD_COUNT * 6];
+
+    for (int quad = 0; quad < STATIC_QUAD_COUNT; quad++)
+    {
+        float x = QUAD_VIEW_SHARES[quad][0] * view_half_width;
+        float y = QUAD_VIEW_SHARES[quad][1] * view_half_height;
+
+        // Bottom-left, bottom-right, top-right, top-left; v runs down the image
+        float corners[4 * FLOATS_PER_VERTEX] =
+        {
+            -x, -y,   0.0f, 1.0f,
+             x, -y,   1.0f, 1.0f,
+             x,  y,   1.0f, 0.0f,
+            -x,  y,   0.0f, 0.0f,
+        };
+        for (int i = 0; i < 4 * FLOATS_PER_VERTEX; i++) vertices[quad * 4 * FLOATS_PER_VERTEX + i] = corners[i];
+
+        GLushort first = (GLushort)(quad * 4);
+        GLushort quad_indices[6] = { first, (GLushort)(first + 1), (GLushort)(first + 2), first, (GLushort)(first + 2), (GLushort)(first + 3) };
+        for (int i = 0; i < 6; i++) indices[quad * 6 + i] = quad_indices[i];
+    }
+
+    glGenBuffers(1, &m_vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    allocate_static_buffer(GL_ARRAY_BUFFER, sizeof(vertices), vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &m_index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+    allocate_static_buffer(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    m_vertex_array = create_vertex_array();
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(m_vertex_array);
+        bind_attributes();
+        bind_vertex_array(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void GeometryCache::release()
+{
+    delete_vertex_array(m_vertex_array);
+    if (m_vertex_buffer != 0) glDeleteBuffers(1, &m_vertex_buffer);
+    if (m_index_buffer != 0) glDeleteBuffers(1, &m_index_buffer);
+
+    m_vertex_buffer = m_index_buffer = 0;
+}
+
+void GeometryCache::resize(float view_half_width, float view_half_height)
+{
+    // Static storage can't be written again, so it's new buffers
+    release();
+    init(view_half_width, view_half_height);
+}
+
+void GeometryCache::bind_attributes() const
+{
+    GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, false, stride, 0);
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glVertexAttribPointer(ATTRIBUTE_TEX_COORD, 2, GL_FLOAT, false, stride, (const void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+}
+
+void GeometryCache::draw(StaticQuad quad)
+{
+    if (m_vertex_buffer == 0) return;
+
+    const void* first_index = (const void*)(quad * 6 * sizeof(GLushort));
+
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(m_vertex_array);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, first_index);
+        bind_vertex_array(0);
+        return;
+    }
+
+    bind_attributes();
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, first_index);
+
+    glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+    glDisableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+
+// Every quad that only changes shape with the view, in screen space
+enum StaticQuad
+{
+    QUAD_BACKGROUND,    // the whole view
+    QUAD_END_SCREEN,    // the win / lose picture in the middle, the same share of the view whatever its size
+    STATIC_QUAD_COUNT
+};
+
+/**
+ * The quads that look the same every frame, uploaded once into one static
+ * vertex buffer and one index buffer (x, y, u, v, four corners and six indices
+ * a quad) and drawn from there instead of from arrays on the stack. Where the
+ * driver has vertex array objects the attribute setup lives in one too, made
+ * once, since every program takes its attributes at the same slots.
+ */
+class GeometryCache
+{
+private:
+    GLuint m_vertex_buffer = 0;
+    GLuint m_index_buffer = 0;
+    GLuint m_vertex_array = 0;
+
+    void bind_attributes() const;
+
+public:
+    // Needs a GL context. The quads are built for a view this big, as set in config.ini.
+    void init(float view_half_width, float view_half_height);
+    void release();
+
+    // Builds the buffers again when the view's size changes
+    void resize(float view_half_width, float view_half_height);
+
+    // Draws with whatever program and texture are bound. The program needs position and texCoord.
+    void draw(StaticQuad quad);
+};
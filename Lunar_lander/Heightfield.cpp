@@ -0,0 +1,86 @@
+#include <cmath>
+#include "glm/gtc/noise.hpp"
+#include "Heightfield.h"
+
+namespace
+{
+    constexpr float NOISE_PERIOD = 256.0f;        // glm::perlin wraps the lattice at this
+    constexpr double NOISE_BASE_FREQUENCY = 0.2;
+    constexpr float PAD_BLEND_WIDTH = 0.75f;      // ground eases into the pad height over this
+
+    uint32_t hash(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    float hash01(uint32_t seed, int64_t cell)
+    {
+        return (float)(hash(seed ^ hash((uint32_t)cell ^ (uint32_t)(cell >> 32))) / 4294967295.0);
+    }
+
+    // Fractal perlin noise in [-1, 1]-ish. x is wrapped in double precision before
+    // it reaches the float noise, so we stay smooth millions of units out.
+    float ground_noise(uint32_t seed, double x)
+    {
+        float sum = 0.0f, amplitude = 1.0f, total_amplitude = 0.0f;
+        double frequency = NOISE_BASE_FREQUENCY;
+
+        for (int octave = 0; octave < TERRAIN_OCTAVES; octave++)
+        {
+            float wrapped = (float)fmod(x * frequency, (double)NOISE_PERIOD);
+            if (wrapped < 0.0f) wrapped += NOISE_PERIOD;
+
+            // Each octave reads its own row of the noise, picked by the seed
+            float row = (float)(hash(seed + octave) % (uint32_t)NOISE_PERIOD);
+
+            sum += amplitude * glm::perlin(glm::vec2(wrapped, row + 0.5f), glm::vec2(NOISE_PERIOD));
+            total_amplitude += amplitude;
+            amplitude *= 0.5f;
+            frequency *= 2.0;
+        }
+
+        return sum / total_amplitude;
+    }
+}
+
+double landing_pad_centre(uint32_t seed, int64_t cell)
+{
+    return (cell + 0.25 + 0.5 * hash01(seed, cell)) * LANDING_PAD_INTERVAL;
+}
+
+float terrain_height(uint32_t seed, double x)
+{
+    // Flatten out a pad in this cell, easing the ground in around it
+    int64_t cell = (int64_t)floor(x / LANDING_PAD_INTERVAL);
+    double centre = landing_pad_centre(seed, cell);
+    float pad_height = TERRAIN_BASE_HEIGHT + TERRAIN_AMPLITUDE * ground_noise(seed, centre);
+    float ground_height = TERRAIN_BASE_HEIGHT + TERRAIN_AMPLITUDE * ground_noise(seed, x);
+
+    float from_pad = (float)fabs(x - centre) - LANDING_PAD_HALF_WIDTH;
+    if (from_pad <= 0.0f) return pad_height;
+    if (from_pad >= PAD_BLEND_WIDTH) return ground_height;
+
+    float t = from_pad / PAD_BLEND_WIDTH;
+    t = t * t * (3.0f - 2.0f * t);
+    return pad_height + (ground_height - pad_height) * t;
+}
+
+double nearest_landing_pad(uint32_t seed, double x)
+{
+    // One pad per cell, so the nearest is in this cell or one of its neighbours
+    int64_t cell = (int64_t)floor(x / LANDING_PAD_INTERVAL);
+    double nearest = landing_pad_centre(seed, cell);
+
+    for (int64_t neighbour = cell - 1; neighbour <= cell + 1; neighbour += 2)
+    {
+        double centre = landing_pad_centre(seed, neighbour);
+        if (fabs(centre - x) < fabs(nearest - x)) nearest = centre;
+    }
+
+    return nearest;
+}
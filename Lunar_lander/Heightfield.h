@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Shape of the ground, all in world units
+constexpr float TERRAIN_BASE_HEIGHT = -3.0f;
+constexpr float TERRAIN_AMPLITUDE = 1.2f;
+constexpr int TERRAIN_OCTAVES = 4;
+
+// Every interval along x gets one flat pad somewhere inside it
+constexpr float LANDING_PAD_INTERVAL = 8.0f;
+constexpr float LANDING_PAD_HALF_WIDTH = 0.5f;
+
+/**
+ * The ground as a pure function of the seed and world x. Terrain builds its tables
+ * and meshes from this, and since there's no GL anywhere in here the headless
+ * tools can fly over exactly the same ground the game draws.
+ */
+float terrain_height(uint32_t seed, double x);
+
+// Centre of the one pad in the cell [cell, cell + 1) * LANDING_PAD_INTERVAL
+double landing_pad_centre(uint32_t seed, int64_t cell);
+
+// Centre of the pad closest to x
+double nearest_landing_pad(uint32_t seed, double x);
@@ -0,0 +1,134 @@
+#include "InputLayer.h"
+#include "Simulation.h"
+
+void InputLayer::queue_change(Uint32 timestamp, InputSource source, uint8_t buttons)
+{
+    if (buttons == m_produced[source]) return;
+
+    // A full queue would mean nothing has stepped for hundreds of events; drop it and count it
+    InputEvent event = { timestamp, (uint8_t)source, buttons };
+    if (!m_queue.push(event))
+    {
+        m_dropped_count++;
+        return;
+    }
+    m_produced[source] = buttons;
+}
+
+void InputLayer::set_button(Uint32 timestamp, InputSource source, uint8_t button, bool pressed)
+{
+    uint8_t buttons = pressed ? (uint8_t)(m_produced[source] | button) : (uint8_t)(m_produced[source] & ~button);
+    queue_change(timestamp, source, buttons);
+}
+
+bool InputLayer::handle_event(const SDL_Event& event)
+{
+    switch (event.type)
+    {
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+    {
+        // Repeats don't change anything that's held
+        if (event.key.repeat != 0) return true;
+
+        bool pressed = event.type == SDL_KEYDOWN;
+        switch (event.key.keysym.scancode)
+        {
+        case SDL_SCANCODE_A: set_button(event.key.timestamp, INPUT_SOURCE_KEYBOARD, INPUT_LEFT, pressed);   return true;
+        case SDL_SCANCODE_D: set_button(event.key.timestamp, INPUT_SOURCE_KEYBOARD, INPUT_RIGHT, pressed);  return true;
+        case SDL_SCANCODE_W: set_button(event.key.timestamp, INPUT_SOURCE_KEYBOARD, INPUT_THRUST, pressed); return true;
+        default: return false;
+        }
+    }
+
+    case SDL_CONTROLLERBUTTONDOWN:
+    case SDL_CONTROLLERBUTTONUP:
+    {
+        bool pressed = event.type == SDL_CONTROLLERBUTTONDOWN;
+        switch (event.cbutton.button)
+        {
+        case SDL_CONTROLLER_BUTTON_DPAD_LEFT:  set_button(event.cbutton.timestamp, INPUT_SOURCE_GAMEPAD_BUTTONS, INPUT_LEFT, pressed);   return true;
+        case SDL_CONTROLLER_BUTTON_DPAD_RIGHT: set_button(event.cbutton.timestamp, INPUT_SOURCE_GAMEPAD_BUTTONS, INPUT_RIGHT, pressed);  return true;
+        case SDL_CONTROLLER_BUTTON_A:          set_button(event.cbutton.timestamp, INPUT_SOURCE_GAMEPAD_BUTTONS, INPUT_THRUST, pressed); return true;
+        default: return false;
+        }
+    }
+
+    case SDL_CONTROLLERAXISMOTION:
+    {
+        Uint32 timestamp = event.caxis.timestamp;
+        Sint16 value = event.caxis.value;
+
+        // Axes move constantly, but only crossing a threshold queues anything
+        if (event.caxis.axis == SDL_CONTROLLER_AXIS_LEFTX)
+        {
+            set_button(timestamp, INPUT_SOURCE_GAMEPAD_AXES, INPUT_LEFT, value < -GAMEPAD_STICK_DEADZONE);
+            set_button(timestamp, INPUT_SOURCE_GAMEPAD_AXES, INPUT_RIGHT, value > GAMEPAD_STICK_DEADZONE);
+            return true;
+        }
+        if (event.caxis.axis == SDL_CONTROLLER_AXIS_TRIGGERRIGHT)
+        {
+            set_button(timestamp, INPUT_SOURCE_GAMEPAD_AXES, INPUT_THRUST, value > GAMEPAD_TRIGGER_THRESHOLD);
+            return true;
+        }
+        return false;
+    }
+
+    case SDL_CONTROLLERDEVICEADDED:
+        // `which` is a device index here, and an instance id on removal
+        for (SDL_GameController*& gamepad : m_gamepads)
+        {
+            if (gamepad != nullptr) continue;
+            gamepad = SDL_GameControllerOpen(event.cdevice.which);
+            break;
+        }
+        return true;
+
+    case SDL_CONTROLLERDEVICEREMOVED:
+    {
+        SDL_GameController* removed = SDL_GameControllerFromInstanceID(event.cdevice.which);
+        for (SDL_GameController*& gamepad : m_gamepads)
+        {
+            if (gamepad == nullptr || gamepad != removed) continue;
+            SDL_GameControllerClose(gamepad);
+            gamepad = nullptr;
+        }
+
+        // Whatever it was holding isn't held any more
+        queue_change(event.cdevice.timestamp, INPUT_SOURCE_GAMEPAD_BUTTONS, 0);
+        queue_change(event.cdevice.timestamp, INPUT_SOURCE_GAMEPAD_AXES, 0);
+        return true;
+    }
+    }
+
+    return false;
+}
+
+void InputLayer::close_gamepads()
+{
+    for (SDL_GameController*& gamepad : m_gamepads)
+    {
+        if (gamepad != nullptr) SDL_GameControllerClose(gamepad);
+        gamepad = nullptr;
+    }
+}
+
+uint8_t InputLayer::take_step(Uint32 step_end)
+{
+    uint8_t pressed = 0;
+
+    // Oldest first, stopping at the first one that belongs to a later step
+    for (const InputEvent* event = m_queue.peek(); event != nullptr && (Sint32)(event->timestamp - step_end) <= 0; event = m_queue.peek())
+    {
+        pressed |= event->buttons & ~m_held[event->source];
+        m_held[event->source] = event->buttons;
+
+        m_delay_total_ms += step_end - event->timestamp;
+        m_applied_count++;
+        m_queue.pop();
+    }
+
+    uint8_t held = 0;
+    for (uint8_t buttons : m_held) held |= buttons;
+    return held | pressed;
+}
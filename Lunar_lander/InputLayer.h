@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <SDL.h>
+#include "SpscQueue.h"
+
+constexpr size_t INPUT_QUEUE_CAPACITY = 256;       // events, far more than a frame's worth
+constexpr int MAX_GAMEPADS = 4;
+constexpr Sint16 GAMEPAD_STICK_DEADZONE = 8000;    // of 32767, before the stick counts as left or right
+constexpr Sint16 GAMEPAD_TRIGGER_THRESHOLD = 8000; // right trigger, before it counts as thrust
+
+// Where a change came from, so letting go of one doesn't cancel another still held
+enum InputSource
+{
+    INPUT_SOURCE_KEYBOARD,
+    INPUT_SOURCE_GAMEPAD_BUTTONS,   // d-pad and A
+    INPUT_SOURCE_GAMEPAD_AXES,      // left stick and right trigger
+    INPUT_SOURCE_COUNT
+};
+
+// A source's InputButton bits changed at `timestamp`, in SDL ticks (milliseconds)
+struct InputEvent
+{
+    Uint32 timestamp;
+    uint8_t source;
+    uint8_t buttons;    // everything that source now holds
+};
+
+/**
+ * Turns SDL keyboard and gamepad events into timestamped button changes, and
+ * hands them to the simulation one fixed step at a time.
+ *
+ * The event side (handle_event) and the step side (take_step) only meet in an
+ * SPSC queue, so they can be on different threads; today both are on the main
+ * one. take_step() applies only what happened up to the end of that step and
+ * leaves the rest queued, so a frame that runs several steps gives each one the
+ * input from its own slice of time instead of whatever was held at the end of
+ * the frame. A press that's released again inside one step still counts for
+ * that step, so taps shorter than a frame aren't lost.
+ *
+ * What comes out is a plain InputButton mask per step, which is all a replay
+ * or a peer needs to fly the same ship.
+ */
+class InputLayer
+{
+private:
+    SpscQueue<InputEvent, INPUT_QUEUE_CAPACITY> m_queue;
+
+    // Event side
+    uint8_t m_produced[INPUT_SOURCE_COUNT] = {};    // what each source holds, as last queued
+    SDL_GameController* m_gamepads[MAX_GAMEPADS] = {};
+    int m_dropped_count = 0;
+
+    // Step side
+    uint8_t m_held[INPUT_SOURCE_COUNT] = {};
+    uint64_t m_delay_total_ms = 0;                  // between an event and the end of the step it landed in
+    int m_applied_count = 0;
+
+    void queue_change(Uint32 timestamp, InputSource source, uint8_t buttons);
+    void set_button(Uint32 timestamp, InputSource source, uint8_t button, bool pressed);
+
+public:
+    InputLayer() {}
+    InputLayer(const InputLayer&) = delete;
+    InputLayer& operator=(const InputLayer&) = delete;
+
+    // Event side: true if the event was input and has been dealt with.
+    // Also opens and closes gamepads as they come and go.
+    bool handle_event(const SDL_Event& event);
+    void close_gamepads();
+
+    // Step side: the buttons for the step ending at `step_end` (SDL ticks, ms),
+    // held ones plus anything pressed at any point during it
+    uint8_t take_step(Uint32 step_end);
+
+    int const get_dropped_count() const { return m_dropped_count; };
+    float const get_average_delay_ms() const { return m_applied_count > 0 ? (float)m_delay_total_ms / m_applied_count : 0.0f; };
+};
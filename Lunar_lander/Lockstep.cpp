@@ -0,0 +1,674 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "Lockstep.h"
+
+namespace
+{
+    enum PacketType
+    {
+        PACKET_HELLO = 1,       // client: let me in
+        PACKET_START,           // server: you're this player, and here's the race
+        PACKET_INPUT,           // client: my input from a step on, and what I've got of everyone's
+        PACKET_CONFIRMED,       // server: everyone else's input from a step on, and what I've got of yours
+        PACKET_DESYNC           // server: your hash doesn't match mine
+    };
+
+    constexpr uint32_t WINDOW_MASK = LOCKSTEP_WINDOW - 1;
+    constexpr uint8_t HASH_FLAG = 0x80;     // on an INPUT's step count, when a hash comes with it
+    constexpr uint8_t PACKED_FLAG = 0x40;   // on an INPUT's step count, when the input's packed rather than in runs
+    static_assert(LOCKSTEP_MAX_PACKET_STEPS < PACKED_FLAG, "The step count has to fit under the flags");
+    constexpr int HASH_SLOTS = LOCKSTEP_WINDOW / LOCKSTEP_HASH_INTERVAL + 1;
+
+    // A run is one byte: the mask in the top 3 bits, and how many steps it's held for, less one, in the rest
+    constexpr int RUN_BITS = 5;
+    constexpr int MAX_RUN = 1 << RUN_BITS;
+
+    // Little-endian whatever the machine is
+    struct Writer
+    {
+        uint8_t* data;
+        int size = 0;
+
+        explicit Writer(uint8_t* buffer) : data(buffer) {}
+
+        void u8(uint8_t value)   { if (size < NET_MAX_PACKET) data[size++] = value; }
+        void u16(uint16_t value) { u8((uint8_t)value); u8((uint8_t)(value >> 8)); }
+        void u32(uint32_t value) { u16((uint16_t)value); u16((uint16_t)(value >> 16)); }
+        void f32(float value)    { uint32_t bits; memcpy(&bits, &value, sizeof(bits)); u32(bits); }
+    };
+
+    // Reading past the end gives zeros and clears ok, so a packet can be checked once at the end
+    struct Reader
+    {
+        const uint8_t* data;
+        int size;
+        int at = 0;
+        bool ok = true;
+
+        Reader(const uint8_t* buffer, int buffer_size) : data(buffer), size(buffer_size) {}
+
+        uint8_t u8()
+        {
+            if (at >= size) { ok = false; return 0; }
+            return data[at++];
+        }
+        uint16_t u16() { uint16_t low = u8(); return (uint16_t)(low | (u8() << 8)); }
+        uint32_t u32() { uint32_t low = u16(); return low | ((uint32_t)u16() << 16); }
+        float f32()    { uint32_t bits = u32(); float value; memcpy(&value, &bits, sizeof(value)); return value; }
+    };
+
+    // The full step with these low 16 bits that's nearest to one we already know
+    uint32_t widen(uint16_t wire, uint32_t near)
+    {
+        return near + (int16_t)(uint16_t)(wire - (uint16_t)near);
+    }
+
+    /**
+     * As runs, or if they'd take more bytes, which they do once the buttons change
+     * every few steps, packed 3 bits a step. Says which, since the reader has to know.
+     */
+    template <typename GetButtons>
+    bool write_inputs(Writer& writer, int count, GetButtons get_buttons)
+    {
+        uint8_t runs[LOCKSTEP_MAX_PACKET_STEPS];
+        int run_count = 0;
+        for (int i = 0; i < count;)
+        {
+            uint8_t buttons = get_buttons(i) & 7;
+            int run = 1;
+            while (i + run < count && run < MAX_RUN && (get_buttons(i + run) & 7) == buttons) run++;
+
+            runs[run_count++] = (uint8_t)(buttons << RUN_BITS | (run - 1));
+            i += run;
+        }
+
+        if (run_count <= (count * 3 + 7) / 8)
+        {
+            for (int i = 0; i < run_count; i++) writer.u8(runs[i]);
+            return false;
+        }
+
+        // Lowest bits first, a step's mask free to straddle two bytes
+        uint32_t bits = 0;
+        int bit_count = 0;
+        for (int i = 0; i < count; i++)
+        {
+            bits |= (uint32_t)(get_buttons(i) & 7) << bit_count;
+            bit_count += 3;
+            for (; bit_count >= 8; bit_count -= 8, bits >>= 8) writer.u8((uint8_t)bits);
+        }
+        if (bit_count > 0) writer.u8((uint8_t)bits);
+        return true;
+    }
+
+    // Into buttons[0], buttons[stride], buttons[2 * stride]...
+    bool read_inputs(Reader& reader, int count, bool packed, uint8_t* buttons, int stride)
+    {
+        if (packed)
+        {
+            uint32_t bits = 0;
+            int bit_count = 0;
+            for (int i = 0; i < count; i++)
+            {
+                if (bit_count < 3)
+                {
+                    bits |= (uint32_t)reader.u8() << bit_count;
+                    bit_count += 8;
+                }
+                buttons[i * stride] = bits & 7;
+                bits >>= 3;
+                bit_count -= 3;
+            }
+            return reader.ok;
+        }
+
+        for (int i = 0; i < count;)
+        {
+            uint8_t run_byte = reader.u8();
+            int run = (run_byte & (MAX_RUN - 1)) + 1;
+            if (!reader.ok || i + run > count) return false;
+
+            for (int j = 0; j < run; j++) buttons[(i + j) * stride] = run_byte >> RUN_BITS;
+            i += run;
+        }
+        return true;
+    }
+
+    void write_settings(Writer& writer, const RaceSettings& settings)
+    {
+        writer.u8((uint8_t)settings.player_count);
+        writer.u8((uint8_t)settings.input_delay);
+        writer.u32(settings.seed);
+
+        const PhysicsParams& physics = settings.physics;
+        writer.f32(physics.gravity);
+        writer.f32(physics.speed);
+        writer.f32(physics.acceleration_decay);
+        writer.f32(physics.side_thrust);
+        writer.f32(physics.up_thrust);
+        writer.f32(physics.idle_vertical);
+        writer.f32(physics.fuel_burn);
+
+        writer.f32(settings.level.start_fuel);
+        writer.f32(settings.level.start_height);
+        writer.f32(settings.level.start_drift);
+    }
+
+    void read_settings(Reader& reader, RaceSettings& settings)
+    {
+        settings.player_count = reader.u8();
+        settings.input_delay = reader.u8();
+        settings.seed = reader.u32();
+
+        PhysicsParams& physics = settings.physics;
+        physics.gravity = reader.f32();
+        physics.speed = reader.f32();
+        physics.acceleration_decay = reader.f32();
+        physics.side_thrust = reader.f32();
+        physics.up_thrust = reader.f32();
+        physics.idle_vertical = reader.f32();
+        physics.fuel_burn = reader.f32();
+
+        settings.level.start_fuel = reader.f32();
+        settings.level.start_height = reader.f32();
+        settings.level.start_drift = reader.f32();
+    }
+
+    void print_address(const NetAddress& address)
+    {
+        std::cout << (address.host >> 24) << '.' << ((address.host >> 16) & 0xff) << '.' << ((address.host >> 8) & 0xff) << '.'
+            << (address.host & 0xff) << ':' << address.port;
+    }
+}
+
+bool LockstepClient::connect(const char* address, const NetConditions& conditions, uint32_t conditions_seed)
+{
+    if (!resolve_address(address, LOCKSTEP_PORT, m_server)) return false;
+    if (!m_socket.open(0)) return false;
+    m_socket.set_conditions(conditions, conditions_seed);
+
+    m_started = false;
+    m_last_send_ms = 0;
+    m_last_heard_ms = net_time_ms();
+    return true;
+}
+
+void LockstepClient::poll()
+{
+    uint8_t buffer[NET_MAX_PACKET];
+    NetAddress from;
+    int size;
+    while ((size = m_socket.receive(from, buffer, sizeof(buffer))) >= 0)
+    {
+        if (!(from == m_server)) continue;
+
+        m_last_heard_ms = net_time_ms();
+        handle_packet(buffer, size);
+    }
+
+    uint64_t now = net_time_ms();
+    if (!m_started)
+    {
+        // Waiting for the rest to join can take as long as it takes, so no timeout yet
+        if (now - m_last_send_ms < LOCKSTEP_HELLO_INTERVAL_MS) return;
+
+        uint8_t hello = PACKET_HELLO;
+        m_socket.send(m_server, &hello, 1);
+        m_last_send_ms = now;
+        return;
+    }
+
+    if (!m_timed_out && now - m_last_heard_ms > LOCKSTEP_TIMEOUT_MS)
+    {
+        std::cout << "Lost the race server" << std::endl;
+        m_timed_out = true;
+    }
+
+    if (now - m_last_send_ms >= LOCKSTEP_SEND_INTERVAL_MS) send_input();
+}
+
+void LockstepClient::handle_packet(const uint8_t* data, int size)
+{
+    Reader reader(data, size);
+    uint8_t type = reader.u8();
+
+    if (type == PACKET_START)
+    {
+        if (m_started) return;
+
+        int player = reader.u8();
+        RaceSettings settings;
+        read_settings(reader, settings);
+        if (!reader.ok || player >= settings.player_count || settings.player_count > MAX_RACE_PLAYERS
+            || settings.input_delay >= LOCKSTEP_WINDOW / 2) return;
+
+        m_player = player;
+        m_settings = settings;
+        m_course.build(settings.seed);
+        race_start(m_race, m_course, settings.player_count, settings.level);
+        m_predicted = m_race;
+        m_mispredicted = false;
+
+        // Nobody can have pressed anything in time for the first input_delay steps, so they're empty
+        memset(m_local, 0, sizeof(m_local));
+        memset(m_confirmed, 0, sizeof(m_confirmed));
+        m_local_end = m_server_received = m_confirmed_end = (uint32_t)settings.input_delay;
+
+        m_started = true;
+        m_last_send_ms = 0;     // answer straight away, so the server knows this got through
+        std::cout << "Racing as player " << player + 1 << " of " << settings.player_count << std::endl;
+        return;
+    }
+
+    if (!m_started) return;
+
+    if (type == PACKET_CONFIRMED)
+    {
+        uint32_t received = widen(reader.u16(), m_server_received);
+        uint32_t first = widen(reader.u16(), m_confirmed_end);
+        int count = reader.u8();
+        uint8_t packed = reader.u8();
+        if (!reader.ok || count > LOCKSTEP_MAX_PACKET_STEPS) return;
+
+        uint8_t inputs[LOCKSTEP_MAX_PACKET_STEPS][MAX_RACE_PLAYERS];
+        for (int player = 0; player < m_settings.player_count; player++)
+        {
+            if (player == m_player) continue;
+            if (!read_inputs(reader, count, (packed >> player) & 1, &inputs[0][player], MAX_RACE_PLAYERS)) return;
+        }
+
+        if (received > m_server_received && received <= m_local_end) m_server_received = received;
+
+        // Only ever extends what's there, so repeats and stale packets change nothing.
+        // The server can't have confirmed a step it hasn't had this player's input for.
+        for (int i = 0; i < count; i++)
+        {
+            uint32_t step = first + i;
+            if (step != m_confirmed_end || step >= m_server_received) continue;
+            inputs[i][m_player] = m_local[step & WINDOW_MASK];
+            memcpy(m_confirmed[step & WINDOW_MASK], inputs[i], MAX_RACE_PLAYERS);
+            m_confirmed_end++;
+        }
+        return;
+    }
+
+    if (type == PACKET_DESYNC)
+    {
+        uint32_t step = widen(reader.u16(), m_race.step);
+        if (!reader.ok || m_desynced) return;
+
+        std::cout << "Out of sync with the race server from step " << step << std::endl;
+        m_desynced = true;
+    }
+}
+
+void LockstepClient::send_input()
+{
+    uint8_t packet[NET_MAX_PACKET];
+    Writer writer(packet);
+
+    uint32_t first = m_server_received;
+    int count = (int)std::min<uint32_t>(m_local_end - first, LOCKSTEP_MAX_PACKET_STEPS);
+    bool with_hash = m_hash_repeats > 0;
+
+    writer.u8(PACKET_INPUT);
+    writer.u8((uint8_t)m_player);
+    writer.u16((uint16_t)m_confirmed_end);
+    writer.u16((uint16_t)first);
+    int count_at = writer.size;
+    writer.u8((uint8_t)(count | (with_hash ? HASH_FLAG : 0)));
+    if (with_hash)
+    {
+        writer.u16((uint16_t)m_hash_step);
+        writer.u32(m_hash);
+        m_hash_repeats--;
+    }
+    if (write_inputs(writer, count, [&](int i) { return m_local[(first + i) & WINDOW_MASK]; })) packet[count_at] |= PACKED_FLAG;
+
+    m_socket.send(m_server, packet, writer.size);
+    m_last_send_ms = net_time_ms();
+}
+
+void LockstepClient::submit(uint8_t buttons)
+{
+    if (!m_started || m_local_end - m_race.step >= LOCKSTEP_WINDOW / 2) return;
+
+    m_local[m_local_end & WINDOW_MASK] = buttons;
+    m_local_end++;
+}
+
+RacePlayer LockstepClient::predict_player() const
+{
+    // The predicted race plays our own input for real, so it's as good a start and usually a later one
+    const RaceState& from = m_rollback_steps > 0 && m_predicted.step > m_race.step ? m_predicted : m_race;
+    RacePlayer player = from.players[m_player];
+    for (uint32_t step = from.step; step != m_local_end; step++)
+    {
+        race_step_player(player, step, m_course, m_local[step & WINDOW_MASK], m_settings.physics);
+    }
+    return player;
+}
+
+uint32_t LockstepClient::next_shown_step() const
+{
+    // Now is the step whose input was taken input_delay ticks ago, but it goes no further
+    // past the confirmed race than a frame can afford to play again. It moves a step a
+    // tick like the clock, two while it's catching up, so input arriving in bursts
+    // doesn't make it jump.
+    uint32_t shown = m_predicted.step;
+    uint32_t present = m_local_end - (uint32_t)m_settings.input_delay;
+    uint32_t limit = std::min(present, m_race.step + (uint32_t)m_rollback_steps);
+    return std::min(limit, shown + ((int)(present - shown) > LOCKSTEP_CATCH_UP ? 2 : 1));
+}
+
+void LockstepClient::predict()
+{
+    if (!m_started || m_rollback_steps <= 0) return;
+
+    uint32_t shown = m_predicted.step;
+    uint32_t target = next_shown_step();
+
+    // Behind the confirmed race happens when everyone else's clock is ahead of ours, and needs the copy but isn't a miss
+    bool rolling_back = m_mispredicted && m_predicted.step > m_race.step;
+    if (m_mispredicted || m_predicted.step < m_race.step)
+    {
+        m_predicted = m_race;
+        m_mispredicted = false;
+    }
+
+    const uint8_t* last_confirmed = m_confirmed[(m_confirmed_end - 1) & WINDOW_MASK];
+    int played = 0;
+    for (; m_predicted.step < target; played++)
+    {
+        uint32_t step = m_predicted.step;
+        uint8_t* inputs = m_guessed[step & WINDOW_MASK];
+        if (step < m_confirmed_end) memcpy(inputs, m_confirmed[step & WINDOW_MASK], MAX_RACE_PLAYERS);
+        else
+        {
+            memcpy(inputs, last_confirmed, MAX_RACE_PLAYERS);
+            inputs[m_player] = m_local[step & WINDOW_MASK];
+        }
+        race_step(m_predicted, m_course, inputs, m_settings.physics);
+    }
+    if (m_predicted.step <= shown && !race_finished(m_predicted)) m_stalls++;
+
+    if (!rolling_back) return;
+    m_rollback_stats.rollbacks++;
+    m_rollback_stats.steps_replayed += played;
+    m_rollback_stats.worst_replay = std::max(m_rollback_stats.worst_replay, played);
+}
+
+void LockstepClient::step()
+{
+    if (!can_step()) return;
+
+    uint32_t step = m_race.step;
+    const uint8_t* inputs = m_confirmed[step & WINDOW_MASK];
+    race_step(m_race, m_course, inputs, m_settings.physics);
+
+    // The predicted race has already played this step; if it guessed wrong it has to go back
+    if (m_rollback_steps > 0 && step < m_predicted.step && memcmp(m_guessed[step & WINDOW_MASK], inputs, m_race.player_count) != 0)
+    {
+        m_mispredicted = true;
+    }
+
+    if (m_race.step % LOCKSTEP_HASH_INTERVAL == 0)
+    {
+        m_hash_step = m_race.step;
+        m_hash = race_hash(m_race);
+        m_hash_repeats = LOCKSTEP_HASH_REPEATS;
+    }
+}
+
+bool LockstepServer::start(uint16_t port, const RaceSettings& settings, const NetConditions& conditions, uint32_t conditions_seed)
+{
+    if (!m_socket.open(port)) return false;
+    m_socket.set_conditions(conditions, conditions_seed);
+
+    m_settings = settings;
+    m_settings.player_count = std::min(std::max(settings.player_count, 1), MAX_RACE_PLAYERS);
+    m_settings.input_delay = std::min(std::max(settings.input_delay, 1), LOCKSTEP_WINDOW / 2 - 1);
+
+    m_course.build(m_settings.seed);
+    race_start(m_race, m_course, m_settings.player_count, m_settings.level);
+
+    // The first input_delay steps are empty for everyone, and confirmed from the start
+    memset(m_inputs, 0, sizeof(m_inputs));
+    m_confirmed_end = 0;
+    for (Peer& peer : m_peers)
+    {
+        peer = Peer();
+        peer.received = (uint32_t)m_settings.input_delay;
+    }
+    m_peer_count = 0;
+    m_started = false;
+
+    std::cout << "Waiting for " << m_settings.player_count << " players on port " << port << std::endl;
+    return true;
+}
+
+int LockstepServer::find_peer(const NetAddress& address) const
+{
+    for (int i = 0; i < m_peer_count; i++)
+    {
+        if (m_peers[i].address == address) return i;
+    }
+    return -1;
+}
+
+void LockstepServer::send(int player, const uint8_t* data, int size)
+{
+    m_socket.send(m_peers[player].address, data, size);
+    m_peers[player].bytes_sent += size + NET_PACKET_OVERHEAD;
+}
+
+void LockstepServer::poll()
+{
+    uint8_t buffer[NET_MAX_PACKET];
+    NetAddress from;
+    int size;
+    while ((size = m_socket.receive(from, buffer, sizeof(buffer))) >= 0) handle_packet(from, buffer, size);
+
+    if (!m_started) return;
+
+    uint64_t now = net_time_ms();
+    for (int i = 0; i < m_peer_count; i++)
+    {
+        Peer& peer = m_peers[i];
+        if (peer.dropped || now - peer.last_heard_ms <= LOCKSTEP_TIMEOUT_MS) continue;
+
+        // The race goes on without them, holding nothing down
+        std::cout << "Player " << i + 1 << " timed out, flying on with no input" << std::endl;
+        peer.dropped = true;
+    }
+
+    confirm_steps();
+
+    if (now - m_last_send_ms < LOCKSTEP_SEND_INTERVAL_MS) return;
+    for (int i = 0; i < m_peer_count; i++)
+    {
+        if (m_peers[i].dropped) continue;
+        if (m_peers[i].started) send_confirmed(i);
+        else send_start(i);
+    }
+    m_last_send_ms = now;
+}
+
+void LockstepServer::handle_packet(const NetAddress& from, const uint8_t* data, int size)
+{
+    Reader reader(data, size);
+    uint8_t type = reader.u8();
+    int player = find_peer(from);
+
+    if (player >= 0)
+    {
+        m_peers[player].last_heard_ms = net_time_ms();
+        m_peers[player].bytes_received += size + NET_PACKET_OVERHEAD;
+    }
+
+    if (type == PACKET_HELLO)
+    {
+        // Already in: its START must have gone missing
+        if (player >= 0)
+        {
+            if (m_started) send_start(player);
+            return;
+        }
+        if (m_started || m_peer_count == m_settings.player_count) return;
+
+        Peer& peer = m_peers[m_peer_count++];
+        peer.address = from;
+        peer.last_heard_ms = net_time_ms();
+        peer.bytes_received += size + NET_PACKET_OVERHEAD;
+
+        std::cout << "Player " << m_peer_count << " joined from ";
+        print_address(from);
+        std::cout << std::endl;
+
+        if (m_peer_count < m_settings.player_count) return;
+
+        m_started = true;
+        m_start_ms = net_time_ms();
+        for (int i = 0; i < m_peer_count; i++) send_start(i);
+        std::cout << "Race on, seed " << m_settings.seed << ", " << m_settings.input_delay << " steps of input delay" << std::endl;
+        return;
+    }
+
+    if (type != PACKET_INPUT || player < 0 || reader.u8() != player) return;
+    Peer& peer = m_peers[player];
+
+    uint32_t acked = widen(reader.u16(), peer.acked);
+    uint32_t first = widen(reader.u16(), peer.received);
+    uint8_t count_byte = reader.u8();
+    int count = count_byte & ~(HASH_FLAG | PACKED_FLAG);
+
+    uint32_t hash_step = 0;
+    uint32_t hash = 0;
+    if (count_byte & HASH_FLAG)
+    {
+        hash_step = widen(reader.u16(), m_race.step);
+        hash = reader.u32();
+    }
+
+    uint8_t inputs[LOCKSTEP_MAX_PACKET_STEPS];
+    if (!reader.ok || count > LOCKSTEP_MAX_PACKET_STEPS || !read_inputs(reader, count, (count_byte & PACKED_FLAG) != 0, inputs, 1)) return;
+
+    peer.started = true;
+    if (acked > peer.acked && acked <= m_confirmed_end) peer.acked = acked;
+
+    // Nobody's input can get a whole window ahead of the slowest, or it'd land on steps not confirmed yet
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t step = first + i;
+        if (step != peer.received || step - m_confirmed_end >= LOCKSTEP_WINDOW) continue;
+        m_inputs[step & WINDOW_MASK][player] = inputs[i];
+        peer.received++;
+    }
+
+    // Only hashes for steps this end has stepped, and recently enough that the slot is still theirs
+    if (!(count_byte & HASH_FLAG) || hash_step % LOCKSTEP_HASH_INTERVAL != 0 || hash_step > m_race.step
+        || m_race.step - hash_step >= LOCKSTEP_WINDOW) return;
+    if (hash == m_hashes[(hash_step / LOCKSTEP_HASH_INTERVAL) % HASH_SLOTS]) return;
+
+    if (!peer.desynced)
+    {
+        std::cout << "Player " << player + 1 << " is out of sync at step " << hash_step << std::endl;
+        peer.desynced = true;
+        m_desync_count++;
+    }
+
+    uint8_t packet[3];
+    Writer writer(packet);
+    writer.u8(PACKET_DESYNC);
+    writer.u16((uint16_t)hash_step);
+    send(player, packet, writer.size);
+}
+
+void LockstepServer::confirm_steps()
+{
+    // A step is confirmed once every player still here has sent their input for it
+    uint32_t end = UINT32_MAX;
+    for (int i = 0; i < m_peer_count; i++)
+    {
+        if (!m_peers[i].dropped) end = std::min(end, m_peers[i].received);
+    }
+    if (end == UINT32_MAX) return;
+
+    for (int i = 0; i < m_peer_count; i++)
+    {
+        Peer& peer = m_peers[i];
+        if (!peer.dropped) continue;
+
+        for (uint32_t step = peer.received; step < end; step++) m_inputs[step & WINDOW_MASK][i] = 0;
+        peer.received = std::max(peer.received, end);
+    }
+
+    for (; m_confirmed_end < end; m_confirmed_end++)
+    {
+        if (race_finished(m_race)) continue;
+
+        race_step(m_race, m_course, m_inputs[m_confirmed_end & WINDOW_MASK], m_settings.physics);
+        if (m_race.step % LOCKSTEP_HASH_INTERVAL == 0) m_hashes[(m_race.step / LOCKSTEP_HASH_INTERVAL) % HASH_SLOTS] = race_hash(m_race);
+    }
+}
+
+void LockstepServer::send_start(int player)
+{
+    uint8_t packet[NET_MAX_PACKET];
+    Writer writer(packet);
+    writer.u8(PACKET_START);
+    writer.u8((uint8_t)player);
+    write_settings(writer, m_settings);
+    send(player, packet, writer.size);
+}
+
+void LockstepServer::send_confirmed(int player)
+{
+    const Peer& peer = m_peers[player];
+
+    uint8_t packet[NET_MAX_PACKET];
+    Writer writer(packet);
+
+    uint32_t first = peer.acked;
+    int count = (int)std::min<uint32_t>(m_confirmed_end - first, LOCKSTEP_MAX_PACKET_STEPS);
+
+    writer.u8(PACKET_CONFIRMED);
+    writer.u16((uint16_t)peer.received);
+    writer.u16((uint16_t)first);
+    writer.u8((uint8_t)count);
+
+    // A bit a player, set for the ones that went packed
+    int packed_at = writer.size;
+    writer.u8(0);
+    for (int other = 0; other < m_settings.player_count; other++)
+    {
+        if (other == player) continue;      // it sent them, so it has them
+        if (write_inputs(writer, count, [&](int i) { return m_inputs[(first + i) & WINDOW_MASK][other]; })) packet[packed_at] |= (uint8_t)(1 << other);
+    }
+
+    send(player, packet, writer.size);
+}
+
+bool LockstepServer::is_finished() const
+{
+    if (!m_started || !race_finished(m_race)) return false;
+
+    for (int i = 0; i < m_peer_count; i++)
+    {
+        if (!m_peers[i].dropped && m_peers[i].acked < m_race.step) return false;
+    }
+    return true;
+}
+
+double LockstepServer::get_seconds_running() const
+{
+    return m_started ? (net_time_ms() - m_start_ms) / 1000.0 : 0.0;
+}
+
+double LockstepServer::get_player_bytes_per_second(int player) const
+{
+    double seconds = get_seconds_running();
+    if (seconds <= 0.0 || player >= m_peer_count) return 0.0;
+    return (m_peers[player].bytes_sent + m_peers[player].bytes_received) / seconds;
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include "NetSocket.h"
+#include "RaceSim.h"
+
+constexpr uint16_t LOCKSTEP_PORT = 27960;
+constexpr int LOCKSTEP_INPUT_DELAY = 10;        // steps between pressing something and the step it lands on
+constexpr int LOCKSTEP_SEND_INTERVAL_MS = 100;  // each end sends 10 packets a second, whatever's in them
+constexpr int LOCKSTEP_CATCH_UP = 6;            // more steps ready than this, and a tick plays two
+constexpr int LOCKSTEP_HELLO_INTERVAL_MS = 250;
+constexpr int LOCKSTEP_TIMEOUT_MS = 5000;       // silence for this long and the other end is gone
+
+constexpr int LOCKSTEP_WINDOW = 256;            // steps of input kept, a power of two
+constexpr int LOCKSTEP_MAX_PACKET_STEPS = 63;   // at most this many steps resent in one packet, under the flags on its count
+constexpr int LOCKSTEP_HASH_INTERVAL = 60;      // steps between desync checks
+constexpr int LOCKSTEP_HASH_REPEATS = 3;        // packets each hash rides on, in case some are lost
+constexpr int LOCKSTEP_ROLLBACK_STEPS = 10;     // with rollback, the furthest the shown race guesses past the confirmed one
+
+/**
+ * Deterministic lockstep for a race, through a server. Every peer runs the
+ * whole race itself on everyone's inputs, so nothing but input goes over the
+ * wire: a 3-bit InputButton mask a player per step, run-length coded, since it
+ * rarely changes from one step to the next. Anyone who changes it every step
+ * or two has theirs packed 3 bits a step instead, when that comes out shorter.
+ *
+ * Input is taken on the local clock, one a tick, and what's pressed on tick t is
+ * played on step t + input_delay, which gives it that long to reach everyone
+ * else before anyone needs it. A client only steps once the server has sent
+ * every player's input for that step, so a late packet stalls it rather than
+ * letting it guess. If the round trip is longer than the delay, the race just
+ * runs that much behind the clock, still at full rate, instead of stalling
+ * every few steps.
+ *
+ * Packets go out on a timer, not per step, since the UDP and IP headers are
+ * most of a packet, and each one repeats everything the other end hasn't
+ * acknowledged yet, so a lost or reordered one costs nothing but the wait for
+ * the next. Steps go over the wire as their low 16 bits.
+ *
+ * Every LOCKSTEP_HASH_INTERVAL steps a client sends race_hash() of its state,
+ * and the server, which steps its own copy, says so if it doesn't match.
+ *
+ * A client can also roll back, which shows a second, predicted race rather
+ * than waiting on the confirmed one: it runs up to now on everyone else's input
+ * guessed as whatever they last held. When the real input turns up and a guess
+ * was wrong, the predicted race goes back to the confirmed one, which is a copy
+ * of a few hundred bytes, and plays the steps since again. Only the confirmed
+ * race is ever hashed, so guessing never looks like a desync.
+ */
+
+// A race's settings, the same for everyone; the server's config wins over the clients'
+struct RaceSettings
+{
+    uint32_t seed = 1969;
+    int player_count = 2;
+    int input_delay = LOCKSTEP_INPUT_DELAY;
+    PhysicsParams physics;
+    LevelParams level;
+};
+
+struct RollbackStats
+{
+    int rollbacks = 0;
+    uint64_t steps_replayed = 0;
+    int worst_replay = 0;                       // steps, in one go
+};
+
+class LockstepClient
+{
+private:
+    NetSocket m_socket;
+    NetAddress m_server;
+    bool m_started = false;
+    int m_player = -1;
+    RaceSettings m_settings;
+
+    RaceCourse m_course;
+    RaceState m_race;
+
+    uint8_t m_local[LOCKSTEP_WINDOW] = {};                      // this player's, by step
+    uint32_t m_local_end = 0;                                   // steps before this have local input
+    uint32_t m_server_received = 0;                             // the server has our input for steps before this
+
+    uint8_t m_confirmed[LOCKSTEP_WINDOW][MAX_RACE_PLAYERS] = {}; // everyone's, by step
+    uint32_t m_confirmed_end = 0;
+
+    uint32_t m_hash_step = 0;
+    uint32_t m_hash = 0;
+    int m_hash_repeats = 0;
+
+    uint64_t m_last_send_ms = 0;
+    uint64_t m_last_heard_ms = 0;
+    bool m_desynced = false;
+    bool m_timed_out = false;
+    int m_stalls = 0;
+
+    int m_rollback_steps = 0;                                   // 0 is plain lockstep
+    RaceState m_predicted;
+    uint8_t m_guessed[LOCKSTEP_WINDOW][MAX_RACE_PLAYERS] = {};  // what each predicted step was played on
+    bool m_mispredicted = false;
+    RollbackStats m_rollback_stats;
+
+    void handle_packet(const uint8_t* data, int size);
+    void send_input();
+
+    // With rollback, where the shown race gets to this tick
+    uint32_t next_shown_step() const;
+
+public:
+    bool connect(const char* address, const NetConditions& conditions = NetConditions(), uint32_t conditions_seed = 0);
+    void close() { m_socket.close(); };
+
+    // Reads everything that's arrived and sends whatever's due. Call it at least once a frame.
+    void poll();
+
+    // Everyone's input for the next step is here. Rolling back, the confirmed race also
+    // waits for the shown one, or input from clocks ahead of ours would make that jump.
+    bool can_step() const
+    {
+        return m_started && m_race.step < m_confirmed_end && !race_finished(m_race)
+            && (m_rollback_steps == 0 || m_race.step < next_shown_step());
+    };
+
+    // How far the confirmed input runs ahead of the race; more than the delay means this end is behind
+    int get_steps_ready() const { return (int)(m_confirmed_end - m_race.step); };
+
+    // This player as they'll be once everything they've submitted has played,
+    // which is exact, since nobody else's input can change it
+    RacePlayer predict_player() const;
+
+    // This tick's input, for the step input_delay ticks from now. Dropped if the
+    // race has fallen half a window behind the clock, waiting on someone.
+    void submit(uint8_t buttons);
+
+    // Plays the next step on everyone's input
+    void step();
+
+    // For when the race can't step this tick
+    void count_stall() { m_stalls++; };
+
+    // Guess up to max_steps past the confirmed race, or 0 not to guess at all. Before the race starts.
+    void set_rollback(int max_steps) { m_rollback_steps = std::max(0, std::min(max_steps, LOCKSTEP_WINDOW / 2)); };
+    bool is_rolling_back() const { return m_rollback_steps > 0; };
+
+    // With rollback on, once a tick after the confirmed steps: brings the predicted race
+    // up to now, going back to the confirmed one first if it was played on a wrong guess
+    void predict();
+
+    bool is_started()   const { return m_started;   };
+    bool is_desynced()  const { return m_desynced;  };
+    bool is_timed_out() const { return m_timed_out; };
+    int const get_player() const { return m_player; };
+    int const get_stalls() const { return m_stalls; };
+    const RaceSettings& get_settings() const { return m_settings; };
+    const RaceCourse& get_course()     const { return m_course;   };
+    const RaceState& get_race()        const { return m_race;     };
+    const RaceState& get_predicted()   const { return m_predicted; };
+    const NetStats& get_net_stats()    const { return m_socket.get_stats(); };
+    const RollbackStats& get_rollback_stats() const { return m_rollback_stats; };
+};
+
+class LockstepServer
+{
+private:
+    struct Peer
+    {
+        NetAddress address;
+        bool started = false;               // has sent input, so it has the START
+        bool dropped = false;
+        bool desynced = false;
+        uint32_t received = 0;              // its input for steps before this is here
+        uint32_t acked = 0;                 // it has everyone's input for steps before this
+        uint64_t last_heard_ms = 0;
+        uint64_t bytes_sent = 0;            // with NET_PACKET_OVERHEAD, like NetStats
+        uint64_t bytes_received = 0;
+    };
+
+    NetSocket m_socket;
+    RaceSettings m_settings;
+    Peer m_peers[MAX_RACE_PLAYERS];
+    int m_peer_count = 0;
+    bool m_started = false;
+    uint64_t m_start_ms = 0;
+    uint64_t m_last_send_ms = 0;
+
+    uint8_t m_inputs[LOCKSTEP_WINDOW][MAX_RACE_PLAYERS] = {};
+    uint32_t m_confirmed_end = 0;
+
+    // Its own copy of the race, to check everyone else's against
+    RaceCourse m_course;
+    RaceState m_race;
+    uint32_t m_hashes[LOCKSTEP_WINDOW / LOCKSTEP_HASH_INTERVAL + 1] = {};
+    int m_desync_count = 0;
+
+    int find_peer(const NetAddress& address) const;
+    void handle_packet(const NetAddress& from, const uint8_t* data, int size);
+    void confirm_steps();
+    void send_start(int player);
+    void send_confirmed(int player);
+    void send(int player, const uint8_t* data, int size);
+
+public:
+    bool start(uint16_t port, const RaceSettings& settings, const NetConditions& conditions = NetConditions(), uint32_t conditions_seed = 0);
+    void close() { m_socket.close(); };
+
+    void poll();
+
+    // The race is over and every client that's still there has all of it
+    bool is_finished() const;
+
+    bool is_started() const { return m_started; };
+    int const get_desync_count() const { return m_desync_count; };
+    double get_seconds_running() const;
+
+    // Both ways, including UDP and IP headers
+    double get_player_bytes_per_second(int player) const;
+
+    const RaceState& get_race() const { return m_race; };
+};
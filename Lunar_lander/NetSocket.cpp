@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "NetSocket.h"
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    typedef int socklen_t;
+    typedef SOCKET NativeSocket;
+#else
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    typedef int NativeSocket;
+#endif
+
+namespace
+{
+#ifdef _WIN32
+    // Winsock wants starting once per process, before anything else touches it
+    bool start_sockets()
+    {
+        static bool started = false;
+        if (started) return true;
+
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) return false;
+        started = true;
+        return true;
+    }
+#else
+    bool start_sockets() { return true; }
+#endif
+
+    // Kept as an intptr_t in the header, so nothing else has to include the socket headers
+    NativeSocket native(intptr_t handle) { return (NativeSocket)handle; }
+
+    sockaddr_in to_sockaddr(const NetAddress& address)
+    {
+        sockaddr_in result;
+        memset(&result, 0, sizeof(result));
+        result.sin_family = AF_INET;
+        result.sin_addr.s_addr = htonl(address.host);
+        result.sin_port = htons(address.port);
+        return result;
+    }
+}
+
+uint64_t net_time_ms()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool resolve_address(const char* text, uint16_t default_port, NetAddress& address)
+{
+    if (!start_sockets()) return false;
+
+    std::string host = text;
+    address.port = default_port;
+
+    size_t colon = host.rfind(':');
+    if (colon != std::string::npos)
+    {
+        address.port = (uint16_t)atoi(host.c_str() + colon + 1);
+        host.resize(colon);
+    }
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0 || found == nullptr)
+    {
+        std::cout << "Couldn't find " << host << std::endl;
+        return false;
+    }
+
+    address.host = ntohl(reinterpret_cast<sockaddr_in*>(found->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(found);
+    return true;
+}
+
+bool NetSocket::open(uint16_t port)
+{
+    close();
+    if (!start_sockets()) return false;
+
+    m_socket = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (m_socket == -1)
+    {
+        std::cout << "Couldn't make a UDP socket" << std::endl;
+        return false;
+    }
+
+    sockaddr_in local = to_sockaddr(NetAddress());
+    local.sin_port = htons(port);
+    if (bind(native(m_socket), (sockaddr*)&local, sizeof(local)) != 0)
+    {
+        std::cout << "Couldn't listen on port " << port << std::endl;
+        close();
+        return false;
+    }
+
+#ifdef _WIN32
+    u_long non_blocking = 1;
+    ioctlsocket(native(m_socket), FIONBIO, &non_blocking);
+#else
+    fcntl(native(m_socket), F_SETFL, fcntl(native(m_socket), F_GETFL, 0) | O_NONBLOCK);
+#endif
+    return true;
+}
+
+void NetSocket::close()
+{
+    if (m_socket == -1) return;
+
+#ifdef _WIN32
+    closesocket(native(m_socket));
+#else
+    ::close(native(m_socket));
+#endif
+    m_socket = -1;
+    m_delayed.clear();
+}
+
+void NetSocket::set_conditions(const NetConditions& conditions, uint32_t seed)
+{
+    m_conditions = conditions;
+    m_random = seed != 0 ? seed : 0x9e3779b9u;
+}
+
+float NetSocket::random_unit()
+{
+    // xorshift32
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return (m_random >> 8) * (1.0f / 16777216.0f);
+}
+
+void NetSocket::send_now(const NetAddress& address, const uint8_t* data, int size)
+{
+    sockaddr_in to = to_sockaddr(address);
+    sendto(native(m_socket), (const char*)data, size, 0, (sockaddr*)&to, sizeof(to));
+}
+
+void NetSocket::send_due()
+{
+    if (m_delayed.empty()) return;
+
+    // Only a handful are ever in flight, so a scan beats keeping them sorted
+    uint64_t now = net_time_ms();
+    for (size_t i = 0; i < m_delayed.size();)
+    {
+        if (m_delayed[i].due_ms > now)
+        {
+            i++;
+            continue;
+        }
+        send_now(m_delayed[i].address, m_delayed[i].data, m_delayed[i].size);
+        m_delayed[i] = m_delayed.back();
+        m_delayed.pop_back();
+    }
+}
+
+void NetSocket::send(const NetAddress& address, const uint8_t* data, int size)
+{
+    if (m_socket == -1 || size > NET_MAX_PACKET) return;
+
+    m_stats.packets_sent++;
+    m_stats.bytes_sent += size + NET_PACKET_OVERHEAD;
+
+    if (m_conditions.loss > 0.0f && random_unit() < m_conditions.loss)
+    {
+        m_stats.packets_lost++;
+        return;
+    }
+
+    int delay = m_conditions.latency_ms + (int)(random_unit() * m_conditions.jitter_ms);
+    if (delay <= 0)
+    {
+        send_now(address, data, size);
+        return;
+    }
+
+    DelayedPacket packet;
+    packet.due_ms = net_time_ms() + delay;
+    packet.address = address;
+    packet.size = size;
+    memcpy(packet.data, data, size);
+    m_delayed.push_back(packet);
+    send_due();
+}
+
+int NetSocket::receive(NetAddress& address, uint8_t* buffer, int capacity)
+{
+    if (m_socket == -1) return -1;
+    send_due();
+
+    sockaddr_in from;
+    socklen_t from_size = sizeof(from);
+    int size = (int)recvfrom(native(m_socket), (char*)buffer, capacity, 0, (sockaddr*)&from, &from_size);
+    if (size < 0) return -1;
+
+    address.host = ntohl(from.sin_addr.s_addr);
+    address.port = ntohs(from.sin_port);
+    m_stats.packets_received++;
+    m_stats.bytes_received += size + NET_PACKET_OVERHEAD;
+    return size;
+}
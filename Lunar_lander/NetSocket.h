@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+constexpr int NET_MAX_PACKET = 512;             // far more than any packet the lockstep sends
+constexpr int NET_PACKET_OVERHEAD = 28;         // IPv4 and UDP headers, counted in the stats as they're what the wire carries
+
+// IPv4, both in host order
+struct NetAddress
+{
+    uint32_t host = 0;
+    uint16_t port = 0;
+
+    bool operator==(const NetAddress& other) const { return host == other.host && port == other.port; };
+};
+
+// "host" or "host:port", by name or dotted quad
+bool resolve_address(const char* text, uint16_t default_port, NetAddress& address);
+
+// A bad network, put on purpose between this socket and the real one. Outgoing
+// packets are held back for latency plus up to jitter, which reorders them, and
+// a fraction of them never go at all.
+struct NetConditions
+{
+    int latency_ms = 0;
+    int jitter_ms = 0;
+    float loss = 0.0f;
+};
+
+struct NetStats
+{
+    uint64_t packets_sent = 0;
+    uint64_t packets_received = 0;
+    uint64_t bytes_sent = 0;                    // with NET_PACKET_OVERHEAD on each
+    uint64_t bytes_received = 0;
+    uint64_t packets_lost = 0;                  // thrown away by the NetConditions
+};
+
+/**
+ * A non-blocking UDP socket. Nothing in here waits: receive() returns straight
+ * away when there's nothing to read, and sends delayed by the conditions go out
+ * from whichever of send() or receive() is called once they're due, so polling
+ * receive() every frame is enough to keep them moving.
+ */
+class NetSocket
+{
+private:
+    struct DelayedPacket
+    {
+        uint64_t due_ms;
+        NetAddress address;
+        int size;
+        uint8_t data[NET_MAX_PACKET];
+    };
+
+    intptr_t m_socket = -1;
+    NetConditions m_conditions;
+    std::vector<DelayedPacket> m_delayed;
+    uint32_t m_random = 0x9e3779b9u;
+    NetStats m_stats;
+
+    float random_unit();
+    void send_now(const NetAddress& address, const uint8_t* data, int size);
+    void send_due();
+
+public:
+    NetSocket() {}
+    NetSocket(const NetSocket&) = delete;
+    NetSocket& operator=(const NetSocket&) = delete;
+    ~NetSocket() { close(); };
+
+    // Port 0 takes whatever's free
+    bool open(uint16_t port);
+    void close();
+    bool is_open() const { return m_socket != -1; };
+
+    // Seeded so a test run loses the same packets every time
+    void set_conditions(const NetConditions& conditions, uint32_t seed);
+
+    void send(const NetAddress& address, const uint8_t* data, int size);
+
+    // Size of the packet, or -1 if there isn't one
+    int receive(NetAddress& address, uint8_t* buffer, int capacity);
+
+    const NetStats& get_stats() const { return m_stats; };
+};
+
+// Milliseconds on a clock that only goes forward, for timeouts and resends
+uint64_t net_time_ms();
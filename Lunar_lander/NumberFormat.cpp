@@ -0,0 +1,64 @@
+#include <cmath>
+#include "NumberFormat.h"
+
+namespace
+{
+    constexpr int MAX_DECIMALS = 6;
+    constexpr int64_t POWERS_OF_TEN[MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+    void fill_overflow(char* out, int width)
+    {
+        for (int i = 0; i < width; i++) out[i] = '#';
+    }
+
+    // `scaled` is the value times 10^decimals
+    void format_scaled(char* out, int width, int64_t scaled, int decimals)
+    {
+        bool negative = scaled < 0;
+        uint64_t magnitude = negative ? 0 - (uint64_t)scaled : (uint64_t)scaled;
+
+        // Always a digit before the point, so 0.05 rather than .05
+        int digits = 1;
+        for (uint64_t rest = magnitude / 10; rest != 0; rest /= 10) digits++;
+        if (digits < decimals + 1) digits = decimals + 1;
+
+        int length = digits + (decimals > 0 ? 1 : 0) + (negative ? 1 : 0);
+        if (length > width)
+        {
+            fill_overflow(out, width);
+            return;
+        }
+
+        // Digits go in from the right
+        int position = width - 1;
+        for (int i = 0; i < digits; i++)
+        {
+            if (i == decimals && decimals > 0) out[position--] = '.';
+            out[position--] = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+        }
+        if (negative) out[position--] = '-';
+        while (position >= 0) out[position--] = ' ';
+    }
+}
+
+void format_int(char* out, int width, int64_t value)
+{
+    format_scaled(out, width, value, 0);
+}
+
+void format_fixed(char* out, int width, float value, int decimals)
+{
+    if (decimals < 0) decimals = 0;
+    if (decimals > MAX_DECIMALS) decimals = MAX_DECIMALS;
+
+    // Way past anything a slot could show; keeps the conversion defined
+    double scaled = (double)value * (double)POWERS_OF_TEN[decimals];
+    if (!(fabs(scaled) < 1e17))
+    {
+        fill_overflow(out, width);
+        return;
+    }
+
+    format_scaled(out, width, (int64_t)llround(scaled), decimals);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Number formatting for things redrawn every frame. Writes into the caller's
+ * buffer, right-aligned in exactly `width` characters with spaces in front and
+ * no terminator, so a readout always covers the same slots on screen. Anything
+ * too wide for its slot comes out as all '#'. No printf, no strings, no heap.
+ */
+
+void format_int(char* out, int width, int64_t value);
+
+// `decimals` digits after the point, rounded half away from zero
+void format_fixed(char* out, int width, float value, int decimals);
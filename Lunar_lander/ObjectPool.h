@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Index in the low 16 bits, generation in the high 16. Generations start at 1,
+// so a zeroed handle never refers to anything.
+struct PoolHandle
+{
+    uint32_t value = 0;
+
+    bool const is_null() const { return value == 0; };
+    bool operator==(PoolHandle other) const { return value == other.value; };
+    bool operator!=(PoolHandle other) const { return value != other.value; };
+};
+
+constexpr int MAX_POOL_CAPACITY = 0xFFFF;
+
+/**
+ * Fixed-capacity storage for objects that get created and destroyed a lot. Every
+ * slot is allocated up front in one block, create and destroy are O(1) off a free
+ * list, and objects never move, so a pointer stays good for as long as the object
+ * does. Anything that holds on to an object across frames should keep the handle
+ * instead; when the slot is reused its generation changes, and the old handle
+ * stops resolving.
+ */
+template <typename T>
+class ObjectPool
+{
+private:
+    static constexpr uint16_t NO_SLOT = 0xFFFF;
+
+    struct Slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        uint16_t generation = 1;
+        uint16_t next_free = NO_SLOT;
+        bool alive = false;
+    };
+
+    std::vector<Slot> m_slots;
+    uint16_t m_free_head = NO_SLOT;
+    int m_count = 0;
+
+    T* object_in(Slot& slot) { return reinterpret_cast<T*>(slot.storage); }
+
+    Slot* find_slot(PoolHandle handle)
+    {
+        uint32_t index = handle.value & 0xFFFF;
+        uint16_t generation = (uint16_t)(handle.value >> 16);
+
+        if (index >= m_slots.size() || !m_slots[index].alive || m_slots[index].generation != generation)
+        {
+#ifndef NDEBUG
+            // Anything but a null handle getting here means someone kept a handle past its object
+            if (!handle.is_null())
+            {
+                std::cout << "Stale pool handle " << std::hex << handle.value << std::dec << std::endl;
+                assert(false && "stale pool handle");
+            }
+#endif
+            return nullptr;
+        }
+
+        return &m_slots[index];
+    }
+
+public:
+    ObjectPool() {}
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+    ~ObjectPool() { clear(); }
+
+    // The only allocation the pool ever makes
+    void init(int capacity)
+    {
+        clear();
+        if (capacity > MAX_POOL_CAPACITY) capacity = MAX_POOL_CAPACITY;
+
+        m_slots = std::vector<Slot>(capacity);
+        m_free_head = capacity > 0 ? 0 : NO_SLOT;
+        for (int i = 0; i < capacity; i++) m_slots[i].next_free = i + 1 < capacity ? (uint16_t)(i + 1) : NO_SLOT;
+    }
+
+    // Builds a T in a free slot from whatever T's constructor takes. Null handle if the pool is full.
+    template <typename... Args>
+    PoolHandle create(Args&&... args)
+    {
+        if (m_free_head == NO_SLOT)
+        {
+            std::cout << "Object pool is full (" << m_slots.size() << ")" << std::endl;
+            return PoolHandle();
+        }
+
+        uint16_t index = m_free_head;
+        Slot& slot = m_slots[index];
+        m_free_head = slot.next_free;
+
+        new (slot.storage) T(std::forward<Args>(args)...);
+        slot.alive = true;
+        m_count++;
+
+        return { ((uint32_t)slot.generation << 16) | index };
+    }
+
+    void destroy(PoolHandle handle)
+    {
+        Slot* slot = find_slot(handle);
+        if (slot == nullptr) return;
+
+        object_in(*slot)->~T();
+        slot->alive = false;
+
+        // Skip 0 on wrap-around so that a reused slot never hands out a null handle
+        if (++slot->generation == 0) slot->generation = 1;
+
+        slot->next_free = m_free_head;
+        m_free_head = (uint16_t)(slot - m_slots.data());
+        m_count--;
+    }
+
+    // Null if the handle is stale (and in debug builds, a complaint and an assert)
+    T* get(PoolHandle handle)
+    {
+        Slot* slot = find_slot(handle);
+        return slot != nullptr ? object_in(*slot) : nullptr;
+    }
+
+    // Checks without complaining, for code that expects handles to go stale
+    bool is_alive(PoolHandle handle) const
+    {
+        uint32_t index = handle.value & 0xFFFF;
+        return index < m_slots.size() && m_slots[index].alive && m_slots[index].generation == (uint16_t)(handle.value >> 16);
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < m_slots.size(); i++)
+        {
+            Slot& slot = m_slots[i];
+            if (slot.alive) destroy({ ((uint32_t)slot.generation << 16) | (uint32_t)i });
+        }
+    }
+
+    int const get_count()    const { return m_count;               };
+    int const get_capacity() const { return (int)m_slots.size();   };
+};
@@ -0,0 +1,204 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "ParticleSystem.h"
+#include "RenderBackend.h"
+#include "StreamBuffer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LUNAR_USE_SSE2 1
+#endif
+
+#ifndef GL_VERTEX_PROGRAM_POINT_SIZE
+#define GL_VERTEX_PROGRAM_POINT_SIZE 0x8642
+#endif
+#ifndef GL_POINT_SPRITE
+#define GL_POINT_SPRITE 0x8861
+#endif
+
+void ParticleSystem::init(int capacity)
+{
+    m_capacity = capacity;
+    m_count = 0;
+
+    // A few floats of slack on the end so the SIMD loops can run past the last
+    // live particle into the padding instead of needing a scalar tail
+    m_positions.assign((size_t)capacity * 2 + 4, 0.0f);
+    m_velocities.assign((size_t)capacity * 2 + 4, 0.0f);
+    m_life.assign((size_t)capacity + 4, 0.0f);
+    m_decay.assign((size_t)capacity + 4, 0.0f);
+    m_sizes.assign((size_t)capacity + 4, 0.0f);
+}
+
+void ParticleSystem::upload(StreamBuffer* stream)
+{
+    m_stream = stream;
+    m_vertex_array = create_vertex_array();
+}
+
+void ParticleSystem::release()
+{
+    delete_vertex_array(m_vertex_array);
+    m_stream = nullptr;
+}
+
+float ParticleSystem::random_unit()
+{
+    // xorshift32, plenty for scattering sparks and a lot cheaper than <random>
+    m_random_state ^= m_random_state << 13;
+    m_random_state ^= m_random_state >> 17;
+    m_random_state ^= m_random_state << 5;
+    return (m_random_state >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleSystem::emit(const ParticleEmitter& emitter, int count)
+{
+    float base_angle = atan2f(emitter.velocity.y, emitter.velocity.x);
+    float base_speed = sqrtf(emitter.velocity.x * emitter.velocity.x + emitter.velocity.y * emitter.velocity.y);
+
+    for (int i = 0; i < count && m_count < m_capacity; i++)
+    {
+        int p = m_count++;
+
+        float angle = base_angle + (random_unit() * 2.0f - 1.0f) * emitter.spread;
+        float speed = base_speed * (1.0f + (random_unit() * 2.0f - 1.0f) * emitter.speed_jitter);
+
+        m_positions[p * 2] = emitter.position.x + (random_unit() * 2.0f - 1.0f) * emitter.position_jitter;
+        m_positions[p * 2 + 1] = emitter.position.y + (random_unit() * 2.0f - 1.0f) * emitter.position_jitter;
+        m_velocities[p * 2] = cosf(angle) * speed;
+        m_velocities[p * 2 + 1] = sinf(angle) * speed;
+
+        // Staggered lifetimes so a burst fades out rather than vanishing all at once
+        m_life[p] = 1.0f;
+        m_decay[p] = 1.0f / (emitter.lifetime * (0.75f + 0.5f * random_unit()));
+        m_sizes[p] = emitter.size;
+    }
+}
+
+void ParticleSystem::kill(int index)
+{
+    int last = --m_count;
+
+    m_positions[index * 2] = m_positions[last * 2];
+    m_positions[index * 2 + 1] = m_positions[last * 2 + 1];
+    m_velocities[index * 2] = m_velocities[last * 2];
+    m_velocities[index * 2 + 1] = m_velocities[last * 2 + 1];
+    m_life[index] = m_life[last];
+    m_decay[index] = m_decay[last];
+    m_sizes[index] = m_sizes[last];
+}
+
+void ParticleSystem::shift_origin(glm::vec2 offset)
+{
+    for (int i = 0; i < m_count; i++)
+    {
+        m_positions[i * 2] -= offset.x;
+        m_positions[i * 2 + 1] -= offset.y;
+    }
+}
+
+void ParticleSystem::update(float delta_time)
+{
+    if (m_count == 0) return;
+
+    float drag = powf(PARTICLE_DRAG, delta_time);
+    float* positions = m_positions.data();
+    float* velocities = m_velocities.data();
+    float* life = m_life.data();
+    const float* decay = m_decay.data();
+
+#ifdef LUNAR_USE_SSE2
+    // Two particles per register for the x, y pairs, four per register for life
+    const __m128 gravity = _mm_set_ps(PARTICLE_GRAVITY * delta_time, 0.0f, PARTICLE_GRAVITY * delta_time, 0.0f);
+    const __m128 drag4 = _mm_set1_ps(drag);
+    const __m128 dt4 = _mm_set1_ps(delta_time);
+
+    for (int i = 0; i < m_count * 2; i += 4)
+    {
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(velocities + i), gravity), drag4);
+        __m128 p = _mm_add_ps(_mm_loadu_ps(positions + i), _mm_mul_ps(v, dt4));
+        _mm_storeu_ps(velocities + i, v);
+        _mm_storeu_ps(positions + i, p);
+    }
+
+    for (int i = 0; i < m_count; i += 4)
+    {
+        __m128 l = _mm_sub_ps(_mm_loadu_ps(life + i), _mm_mul_ps(_mm_loadu_ps(decay + i), dt4));
+        _mm_storeu_ps(life + i, l);
+    }
+#else
+    for (int i = 0; i < m_count; i++)
+    {
+        velocities[i * 2] *= drag;
+        velocities[i * 2 + 1] = (velocities[i * 2 + 1] + PARTICLE_GRAVITY * delta_time) * drag;
+        positions[i * 2] += velocities[i * 2] * delta_time;
+        positions[i * 2 + 1] += velocities[i * 2 + 1] * delta_time;
+        life[i] -= decay[i] * delta_time;
+    }
+#endif
+
+    // Dead ones get the last live particle swapped in, which then needs checking itself
+    for (int i = 0; i < m_count;)
+    {
+        if (life[i] <= 0.0f) kill(i);
+        else i++;
+    }
+}
+
+void ParticleSystem::render()
+{
+    if (m_count == 0 || m_stream == nullptr) return;
+
+    // The sprites and text are already in this frame's segment, so if they've
+    // left less room than the pool needs, draw as many as fit in what's left
+    int drawn = (int)std::min((size_t)m_count, m_stream->remaining() / PARTICLE_VERTEX_BYTES);
+    if (drawn == 0) return;
+
+    size_t position_bytes = (size_t)drawn * 2 * sizeof(float);
+    size_t scalar_bytes = (size_t)drawn * sizeof(float);
+
+    char* data = (char*)m_stream->reserve(position_bytes + scalar_bytes * 2);
+    if (data == nullptr) return;
+
+    // The simulation arrays aren't laid out for GL, so this one copy is the upload
+    memcpy(data, m_positions.data(), position_bytes);
+    memcpy(data + position_bytes, m_life.data(), scalar_bytes);
+    memcpy(data + position_bytes + scalar_bytes, m_sizes.data(), scalar_bytes);
+    size_t offset = (size_t)m_stream->commit(position_bytes + scalar_bytes * 2);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_stream->get_buffer());
+
+    // The offsets move every frame, so the pointers get set every frame either way
+    if (m_vertex_array != 0) bind_vertex_array(m_vertex_array);
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, false, 0, (const void*)offset);
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glVertexAttribPointer(ATTRIBUTE_LIFE, 1, GL_FLOAT, false, 0, (const void*)(offset + position_bytes));
+    glEnableVertexAttribArray(ATTRIBUTE_LIFE);
+    glVertexAttribPointer(ATTRIBUTE_SIZE, 1, GL_FLOAT, false, 0, (const void*)(offset + position_bytes + scalar_bytes));
+    glEnableVertexAttribArray(ATTRIBUTE_SIZE);
+
+    // Points are always sprites in a core context, and asking for GL_POINT_SPRITE there is an error
+    bool legacy = get_render_backend() == RENDER_BACKEND_LEGACY;
+    glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    if (legacy) glEnable(GL_POINT_SPRITE);
+
+    glDrawArrays(GL_POINTS, 0, drawn);
+
+    if (legacy) glDisable(GL_POINT_SPRITE);
+    glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(0);
+    }
+    else
+    {
+        glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+        glDisableVertexAttribArray(ATTRIBUTE_LIFE);
+        glDisableVertexAttribArray(ATTRIBUTE_SIZE);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
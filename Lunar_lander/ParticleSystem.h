@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "glm/vec2.hpp"
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+
+// Position, life and size, as they go into the StreamBuffer
+constexpr size_t PARTICLE_VERTEX_BYTES = 4 * sizeof(float);
+
+// Far more than play ever has live, and a full pool still only takes half a
+// frame's stream, leaving the other half for the sprites and text drawn first
+constexpr int MAX_PARTICLES = 1 << 17;
+static_assert(MAX_PARTICLES * PARTICLE_VERTEX_BYTES <= STREAM_BUFFER_SEGMENT_SIZE / 2, "A full particle pool has to fit in half a stream segment");
+
+constexpr float PARTICLE_GRAVITY = -0.5f;  // matches the pull on the ship
+constexpr float PARTICLE_DRAG = 0.98f;     // per second, applied to velocity
+
+// What a burst of particles looks like when it's spawned
+struct ParticleEmitter
+{
+    glm::vec2 position;
+    glm::vec2 velocity;          // centre of the spray
+    float spread;                // radians either side of velocity
+    float speed_jitter;          // fraction of the speed each particle can gain or lose
+    float position_jitter;       // world units
+    float lifetime;              // seconds
+    float size;                  // pixels
+};
+
+/**
+ * A fixed pool of particles stored as separate arrays, one per field. The live
+ * particles are always packed at the front, so the update walks straight through
+ * the arrays four lanes at a time, and the positions can be handed to GL as they
+ * are and drawn with a single glDrawArrays(GL_POINTS). Each frame the live part
+ * of the position, life and size arrays is copied into the StreamBuffer, back to back.
+ */
+class ParticleSystem
+{
+private:
+    int m_capacity = 0;
+    int m_count = 0;
+
+    // Positions and velocities are stored as x, y pairs so they line up with each other
+    // in the SIMD loop and the position array is already a valid vertex stream
+    std::vector<float> m_positions;
+    std::vector<float> m_velocities;
+    std::vector<float> m_life;    // 1 when born, dead at 0
+    std::vector<float> m_decay;   // life lost per second, 1 / lifetime
+    std::vector<float> m_sizes;
+
+    uint32_t m_random_state = 0x9e3779b9u;
+
+    StreamBuffer* m_stream = nullptr;
+    GLuint m_vertex_array = 0;   // 0 where there are no vertex arrays
+
+    float random_unit();   // [0, 1)
+    void kill(int index);  // moves the last live particle into `index`
+
+public:
+    // Allocates the whole pool up front, nothing allocates after this
+    void init(int capacity = MAX_PARTICLES);
+
+    // GL side, needs a context and the stream already set up
+    void upload(StreamBuffer* stream);
+    void release();
+
+    // Spawns up to `count` particles, fewer if the pool is full
+    void emit(const ParticleEmitter& emitter, int count);
+
+    void update(float delta_time);
+    void shift_origin(glm::vec2 offset);   // for when the world's origin moves
+    // With the particle program bound and additive blending already set, the RenderQueue does both
+    void render();
+
+    int const get_count()    const { return m_count;    };
+    int const get_capacity() const { return m_capacity; };
+};
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include "glm/geometric.hpp"
+#include "RaceSim.h"
+#include "Heightfield.h"
+#include "ConvexHull.h"     // for SOFT_LANDING_MAX_SPEED, the solo game's landing rule
+
+void RaceCourse::build(uint32_t course_seed)
+{
+    seed = course_seed;
+    start_x = 0.0f;
+    pad_x = (float)landing_pad_centre(seed, RACE_PAD_CELL);
+    origin_x = start_x - RACE_COURSE_MARGIN;
+
+    // Highest of the ground under the middle and both edges of the ship
+    int samples = (int)((pad_x + RACE_COURSE_MARGIN - origin_x) / RACE_GROUND_SPACING) + 1;
+    ground.resize(samples);
+    for (int i = 0; i < samples; i++)
+    {
+        double x = origin_x + (double)i * RACE_GROUND_SPACING;
+        ground[i] = std::max(terrain_height(seed, x),
+            std::max(terrain_height(seed, x - RACE_SHIP_HALF_WIDTH), terrain_height(seed, x + RACE_SHIP_HALF_WIDTH)));
+    }
+}
+
+bool RaceCourse::in_range(float x) const
+{
+    return x > origin_x && x < origin_x + (ground.size() - 1) * RACE_GROUND_SPACING;
+}
+
+float RaceCourse::ground_at(float x) const
+{
+    float t = std::max(0.0f, (x - origin_x) / RACE_GROUND_SPACING);
+    int i = std::min((int)t, (int)ground.size() - 2);
+    return ground[i] + (ground[i + 1] - ground[i]) * (t - i);
+}
+
+void race_start(RaceState& race, const RaceCourse& course, int player_count, const LevelParams& level)
+{
+    // Zeroed first, so the unused players hash the same everywhere too
+    memset(&race, 0, sizeof(race));
+    race.player_count = (uint32_t)std::min(std::max(player_count, 1), MAX_RACE_PLAYERS);
+
+    for (uint32_t i = 0; i < race.player_count; i++)
+    {
+        LanderState& lander = race.players[i].lander;
+        lander.position.x = course.start_x + (i - (race.player_count - 1) * 0.5f) * RACE_START_SPACING;
+        lander.position.y = std::max(level.start_height, course.ground_at(lander.position.x) + RACE_SHIP_HALF_HEIGHT + 0.5f);
+        lander.movement = glm::vec2(level.start_drift, 0.0f);
+        lander.acceleration = glm::vec2(0.0f);
+        lander.fuel = level.start_fuel;
+        race.players[i].status = RACER_FLYING;
+    }
+}
+
+void race_step_player(RacePlayer& player, uint32_t step, const RaceCourse& course, uint8_t buttons, const PhysicsParams& params)
+{
+    if (player.status != RACER_FLYING) return;
+
+    LanderState& lander = player.lander;
+    step_lander(lander, control_from_buttons(buttons), RACE_STEP, params);
+
+    if (!course.in_range(lander.position.x))
+    {
+        player.status = RACER_CRASHED;
+        player.finish_step = step;
+        return;
+    }
+
+    float ground = course.ground_at(lander.position.x);
+    if (lander.position.y - RACE_SHIP_HALF_HEIGHT > ground) return;
+
+    // The same verdict the game gives: on the pad and slow enough wins, too fast
+    // anywhere is a crash, and slow anywhere else just sets down on the ground,
+    // unless the tank's empty and it's never getting up again
+    float speed = glm::length(lander.movement * params.speed);
+    if (speed > SOFT_LANDING_MAX_SPEED)
+    {
+        player.status = RACER_CRASHED;
+        player.finish_step = step;
+    }
+    else if (fabsf(lander.position.x - course.pad_x) <= LANDING_PAD_HALF_WIDTH - RACE_SHIP_HALF_WIDTH)
+    {
+        player.status = RACER_LANDED;
+        player.finish_step = step;
+    }
+    else if (lander.fuel <= 0.0f)
+    {
+        player.status = RACER_CRASHED;
+        player.finish_step = step;
+    }
+    else
+    {
+        lander.position.y = ground + RACE_SHIP_HALF_HEIGHT;
+        lander.movement.y = std::max(lander.movement.y, 0.0f);
+    }
+}
+
+void race_step(RaceState& race, const RaceCourse& course, const uint8_t* buttons, const PhysicsParams& params)
+{
+    for (uint32_t i = 0; i < race.player_count; i++)
+    {
+        race_step_player(race.players[i], race.step, course, buttons[i], params);
+    }
+
+    race.step++;
+}
+
+bool race_finished(const RaceState& race)
+{
+    for (uint32_t i = 0; i < race.player_count; i++)
+    {
+        if (race.players[i].status == RACER_FLYING) return false;
+    }
+    return true;
+}
+
+uint32_t race_hash(const RaceState& race)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&race);
+    size_t size = offsetof(RaceState, players) + race.player_count * sizeof(RacePlayer);
+
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "Simulation.h"
+
+constexpr int MAX_RACE_PLAYERS = 8;
+constexpr float RACE_STEP = 1.0f / 60.0f;       // same as the game's simulation step
+
+// Everyone starts in a row around x = 0, and races for the pad in this cell
+constexpr int RACE_PAD_CELL = 1;                // pads are LANDING_PAD_INTERVAL apart, so 8 to 16 units out
+constexpr float RACE_START_SPACING = 0.75f;
+
+// The ground is tabled from this far behind the start to this far past the pad;
+// leaving that stretch counts as a crash
+constexpr float RACE_COURSE_MARGIN = 8.0f;
+constexpr float RACE_GROUND_SPACING = 0.05f;
+
+// The ship is drawn at 0.5 x 0.5
+constexpr float RACE_SHIP_HALF_WIDTH = 0.25f,
+RACE_SHIP_HALF_HEIGHT = 0.25f;
+
+enum RacerStatus
+{
+    RACER_FLYING,
+    RACER_LANDED,
+    RACER_CRASHED
+};
+
+// Plain floats and ints with no gaps between them, so the bytes are the state
+struct RacePlayer
+{
+    LanderState lander;
+    uint32_t status;
+    uint32_t finish_step;                       // when it landed or crashed
+};
+
+/**
+ * Everything that changes during a race. Every peer steps its own copy on the
+ * same inputs, so with the same build they stay identical to the bit, and
+ * race_hash() is how they check.
+ */
+struct RaceState
+{
+    uint32_t step;
+    uint32_t player_count;
+    RacePlayer players[MAX_RACE_PLAYERS];
+};
+
+// Rolling back is copying one of these over another, so nothing in it may point anywhere
+static_assert(std::is_trivially_copyable<RaceState>::value, "RaceState has to stay flat");
+
+/**
+ * Everything about a race that never changes once it starts: the pad and the
+ * ground, tabled up front because the noise is too slow to run every step.
+ * Built the same from the same seed on every peer.
+ */
+struct RaceCourse
+{
+    uint32_t seed = 0;
+    float start_x = 0.0f;
+    float pad_x = 0.0f;
+    float origin_x = 0.0f;
+    std::vector<float> ground;                  // highest point under the ship's width, RACE_GROUND_SPACING apart
+
+    void build(uint32_t seed);
+    bool in_range(float x) const;
+    float ground_at(float x) const;
+};
+
+void race_start(RaceState& race, const RaceCourse& course, int player_count, const LevelParams& level);
+
+// One player's part of a step. Players never touch each other, so this is also
+// how a client runs its own ship ahead on input the others haven't seen yet.
+void race_step_player(RacePlayer& player, uint32_t step, const RaceCourse& course, uint8_t buttons, const PhysicsParams& params);
+
+// One step for everyone, buttons[i] being player i's InputButton mask
+void race_step(RaceState& race, const RaceCourse& course, const uint8_t* buttons, const PhysicsParams& params);
+
+bool race_finished(const RaceState& race);
+
+// FNV-1a over the step and every player in the race
+uint32_t race_hash(const RaceState& race);
@@ -0,0 +1,153 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstring>
+#include <iostream>
+#include "RenderBackend.h"
+
+namespace
+{
+    RenderBackendType g_backend = RENDER_BACKEND_LEGACY;
+}
+
+SDL_GLContext create_render_context(SDL_Window* window, bool prefer_core)
+{
+#ifdef LUNAR_CORE_PROFILE
+    if (prefer_core)
+    {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+        SDL_GLContext context = SDL_GL_CreateContext(window);
+        if (context != nullptr)
+        {
+            g_backend = RENDER_BACKEND_CORE;
+            return context;
+        }
+
+        std::cout << "No GL 3.3 core context (" << SDL_GetError() << "), falling back to legacy" << std::endl;
+        SDL_GL_ResetAttributes();
+    }
+#else
+    (void)prefer_core;
+#endif
+
+    g_backend = RENDER_BACKEND_LEGACY;
+    return SDL_GL_CreateContext(window);
+}
+
+RenderBackendType get_render_backend()
+{
+    return g_backend;
+}
+
+const char* get_render_backend_name()
+{
+    return g_backend == RENDER_BACKEND_CORE ? "core 3.3" : "legacy";
+}
+
+bool has_gl_extension(const char* name)
+{
+#ifdef LUNAR_CORE_PROFILE
+    // Core contexts don't do glGetString(GL_EXTENSIONS) any more, it's one at a time
+    if (g_backend == RENDER_BACKEND_CORE)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (extension != nullptr && strcmp(extension, name) == 0) return true;
+        }
+        return false;
+    }
+#endif
+
+    // One long space-separated list, and a name can be the start of a longer one
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    size_t length = strlen(name);
+    for (const char* found = extensions; found != nullptr && (found = strstr(found, name)) != nullptr; found += length)
+    {
+        bool starts = found == extensions || found[-1] == ' ';
+        bool ends = found[length] == ' ' || found[length] == '\0';
+        if (starts && ends) return true;
+    }
+    return false;
+}
+
+bool vertex_arrays_supported()
+{
+#ifdef LUNAR_CORE_PROFILE
+    if (g_backend == RENDER_BACKEND_CORE) return true;
+#ifdef _WINDOWS
+    // GLEW leaves these null on anything older than GL 3.0
+    return glGenVertexArrays != nullptr && glBindVertexArray != nullptr;
+#else
+    return true;
+#endif
+#else
+    return false;
+#endif
+}
+
+GLuint create_vertex_array()
+{
+    GLuint vertex_array = 0;
+#ifdef LUNAR_CORE_PROFILE
+    if (vertex_arrays_supported()) glGenVertexArrays(1, &vertex_array);
+#endif
+    return vertex_array;
+}
+
+void bind_vertex_array(GLuint vertex_array)
+{
+#ifdef LUNAR_CORE_PROFILE
+    if (vertex_arrays_supported()) glBindVertexArray(vertex_array);
+#else
+    (void)vertex_array;
+#endif
+}
+
+void delete_vertex_array(GLuint& vertex_array)
+{
+#ifdef LUNAR_CORE_PROFILE
+    if (vertex_array != 0) glDeleteVertexArrays(1, &vertex_array);
+#endif
+    vertex_array = 0;
+}
+
+void allocate_static_buffer(GLenum target, GLsizeiptr size, const void* data)
+{
+#ifdef LUNAR_CORE_PROFILE
+    if (buffer_storage_supported())
+    {
+        glBufferStorage(target, size, data, 0);
+        return;
+    }
+#endif
+    glBufferData(target, size, data, GL_STATIC_DRAW);
+}
+
+bool buffer_storage_supported()
+{
+#ifdef LUNAR_CORE_PROFILE
+    static int supported = -1;
+    if (supported < 0)
+    {
+        GLint major = 0, minor = 0;
+        if (g_backend == RENDER_BACKEND_CORE)
+        {
+            glGetIntegerv(GL_MAJOR_VERSION, &major);
+            glGetIntegerv(GL_MINOR_VERSION, &minor);
+        }
+        supported = (major > 4 || (major == 4 && minor >= 4) || has_gl_extension("GL_ARB_buffer_storage")) ? 1 : 0;
+#ifdef _WINDOWS
+        // GLEW leaves it null if the driver doesn't have it
+        if (glBufferStorage == nullptr) supported = 0;
+#endif
+    }
+    return supported == 1;
+#else
+    return false;
+#endif
+}
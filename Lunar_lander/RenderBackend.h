@@ -0,0 +1,53 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+// Core contexts need gl3.h on macOS, and the rest of the renderer is built
+// against the legacy headers there, so it only ever gets the legacy backend
+#if defined(_WINDOWS) || defined(__linux__)
+#define LUNAR_CORE_PROFILE 1
+#endif
+
+enum RenderBackendType
+{
+    RENDER_BACKEND_LEGACY,   // GL 2.1 compatibility, GLSL 1.20
+    RENDER_BACKEND_CORE      // GL 3.3 core, GLSL 3.30: no client arrays, no VAO 0
+};
+
+/**
+ * Which kind of GL context we ended up with, and the few things that differ
+ * between them. Everything that draws asks here rather than checking for itself:
+ * ShaderProgram picks its GLSL preamble, and SpriteBatch, Terrain,
+ * ParticleSystem and GeometryCache keep their attributes in vertex arrays and
+ * their vertices in buffers, which both backends can do but core has to.
+ */
+
+// Makes the GL context for the window, core if asked for and the driver has one,
+// the legacy one otherwise. Null if neither works.
+SDL_GLContext create_render_context(SDL_Window* window, bool prefer_core);
+
+RenderBackendType get_render_backend();
+const char* get_render_backend_name();
+
+// Works on both backends, which list their extensions differently
+bool has_gl_extension(const char* name);
+
+// Vertex arrays are core since 3.0 but missing from the macOS legacy profile.
+// Without them create_vertex_array() gives 0 and callers set up their attributes every draw.
+bool vertex_arrays_supported();
+GLuint create_vertex_array();
+void bind_vertex_array(GLuint vertex_array);
+void delete_vertex_array(GLuint& vertex_array);
+
+// For buffers that are written once: immutable storage where there's
+// glBufferStorage (GL 4.4 or ARB_buffer_storage), plain glBufferData where not.
+// The buffer must already be bound to `target`.
+void allocate_static_buffer(GLenum target, GLsizeiptr size, const void* data);
+
+// glBufferStorage itself, for anything that wants persistent mapping
+bool buffer_storage_supported();
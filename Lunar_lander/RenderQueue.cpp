@@ -0,0 +1,213 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+#include "SpriteBatch.h"
+
+namespace
+{
+    constexpr int LAYER_SHIFT = 56;
+    constexpr int BLEND_SHIFT = 52;
+    constexpr int PROGRAM_SHIFT = 44;
+    constexpr int TEXTURE_SHIFT = 24;
+
+    constexpr uint64_t PROGRAM_MASK = (1u << 8) - 1;
+    constexpr uint64_t TEXTURE_MASK = (1u << 20) - 1;
+    constexpr uint64_t DEPTH_MASK = (1u << 24) - 1;
+
+    constexpr GLuint NO_TEXTURE = ~0u;   // so the first command always binds one
+
+    void set_blend(BlendMode blend)
+    {
+        if (blend == BLEND_ADDITIVE) glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        else                         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+}
+
+void RenderQueue::init(SpriteBatch* batch, GeometryCache* geometry)
+{
+    m_batch = batch;
+    m_geometry = geometry;
+
+    m_commands.resize(MAX_RENDER_COMMANDS);
+    m_entries.resize(MAX_RENDER_COMMANDS);
+    m_scratch.resize(MAX_RENDER_COMMANDS);
+    m_programs.reserve(PROGRAM_MASK + 1);
+    m_count = 0;
+}
+
+void RenderQueue::begin_frame()
+{
+    m_count = 0;
+}
+
+uint64_t RenderQueue::program_index(ShaderProgram* program)
+{
+    for (size_t i = 0; i < m_programs.size(); i++)
+    {
+        if (m_programs[i] == program) return i;
+    }
+
+    // A few programs a game, but if there were ever more they'd only share bits, not break
+    if (m_programs.size() <= PROGRAM_MASK) m_programs.push_back(program);
+    return (m_programs.size() - 1) & PROGRAM_MASK;
+}
+
+RenderQueue::Command* RenderQueue::push(RenderLayer layer, ShaderProgram* program, GLuint texture, BlendMode blend, float depth)
+{
+    if (m_count == (int)m_commands.size())
+    {
+        m_overflow_count++;
+        return nullptr;
+    }
+
+    // Texture names are small in practice; a huge one only loses its place in the order
+    uint64_t quantised_depth = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * DEPTH_MASK);
+    uint64_t key = ((uint64_t)layer << LAYER_SHIFT)
+        | ((uint64_t)blend << BLEND_SHIFT)
+        | (program_index(program) << PROGRAM_SHIFT)
+        | (((uint64_t)texture & TEXTURE_MASK) << TEXTURE_SHIFT)
+        | quantised_depth;
+
+    m_entries[m_count] = { key, (uint32_t)m_count };
+
+    Command& command = m_commands[m_count++];
+    command.program = program;
+    command.texture = texture;
+    command.blend = blend;
+    return &command;
+}
+
+void RenderQueue::draw_sprite(RenderLayer layer, ShaderProgram* program, GLuint texture, const glm::mat4& model_matrix, const glm::vec4& uv, float depth)
+{
+    Command* command = push(layer, program, texture, BLEND_ALPHA, depth);
+    if (command == nullptr) return;
+
+    command->type = COMMAND_SPRITE;
+    command->model_matrix = model_matrix;
+    command->uv = uv;
+}
+
+void RenderQueue::draw_rect(RenderLayer layer, ShaderProgram* program, GLuint texture, float min_x, float min_y, float max_x, float max_y, const glm::vec4& uv, float depth)
+{
+    // Same as a unit quad scaled and moved into place
+    glm::mat4 model_matrix(1.0f);
+    model_matrix[0][0] = max_x - min_x;
+    model_matrix[1][1] = max_y - min_y;
+    model_matrix[3][0] = (min_x + max_x) * 0.5f;
+    model_matrix[3][1] = (min_y + max_y) * 0.5f;
+
+    draw_sprite(layer, program, texture, model_matrix, uv, depth);
+}
+
+void RenderQueue::draw_static_quad(RenderLayer layer, ShaderProgram* program, GLuint texture, StaticQuad quad)
+{
+    Command* command = push(layer, program, texture, BLEND_ALPHA, 0.0f);
+    if (command == nullptr) return;
+
+    command->type = COMMAND_STATIC_QUAD;
+    command->quad = quad;
+}
+
+void RenderQueue::draw_callback(RenderLayer layer, ShaderProgram* program, GLuint texture, BlendMode blend, RenderCallback callback, void* user)
+{
+    Command* command = push(layer, program, texture, blend, 0.0f);
+    if (command == nullptr) return;
+
+    command->type = COMMAND_CALLBACK;
+    command->callback = callback;
+    command->user = user;
+}
+
+void RenderQueue::sort()
+{
+    // Least significant byte first, each pass a stable counting sort, so the
+    // whole thing is stable. Most of the key is the same for every command
+    // (the top of the layer byte, the top of the texture bits), and a pass
+    // where everything lands in one bucket changes nothing, so it's skipped.
+    SortEntry* source = m_entries.data();
+    SortEntry* destination = m_scratch.data();
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        int counts[256] = {};
+        for (int i = 0; i < m_count; i++) counts[(source[i].key >> shift) & 0xff]++;
+        if (counts[(source[0].key >> shift) & 0xff] == m_count) continue;
+
+        int offsets[256];
+        int total = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            offsets[digit] = total;
+            total += counts[digit];
+        }
+
+        for (int i = 0; i < m_count; i++) destination[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+        std::swap(source, destination);
+    }
+
+    if (source != m_entries.data()) std::copy(source, source + m_count, m_entries.data());
+}
+
+void RenderQueue::submit()
+{
+    m_stats = RenderQueueStats();
+    m_stats.commands = m_count;
+    if (m_count == 0) return;
+
+    sort();
+
+    // Nothing is assumed about what was bound before, except that blending is alpha
+    ShaderProgram* program = nullptr;
+    GLuint texture = NO_TEXTURE;
+    BlendMode blend = BLEND_ALPHA;
+    int batch_draws = m_batch->get_draw_count();
+
+    for (int i = 0; i < m_count; i++)
+    {
+        const Command& command = m_commands[m_entries[i].command];
+
+        bool changes_state = command.program != program || command.texture != texture || command.blend != blend;
+        if (changes_state || command.type != COMMAND_SPRITE) m_batch->flush();
+
+        if (command.program != program)
+        {
+            program = command.program;
+            glUseProgram(program->get_program_id());
+            m_stats.program_binds++;
+        }
+        if (command.texture != texture)
+        {
+            texture = command.texture;
+            glBindTexture(GL_TEXTURE_2D, texture);
+            m_stats.texture_binds++;
+        }
+        if (command.blend != blend)
+        {
+            blend = command.blend;
+            set_blend(blend);
+            m_stats.blend_changes++;
+        }
+
+        switch (command.type)
+        {
+        case COMMAND_SPRITE:
+            m_batch->draw(command.model_matrix, command.uv);
+            break;
+        case COMMAND_STATIC_QUAD:
+            m_geometry->draw(command.quad);
+            m_stats.draw_calls++;
+            break;
+        case COMMAND_CALLBACK:
+            command.callback(command.user);
+            m_stats.draw_calls++;
+            break;
+        }
+    }
+
+    m_batch->flush();
+    m_stats.draw_calls += m_batch->get_draw_count() - batch_draws;
+
+    if (blend != BLEND_ALPHA) set_blend(BLEND_ALPHA);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <cstdint>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+#include "GeometryCache.h"
+
+class ShaderProgram;
+class SpriteBatch;
+
+// Plenty for a frame: the asteroids on screen, the HUD text and a handful of passes
+constexpr int MAX_RENDER_COMMANDS = 8192;
+
+// Back to front. The layer is the top of the key, so nothing in a later layer
+// ever draws under something in an earlier one.
+enum RenderLayer
+{
+    LAYER_BACKGROUND,
+    LAYER_TERRAIN,
+    LAYER_WORLD,      // ship and asteroids
+    LAYER_EFFECTS,    // particles
+    LAYER_SCREEN,     // end screens
+    LAYER_HUD
+};
+
+enum BlendMode
+{
+    BLEND_ALPHA,
+    BLEND_ADDITIVE
+};
+
+// For passes that do their own drawing (terrain, particles, cached text). The
+// queue has already bound the program, texture and blend by the time it's called.
+typedef void (*RenderCallback)(void* user);
+
+struct RenderQueueStats
+{
+    int commands = 0;
+    int program_binds = 0;
+    int texture_binds = 0;
+    int blend_changes = 0;
+    int draw_calls = 0;      // a callback counts as one, whatever it does
+};
+
+/**
+ * Everything drawn in a frame goes in here first as a command with a 64-bit key,
+ * from the top: layer (8 bits), blend mode (4), program (8), texture (20) and
+ * depth (24). submit() radix sorts the keys and walks them in order, so draws
+ * that share state end up next to each other, and only binds what's different
+ * from the command before. Sprites that share a program and texture go through
+ * the SpriteBatch as one draw call.
+ *
+ * The sort is stable, so commands with the same key stay in the order they were
+ * made. Commands don't own anything: callbacks' user data has to last until submit().
+ */
+class RenderQueue
+{
+private:
+    enum CommandType
+    {
+        COMMAND_SPRITE,
+        COMMAND_STATIC_QUAD,
+        COMMAND_CALLBACK
+    };
+
+    struct Command
+    {
+        CommandType type;
+        ShaderProgram* program;
+        GLuint texture;
+        BlendMode blend;
+
+        glm::mat4 model_matrix;     // sprites
+        glm::vec4 uv;
+        StaticQuad quad;            // static quads
+        RenderCallback callback;    // callbacks
+        void* user;
+    };
+
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t command;
+    };
+
+    SpriteBatch* m_batch = nullptr;
+    GeometryCache* m_geometry = nullptr;
+
+    // All sized once in init(), so a frame never allocates
+    std::vector<Command> m_commands;
+    std::vector<SortEntry> m_entries;
+    std::vector<SortEntry> m_scratch;
+    int m_count = 0;
+
+    // Programs get their key bits in the order they're first seen, and keep them
+    std::vector<ShaderProgram*> m_programs;
+
+    RenderQueueStats m_stats;
+    int m_overflow_count = 0;
+
+    Command* push(RenderLayer layer, ShaderProgram* program, GLuint texture, BlendMode blend, float depth);
+    uint64_t program_index(ShaderProgram* program);
+    void sort();
+
+public:
+    void init(SpriteBatch* batch, GeometryCache* geometry);
+
+    // Drops last frame's commands
+    void begin_frame();
+
+    // A unit quad through model_matrix, uv as SpriteBatch takes it. Depth is in
+    // [0, 1] and only orders draws that share everything above it in the key.
+    void draw_sprite(RenderLayer layer, ShaderProgram* program, GLuint texture, const glm::mat4& model_matrix, const glm::vec4& uv, float depth = 0.0f);
+    void draw_rect(RenderLayer layer, ShaderProgram* program, GLuint texture, float min_x, float min_y, float max_x, float max_y, const glm::vec4& uv, float depth = 0.0f);
+
+    void draw_static_quad(RenderLayer layer, ShaderProgram* program, GLuint texture, StaticQuad quad);
+    void draw_callback(RenderLayer layer, ShaderProgram* program, GLuint texture, BlendMode blend, RenderCallback callback, void* user);
+
+    // Sorts and draws everything, then leaves blending as alpha
+    void submit();
+
+    const RenderQueueStats& get_stats() const { return m_stats; };
+    int const get_overflow_count()       const { return m_overflow_count; };
+};
@@ -0,0 +1,76 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "SdfFont.h"
+
+bool SdfFont::load(const char* path)
+{
+    std::ifstream file(path);
+    if (file.fail()) {
+        std::cout << "Error opening font file:" << path << std::endl;
+        return false;
+    }
+
+    float atlas_width = 0.0f, atlas_height = 0.0f, line_height = 0.0f;
+    int glyph_count = 0;
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind) || kind[0] == '#') continue;
+
+        if (kind == "font")
+        {
+            float spread;
+            if (!(fields >> m_texture_path >> atlas_width >> atlas_height >> line_height >> spread) || atlas_width <= 0.0f || atlas_height <= 0.0f || line_height <= 0.0f) {
+                std::cout << path << ":" << line_number << ": bad font" << std::endl;
+                return false;
+            }
+        }
+        else if (kind == "glyph")
+        {
+            if (line_height <= 0.0f) {
+                std::cout << path << ":" << line_number << ": glyph before the font line" << std::endl;
+                return false;
+            }
+
+            int code;
+            float x, y, width, height, x_offset, y_offset, advance;
+            if (!(fields >> code >> x >> y >> width >> height >> x_offset >> y_offset >> advance)
+                || code < SDF_FIRST_GLYPH || code >= SDF_FIRST_GLYPH + SDF_GLYPH_COUNT) {
+                std::cout << path << ":" << line_number << ": bad glyph" << std::endl;
+                return false;
+            }
+
+            // Texels to line heights, once, so laying text out is just multiplies
+            SdfGlyph& glyph = m_glyphs[code - SDF_FIRST_GLYPH];
+            glyph.uv = glm::vec4(x / atlas_width, y / atlas_height, (x + width) / atlas_width, (y + height) / atlas_height);
+            glyph.x_offset = x_offset / line_height;
+            glyph.y_offset = y_offset / line_height;
+            glyph.width = width / line_height;
+            glyph.height = height / line_height;
+            glyph.advance = advance / line_height;
+            glyph_count++;
+        }
+        else
+        {
+            std::cout << path << ":" << line_number << ": unknown entry " << kind << std::endl;
+            return false;
+        }
+    }
+
+    m_loaded = glyph_count > 0;
+    return m_loaded;
+}
+
+const SdfGlyph& SdfFont::get_glyph(char character) const
+{
+    int index = (unsigned char)character - SDF_FIRST_GLYPH;
+    if (index < 0 || index >= SDF_GLYPH_COUNT) index = '?' - SDF_FIRST_GLYPH;
+    return m_glyphs[index];
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <string>
+#include "glm/vec4.hpp"
+
+// Printable ASCII, which is all FontBaker bakes
+constexpr int SDF_FIRST_GLYPH = 32;
+constexpr int SDF_GLYPH_COUNT = 95;
+
+// Where a glyph sits in the atlas and how it's placed, in line heights so text scales by multiplying
+struct SdfGlyph
+{
+    glm::vec4 uv;                   // (u0, v0, u1, v1), v0 at the top like the sprite sheets
+    float x_offset, y_offset;       // quad's top left from the pen, y down from the top of the line
+    float width, height;
+    float advance;
+};
+
+/**
+ * A signed distance field font made by FontBaker: an atlas where every texel
+ * holds its distance from the glyph's edge, and a metrics file saying where each
+ * glyph is. The atlas is filtered linearly and fragment_sdf.glsl cuts the edge
+ * at 0.5, so the text stays sharp at whatever size it's drawn.
+ */
+class SdfFont
+{
+private:
+    SdfGlyph m_glyphs[SDF_GLYPH_COUNT] = {};
+    std::string m_texture_path;
+    GLuint m_texture = 0;
+    bool m_loaded = false;
+
+public:
+    // Reads the metrics; the atlas it names is loaded by whoever loads textures, then handed over
+    bool load(const char* path);
+
+    // Anything outside printable ASCII comes back as '?'
+    const SdfGlyph& get_glyph(char character) const;
+
+    void set_texture(GLuint texture) { m_texture = texture; };
+
+    const std::string& get_texture_path() const { return m_texture_path; };
+    GLuint const get_texture()            const { return m_texture;      };
+    bool const is_loaded()                const { return m_loaded;       };
+};
@@ -1,113 +1,448 @@
 #define GL_SILENCE_DEPRECATION
 
+#include <cstdio>
+#include <cstring>
+#include <vector>
 #include "ShaderProgram.h"
+#include "RenderBackend.h"
 
-void ShaderProgram::load(const char *vertex_shader_file, const char *fragment_shader_file) {
-    
-    // create the vertex shader
-    m_vertex_shader = load_shader_from_file(vertex_shader_file, GL_VERTEX_SHADER);
-    // create the fragment shader
-    m_fragment_shader = load_shader_from_file(fragment_shader_file, GL_FRAGMENT_SHADER);
-    
-    // Create the final shader program from our vertex and fragment shaders
-    m_program_id = glCreateProgram();
-    glAttachShader(m_program_id, m_vertex_shader);
-    glAttachShader(m_program_id, m_fragment_shader);
-    glLinkProgram(m_program_id);
-    
-    GLint link_success;
-    glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
-    
-    if(link_success == GL_FALSE)
+#ifdef _WINDOWS
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// glGetProgramBinary needs GL 4.1 or ARB_get_program_binary, which the macOS
+// legacy profile doesn't have, so there it's always a cold compile
+#if defined(_WINDOWS) || defined(__linux__)
+#define LUNAR_PROGRAM_BINARY 1
+#endif
+
+namespace
+{
+    // Ahead of every vertex shader. #line puts the file's own line numbers back for error messages.
+    // The shaders are written as GLSL 1.20; the core ones just rename what 3.30 calls things.
+    constexpr char VERTEX_PREAMBLE_CORE[] =
+        "#version 330 core\n"
+        "#define attribute in\n"
+        "#define varying out\n"
+        "layout(std140) uniform FrameData\n"
+        "{\n"
+        "    mat4 viewMatrix;\n"
+        "    mat4 projectionMatrix;\n"
+        "    vec4 frameTime;\n"
+        "};\n"
+        "#line 1\n";
+
+    constexpr char VERTEX_PREAMBLE_BLOCK[] =
+        "#version 120\n"
+        "#extension GL_ARB_uniform_buffer_object : require\n"
+        "layout(std140) uniform FrameData\n"
+        "{\n"
+        "    mat4 viewMatrix;\n"
+        "    mat4 projectionMatrix;\n"
+        "    vec4 frameTime;\n"
+        "};\n"
+        "#line 1\n";
+
+    constexpr char VERTEX_PREAMBLE_PLAIN[] =
+        "#version 120\n"
+        "uniform mat4 viewMatrix;\n"
+        "uniform mat4 projectionMatrix;\n"
+        "uniform vec4 frameTime;\n"
+        "#line 1\n";
+
+    constexpr char FRAGMENT_PREAMBLE_CORE[] =
+        "#version 330 core\n"
+        "#define varying in\n"
+        "#define texture2D texture\n"
+        "out vec4 frag_colour;\n"
+        "#line 1\n";
+
+    constexpr char FRAGMENT_PREAMBLE[] =
+        "#version 120\n"
+        "#define frag_colour gl_FragColor\n"
+        "#line 1\n";
+
+    const char* vertex_preamble()
+    {
+        if (get_render_backend() == RENDER_BACKEND_CORE) return VERTEX_PREAMBLE_CORE;
+        return frame_uniform_blocks_supported() ? VERTEX_PREAMBLE_BLOCK : VERTEX_PREAMBLE_PLAIN;
+    }
+
+    const char* fragment_preamble()
+    {
+        return get_render_backend() == RENDER_BACKEND_CORE ? FRAGMENT_PREAMBLE_CORE : FRAGMENT_PREAMBLE;
+    }
+
+    constexpr char CACHE_MAGIC[4] = { 'L', 'L', 'P', 'B' };
+    constexpr uint32_t CACHE_VERSION = 2;   // 2: attribute locations bound before linking
+
+    struct CacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;       // sources and driver, see cache_key()
+        uint32_t format;    // whatever glGetProgramBinary said the binary was
+        uint32_t length;
+    };
+
+    // 64-bit FNV-1a, carried on from `hash` so several strings can go into one key
+    uint64_t fnv1a(const char* data, size_t length, uint64_t hash = 14695981039346656037ull)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t fnv1a(const std::string& text, uint64_t hash)
+    {
+        // The terminator goes in too, so "ab" + "c" and "a" + "bc" hash differently
+        return fnv1a(text.c_str(), text.size() + 1, hash);
+    }
+
+    // A binary is only good for the same sources on the same driver
+    uint64_t cache_key(const std::string& vertex_source, const std::string& fragment_source)
+    {
+        uint64_t key = fnv1a(vertex_source, fnv1a(fragment_source, 14695981039346656037ull));
+
+        const GLenum driver_strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (GLenum name : driver_strings)
+        {
+            const char* value = (const char*)glGetString(name);
+            if (value != nullptr) key = fnv1a(value, strlen(value) + 1, key);
+        }
+        return key;
+    }
+
+    bool program_binaries_supported()
+    {
+#ifdef LUNAR_PROGRAM_BINARY
+        static int supported = -1;
+        if (supported < 0)
+        {
+#ifdef _WINDOWS
+            // GLEW leaves these null if the driver doesn't have them
+            if (glGetProgramBinary == nullptr || glProgramBinary == nullptr || glProgramParameteri == nullptr)
+            {
+                supported = 0;
+                return false;
+            }
+#endif
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            supported = formats > 0 ? 1 : 0;
+        }
+        return supported == 1;
+#else
+        return false;
+#endif
+    }
+
+    void make_directory(const char* path)
     {
-        printf("Error linking shader program!\n");
+#ifdef _WINDOWS
+        _mkdir(path);
+#else
+        mkdir(path, 0755);
+#endif
     }
-    
-    m_model_matrix_uniform      = glGetUniformLocation(m_program_id, "modelMatrix");
+}
+
+bool ShaderProgram::load(const char *vertex_shader_file, const char *fragment_shader_file)
+{
+    m_vertex_path = vertex_shader_file;
+    m_fragment_path = fragment_shader_file;
+
+#ifdef LUNAR_SHADER_HOT_RELOAD
+    m_vertex_watcher.watch(vertex_shader_file);
+    m_fragment_watcher.watch(fragment_shader_file);
+#endif
+
+    return reload();
+}
+
+bool ShaderProgram::reload()
+{
+    std::string vertex_source = vertex_preamble();
+    std::string fragment_source = fragment_preamble();
+    if (!read_source(m_vertex_path, vertex_source) || !read_source(m_fragment_path, fragment_source))
+    {
+        if (m_program_id != 0) std::cout << "Keeping the previous " << m_vertex_path << " program" << std::endl;
+        return false;
+    }
+
+    // One cache file per pair of paths, overwritten whenever the sources or driver change
+    char cache_name[32];
+    snprintf(cache_name, sizeof(cache_name), "%016llx.bin", (unsigned long long)fnv1a(m_fragment_path, fnv1a(m_vertex_path, 14695981039346656037ull)));
+    std::string cache_path = std::string(SHADER_CACHE_DIRECTORY) + "/" + cache_name;
+    uint64_t key = cache_key(vertex_source, fragment_source);
+
+    GLuint program_id = load_cached(cache_path, key);
+    if (program_id == 0)
+    {
+        program_id = build(vertex_source, fragment_source);
+        if (program_id == 0)
+        {
+            if (m_program_id != 0) std::cout << "Keeping the previous " << m_vertex_path << " program" << std::endl;
+            return false;
+        }
+
+        save_cached(program_id, cache_path, key);
+    }
+
+    adopt(program_id);
+    return true;
+}
+
+void ShaderProgram::reload_if_changed(float delta_time)
+{
+#ifdef LUNAR_SHADER_HOT_RELOAD
+    // Both get asked every time, so neither one's queue backs up
+    bool vertex_changed = m_vertex_watcher.has_changed(delta_time);
+    bool fragment_changed = m_fragment_watcher.has_changed(delta_time);
+
+    if ((vertex_changed || fragment_changed) && reload())
+    {
+        std::cout << "Reloaded " << m_vertex_path << " + " << m_fragment_path << std::endl;
+    }
+#else
+    (void)delta_time;
+#endif
+}
+
+void ShaderProgram::release()
+{
+    if (m_program_id != 0) glDeleteProgram(m_program_id);
+    m_program_id = 0;
+}
+
+void ShaderProgram::adopt(GLuint program_id)
+{
+    // Only ever reached with a program that linked, so the swap can't leave us with nothing
+    if (m_program_id != 0) glDeleteProgram(m_program_id);
+    m_program_id = program_id;
+    m_generation++;
+
+    m_colour_uniform            = glGetUniformLocation(m_program_id, "color");
     m_projection_matrix_uniform = glGetUniformLocation(m_program_id, "projectionMatrix");
     m_view_matrix_uniform       = glGetUniformLocation(m_program_id, "viewMatrix");
-    m_colour_uniform            = glGetUniformLocation(m_program_id, "color");
-    
-    m_position_attribute  = glGetAttribLocation(m_program_id, "position");
-    m_tex_coord_attribute = glGetAttribLocation(m_program_id, "texCoord");
-    
-    set_colour(1.0f, 1.0f, 1.0f, 1.0f);
-    
+    m_frame_time_uniform        = glGetUniformLocation(m_program_id, "frameTime");
+
+#ifdef LUNAR_UNIFORM_BUFFERS
+    // Block bindings are program state too, so every new program gets pointed at the shared buffer
+    if (frame_uniform_blocks_supported())
+    {
+        GLuint block = glGetUniformBlockIndex(m_program_id, "FrameData");
+        if (block != GL_INVALID_INDEX) glUniformBlockBinding(m_program_id, block, FRAME_UNIFORM_BINDING);
+    }
+    else
+#endif
+    {
+        set_frame_data(m_frame_data);
+    }
+    set_colour(m_colour.r, m_colour.g, m_colour.b, m_colour.a);
+}
+
+bool ShaderProgram::read_source(const std::string &path, std::string &contents) const
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        std::cout << "Error opening shader file:" << path << std::endl;
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // Appended, so whatever's already in there (the preamble) stays in front
+    size_t start = contents.size();
+    contents.resize(start + (size > 0 ? size : 0));
+    size_t read = fread(&contents[start], 1, contents.size() - start, file);
+    fclose(file);
+    contents.resize(start + read);
+
+    return true;
 }
 
-void ShaderProgram::cleanup()
+GLuint ShaderProgram::build(const std::string &vertex_source, const std::string &fragment_source)
 {
-    glDeleteProgram(m_program_id);
-    glDeleteShader(m_vertex_shader);
-    glDeleteShader(m_fragment_shader);
+    GLuint vertex_shader = load_shader_from_string(vertex_source, GL_VERTEX_SHADER);
+    GLuint fragment_shader = load_shader_from_string(fragment_source, GL_FRAGMENT_SHADER);
+    if (vertex_shader == 0 || fragment_shader == 0)
+    {
+        if (vertex_shader != 0) glDeleteShader(vertex_shader);
+        if (fragment_shader != 0) glDeleteShader(fragment_shader);
+        return 0;
+    }
+
+    // Create the final shader program from our vertex and fragment shaders
+    GLuint program_id = glCreateProgram();
+    glAttachShader(program_id, vertex_shader);
+    glAttachShader(program_id, fragment_shader);
+
+    // Same slots in every program, so a vertex array set up once works with any of them.
+    // Names a shader doesn't have are just ignored.
+    glBindAttribLocation(program_id, ATTRIBUTE_POSITION, "position");
+    glBindAttribLocation(program_id, ATTRIBUTE_TEX_COORD, "texCoord");
+    glBindAttribLocation(program_id, ATTRIBUTE_LIFE, "life");
+    glBindAttribLocation(program_id, ATTRIBUTE_SIZE, "size");
+#ifdef LUNAR_PROGRAM_BINARY
+    if (program_binaries_supported()) glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+    glLinkProgram(program_id);
+
+    // The program keeps what it needs, the shaders can go either way
+    glDetachShader(program_id, vertex_shader);
+    glDetachShader(program_id, fragment_shader);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint link_success;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &link_success);
+
+    if (link_success == GL_FALSE)
+    {
+        GLchar messages[512];
+        glGetProgramInfoLog(program_id, sizeof(messages), 0, &messages[0]);
+        std::cout << "Error linking " << m_vertex_path << " + " << m_fragment_path << ": " << messages << std::endl;
+
+        glDeleteProgram(program_id);
+        return 0;
+    }
+
+    return program_id;
+}
+
+GLuint ShaderProgram::load_cached(const std::string &cache_path, uint64_t key) const
+{
+#ifdef LUNAR_PROGRAM_BINARY
+    if (!program_binaries_supported()) return 0;
+
+    FILE* file = fopen(cache_path.c_str(), "rb");
+    if (file == nullptr) return 0;
+
+    CacheHeader header;
+    bool matches = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+        && header.version == CACHE_VERSION && header.key == key;
+
+    std::vector<char> binary;
+    if (matches)
+    {
+        binary.resize(header.length);
+        matches = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!matches) return 0;
+
+    GLuint program_id = glCreateProgram();
+    glProgramBinary(program_id, header.format, binary.data(), (GLsizei)binary.size());
+
+    // Drivers are allowed to turn down their own binaries, after an update say
+    GLint link_success;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &link_success);
+    if (link_success == GL_FALSE)
+    {
+        glDeleteProgram(program_id);
+        return 0;
+    }
+
+    return program_id;
+#else
+    (void)cache_path;
+    (void)key;
+    return 0;
+#endif
 }
 
-GLuint ShaderProgram::load_shader_from_file(const std::string &shaderFile, GLenum type)
+void ShaderProgram::save_cached(GLuint program_id, const std::string &cache_path, uint64_t key) const
 {
-    //Open a file stream with the file name
-    std::ifstream infile(shaderFile);
-    
-    if(infile.fail()) {
-        std::cout << "Error opening shader file:" << shaderFile << std::endl;
-    }
-    
-    //Create a string buffer and stream the file to it
-    std::stringstream buffer;
-    buffer << infile.rdbuf();
-    
-    // Load the shader from the contents of the file
-    return load_shader_from_string(buffer.str(), type);
+#ifdef LUNAR_PROGRAM_BINARY
+    if (!program_binaries_supported()) return;
+
+    GLint length = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program_id, length, &length, &format, binary.data());
+
+    make_directory(SHADER_CACHE_DIRECTORY);
+    FILE* file = fopen(cache_path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        std::cout << "Couldn't write the shader cache at " << cache_path << std::endl;
+        return;
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.format = format;
+    header.length = (uint32_t)length;
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(binary.data(), 1, length, file);
+    fclose(file);
+#else
+    (void)program_id;
+    (void)cache_path;
+    (void)key;
+#endif
 }
 
 GLuint ShaderProgram::load_shader_from_string(const std::string &shaderContents, GLenum type)
 {
     // Create a shader of specified type
     GLuint shaderID = glCreateShader(type);
-    
+
     // Get the pointer to the C string from the STL string
     const char *shader_string  = shaderContents.c_str();
     GLint shader_string_length = (GLint) shaderContents.size();
-    
+
     // Set the shader source to the string and compile shader
     glShaderSource(shaderID, 1, &shader_string, &shader_string_length);
     glCompileShader(shaderID);
-    
+
     // Check if the shader compiled properly
     GLint compile_success;
     glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compile_success);
-    
-    // If the shader did not compile, print the error to stdout
+
+    // If the shader did not compile, print the error to stdout and hand back nothing
     if (compile_success == GL_FALSE)
     {
         GLchar messages[512];
         glGetShaderInfoLog(shaderID, sizeof(messages), 0, &messages[0]);
         std::cout << messages << std::endl;
+
+        glDeleteShader(shaderID);
+        return 0;
     }
-    
+
     // return the shader id
     return shaderID;
 }
 
 void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
 {
+    m_colour = glm::vec4(red, green, blue, alpha);
     glUseProgram(m_program_id);
     glUniform4f(m_colour_uniform, red, green, blue, alpha);
 }
 
-void ShaderProgram::set_view_matrix(const glm::mat4 &matrix)
-{
-    glUseProgram(m_program_id);
-    glUniformMatrix4fv(m_view_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
-}
-
-void ShaderProgram::set_model_matrix(const glm::mat4 &matrix)
-{
-    glUseProgram(m_program_id);
-    glUniformMatrix4fv(m_model_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
-}
-
-void ShaderProgram::set_projection_matrix(const glm::mat4 &matrix)
+void ShaderProgram::set_frame_data(const FrameData &data)
 {
+    m_frame_data = data;
     glUseProgram(m_program_id);
-    glUniformMatrix4fv(m_projection_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    glUniformMatrix4fv(m_view_matrix_uniform, 1, GL_FALSE, &data.view[0][0]);
+    glUniformMatrix4fv(m_projection_matrix_uniform, 1, GL_FALSE, &data.projection[0][0]);
+    glUniform4f(m_frame_time_uniform, data.time.x, data.time.y, data.time.z, data.time.w);
 }
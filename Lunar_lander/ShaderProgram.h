@@ -5,45 +5,101 @@
 #endif
 #define GL_GLEXT_PROTOTYPES 1
 #include <SDL_opengl.h>
+#include <cstdint>
 #include <string>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include "glm/mat4x4.hpp"
+#include "FrameUniforms.h"
 
+// Debug builds watch the shader sources and rebuild a program when one is saved
+#if defined(_DEBUG) && !defined(LUNAR_SHADER_HOT_RELOAD)
+#define LUNAR_SHADER_HOT_RELOAD 1
+#endif
+
+#ifdef LUNAR_SHADER_HOT_RELOAD
+#include "FileWatcher.h"
+#endif
+
+// Linked programs are kept here between runs, one file per vertex/fragment pair
+constexpr char SHADER_CACHE_DIRECTORY[] = "shader_cache";
+
+// Where every program's attributes go, whichever shader they're in
+constexpr GLuint ATTRIBUTE_POSITION = 0,
+ATTRIBUTE_TEX_COORD = 1,
+ATTRIBUTE_LIFE = 2,
+ATTRIBUTE_SIZE = 3;
+
+/**
+ * A linked vertex + fragment program and the handful of uniforms and attributes
+ * everything draws with. Vertex shaders don't declare viewMatrix,
+ * projectionMatrix or frameTime themselves: they're put in ahead of the file's
+ * own source, as the shared FrameData uniform block where the driver has them
+ * and as plain uniforms where it doesn't (see FrameUniforms). On the core
+ * backend the same 1.20-style source is compiled as GLSL 3.30, and fragment
+ * shaders write frag_colour so it works under both.
+ *
+ * Linked programs are cached to disk with glGetProgramBinary, keyed on a hash
+ * of both sources and the driver's vendor, renderer and version strings, so a
+ * warm start skips compiling altogether. A stale or rejected binary just means
+ * compiling as normal and caching again.
+ *
+ * A program is only ever swapped for one that built, so a shader that fails to
+ * compile on reload leaves the last working one in place.
+ */
 class ShaderProgram
 {
 private:
-    void cleanup();
-    
     GLuint load_shader_from_string(const std::string &shader_contents, GLenum shader_type);
-    GLuint load_shader_from_file(const std::string &shader_file, GLenum shader_type);
+    bool read_source(const std::string &path, std::string &contents) const;
+
+    GLuint build(const std::string &vertex_source, const std::string &fragment_source);
+    GLuint load_cached(const std::string &cache_path, uint64_t key) const;
+    void save_cached(GLuint program_id, const std::string &cache_path, uint64_t key) const;
+    void adopt(GLuint program_id);
+
+    GLuint m_program_id = 0;
+    unsigned int m_generation = 0;   // bumped every time m_program_id changes
 
-    GLuint m_program_id;
+    GLint m_colour_uniform = -1;
 
-    GLuint m_projection_matrix_uniform;
-    GLuint m_model_matrix_uniform;
-    GLuint m_view_matrix_uniform;
-    GLuint m_colour_uniform;
+    // Only used without uniform blocks
+    GLint m_projection_matrix_uniform = -1;
+    GLint m_view_matrix_uniform = -1;
+    GLint m_frame_time_uniform = -1;
 
-    GLuint m_position_attribute;
-    GLuint m_tex_coord_attribute;
+    // Uniforms belong to the program, so these get sent again after a swap
+    FrameData m_frame_data;
+    glm::vec4 m_colour = glm::vec4(1.0f);
+
+    std::string m_vertex_path;
+    std::string m_fragment_path;
+
+#ifdef LUNAR_SHADER_HOT_RELOAD
+    FileWatcher m_vertex_watcher;
+    FileWatcher m_fragment_watcher;
+#endif
 
-    GLuint m_vertex_shader;
-    GLuint m_fragment_shader;
-    
 public:
+    // False if nothing usable came of it. Loading again keeps the current program
+    // unless the new one builds.
+    bool load(const char *vertex_shader_file, const char *fragment_shader_file);
+
+    // Rebuilds from the same files. Same rule: the old program stays if this one fails.
+    bool reload();
 
-    void load(const char *vertex_shader_file, const char *fragment_shader_file);
+    // Checks the watchers and reloads if either source was saved. Does nothing in release builds.
+    void reload_if_changed(float delta_time);
 
-    void set_model_matrix(const glm::mat4 &matrix);
-    void set_projection_matrix(const glm::mat4 &matrix);
-    void set_view_matrix(const glm::mat4 &matrix);
+    // Frees the program. The GL context is gone by the time globals are destroyed,
+    // so it's on the caller, same as everything else holding GL objects.
+    void release();
+
+    // FrameUniforms calls this when there are no uniform blocks to share
+    void set_frame_data(const FrameData &data);
     void set_colour(float red, float green, float blue, float alpha);
-    
+
     GLuint const get_program_id()               const { return m_program_id;          };
-    GLuint const get_position_attribute()       const { return m_position_attribute;  };
-    GLuint const get_tex_coordinate_attribute() const { return m_tex_coord_attribute; };
-    
-    void set_program_id(GLuint program_id)                         { m_program_id = program_id;                   };
+
+    // Anything that caches locations from this program should look again when this moves on
+    unsigned int const get_generation()         const { return m_generation;          };
 };
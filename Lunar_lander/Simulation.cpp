@@ -0,0 +1,43 @@
+#include <cmath>
+#include "Simulation.h"
+
+LanderControl control_from_buttons(uint8_t buttons)
+{
+    LanderControl control;
+    control.x = (buttons & INPUT_LEFT) ? -1 : ((buttons & INPUT_RIGHT) ? 1 : 0);
+    control.up = (buttons & INPUT_THRUST) != 0;
+    return control;
+}
+
+uint8_t buttons_from_control(const LanderControl& control)
+{
+    uint8_t buttons = 0;
+    if (control.x < 0) buttons |= INPUT_LEFT;
+    if (control.x > 0) buttons |= INPUT_RIGHT;
+    if (control.up) buttons |= INPUT_THRUST;
+    return buttons;
+}
+
+glm::vec2 control_acceleration(const LanderControl& control, float fuel, const PhysicsParams& params)
+{
+    if (fuel <= 0.0f) return glm::vec2(0.0f, params.idle_vertical);
+
+    return glm::vec2(control.x * params.side_thrust, control.up ? params.up_thrust : params.idle_vertical);
+}
+
+void step_lander(LanderState& state, const LanderControl& control, float delta_time, const PhysicsParams& params)
+{
+    state.acceleration = control_acceleration(control, state.fuel, params);
+
+    // Same order as Entity::update
+    state.acceleration.y += params.gravity * delta_time;
+    state.movement += state.acceleration * delta_time;
+    state.position += state.movement * params.speed * delta_time;
+    state.acceleration *= params.acceleration_decay;
+
+    if ((fabsf(state.acceleration.x) > 0.01f || fabsf(state.acceleration.y) > 0.01f) && state.fuel > 0.0f)
+    {
+        state.fuel -= params.fuel_burn * delta_time;
+        if (state.fuel < 0.0f) state.fuel = 0.0f;
+    }
+}
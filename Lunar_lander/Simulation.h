@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include "glm/vec2.hpp"
+
+/**
+ * The lander's flight model, pulled out from Entity and process_input so it can be
+ * stepped without a window, a GL context or any entities. The game drives the real
+ * ship with these same numbers, so anything planned here plays out the same there.
+ */
+
+// Everything that shapes how the ship flies
+struct PhysicsParams
+{
+    float gravity = -0.5f;           // added to the vertical acceleration every second
+    float speed = 3.0f;              // movement is scaled by this on its way into position
+    float acceleration_decay = 0.98f; // per step, the "drag" Entity::update applies
+    float side_thrust = 1.5f;        // A and D
+    float up_thrust = 1.5f;          // W
+    float idle_vertical = -0.5f;     // vertical acceleration with W up
+    float fuel_burn = 5.0f;          // per second, whenever there's any acceleration at all
+};
+
+// How a level starts, tuned alongside the physics
+struct LevelParams
+{
+    float start_fuel = 100.0f;
+    float start_height = 2.0f;       // world y the ship appears at
+    float start_drift = 0.0f;        // sideways movement it already has
+};
+
+// What the keys say this frame: x is -1, 0 or 1, up is W
+struct LanderControl
+{
+    int x = 0;
+    bool up = false;
+};
+
+// The same thing as bits, which is what gets queued, stepped on and recorded
+enum InputButton
+{
+    INPUT_LEFT = 1 << 0,
+    INPUT_RIGHT = 1 << 1,
+    INPUT_THRUST = 1 << 2
+};
+
+struct LanderState
+{
+    glm::vec2 position;
+    glm::vec2 movement;
+    glm::vec2 acceleration;
+    float fuel;
+};
+
+// Left wins when both are held, the way A always has over D
+LanderControl control_from_buttons(uint8_t buttons);
+uint8_t buttons_from_control(const LanderControl& control);
+
+// The acceleration each simulation step sets for a control, which is all gravity once the fuel is gone
+glm::vec2 control_acceleration(const LanderControl& control, float fuel, const PhysicsParams& params);
+
+// One step of the ship: the acceleration, then Entity::update, then the fuel burn in step_simulation()
+void step_lander(LanderState& state, const LanderControl& control, float delta_time, const PhysicsParams& params);
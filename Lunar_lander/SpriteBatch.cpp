@@ -0,0 +1,104 @@
+#define GL_SILENCE_DEPRECATION
+
+#include "SpriteBatch.h"
+#include "ShaderProgram.h"
+#include "RenderBackend.h"
+#include "StreamBuffer.h"
+
+namespace
+{
+    // Both triangles of a unit quad, corners as (x, y) in [-0.5, 0.5]
+    constexpr float QUAD_CORNERS[6][2] =
+    {
+        { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f },
+        { -0.5f, -0.5f }, { 0.5f,  0.5f }, { -0.5f, 0.5f }
+    };
+}
+
+void SpriteBatch::init(StreamBuffer* stream)
+{
+    m_stream = stream;
+
+    // The stream is one buffer for good, and each run is drawn by its first vertex,
+    // so the vertex array never needs touching again
+    m_vertex_array = create_vertex_array();
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(m_vertex_array);
+        bind_attributes();
+        bind_vertex_array(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SpriteBatch::release()
+{
+    delete_vertex_array(m_vertex_array);
+    m_stream = nullptr;
+}
+
+void SpriteBatch::bind_attributes() const
+{
+    GLsizei stride = SPRITE_BATCH_FLOATS_PER_VERTEX * sizeof(float);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_stream->get_buffer());
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, false, stride, 0);
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glVertexAttribPointer(ATTRIBUTE_TEX_COORD, 2, GL_FLOAT, false, stride, (const void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+}
+
+void SpriteBatch::draw(const glm::mat4& model_matrix, const glm::vec4& uv)
+{
+    if (m_quad_count == SPRITE_BATCH_CAPACITY) flush();
+
+    if (m_vertices == nullptr)
+    {
+        // Room for a whole batch; flush() only keeps what got used
+        m_vertices = m_stream != nullptr ? (float*)m_stream->reserve(SPRITE_BATCH_CAPACITY * SPRITE_BATCH_QUAD_BYTES) : nullptr;
+        if (m_vertices == nullptr) return;   // out of stream this frame, the stream counts it
+    }
+
+    float* vertex = m_vertices + m_quad_count * 6 * SPRITE_BATCH_FLOATS_PER_VERTEX;
+
+    for (int i = 0; i < 6; i++)
+    {
+        float x = QUAD_CORNERS[i][0];
+        float y = QUAD_CORNERS[i][1];
+        glm::vec4 corner = model_matrix * glm::vec4(x, y, 0.0f, 1.0f);
+
+        vertex[0] = corner.x;
+        vertex[1] = corner.y;
+        vertex[2] = x < 0.0f ? uv.x : uv.z;
+        vertex[3] = y < 0.0f ? uv.w : uv.y;   // bottom of the quad is the bottom of the cell
+        vertex += SPRITE_BATCH_FLOATS_PER_VERTEX;
+    }
+    m_quad_count++;
+}
+
+void SpriteBatch::flush()
+{
+    if (m_quad_count == 0 || m_vertices == nullptr) return;
+
+    GLintptr offset = m_stream->commit(m_quad_count * SPRITE_BATCH_QUAD_BYTES);
+    GLint first = (GLint)(offset / (SPRITE_BATCH_FLOATS_PER_VERTEX * sizeof(float)));
+
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(m_vertex_array);
+        glDrawArrays(GL_TRIANGLES, first, m_quad_count * 6);
+        bind_vertex_array(0);
+    }
+    else
+    {
+        bind_attributes();
+        glDrawArrays(GL_TRIANGLES, first, m_quad_count * 6);
+        glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+        glDisableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    m_draw_count++;
+    m_quad_count = 0;
+    m_vertices = nullptr;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+#include <cstddef>
+
+class StreamBuffer;
+
+constexpr int SPRITE_BATCH_CAPACITY = 1024;           // quads per draw call
+constexpr int SPRITE_BATCH_FLOATS_PER_VERTEX = 4;     // x, y, u, v
+constexpr size_t SPRITE_BATCH_QUAD_BYTES = 6 * SPRITE_BATCH_FLOATS_PER_VERTEX * sizeof(float);
+
+/**
+ * Collects textured quads and draws them in as few calls as it can. There's no
+ * modelMatrix uniform any more: every quad's model matrix is applied to its
+ * corners here, so the only uniforms left are the per-frame ones in FrameUniforms.
+ *
+ * It doesn't know about programs or textures: the RenderQueue binds those and
+ * calls flush() whenever they're about to change, so everything between two
+ * flushes shares them. Quads are written straight into the StreamBuffer: a run
+ * reserves room for a full batch with its first quad and commits what it used
+ * when it's flushed. Only one reservation can be open at a time, so anything
+ * else that streams has to flush the batch first.
+ */
+class SpriteBatch
+{
+private:
+    StreamBuffer* m_stream = nullptr;
+    float* m_vertices = nullptr;     // into the stream's reservation, null until the run's first quad
+    int m_quad_count = 0;
+    int m_draw_count = 0;            // ever, for the queue's stats
+
+    GLuint m_vertex_array = 0;
+
+    void bind_attributes() const;
+
+public:
+    // GL side, needs a context and the stream already set up
+    void init(StreamBuffer* stream);
+    void release();
+
+    // A unit quad centred on the origin, through model_matrix. uv is (u0, v0, u1, v1),
+    // with v0 at the top of the quad the way the texture atlases are laid out.
+    void draw(const glm::mat4& model_matrix, const glm::vec4& uv);
+
+    // Draws whatever's been collected with the program and texture that are bound now
+    void flush();
+
+    int const get_draw_count() const { return m_draw_count; };
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Far enough apart that the two ends never share a cache line
+constexpr size_t SPSC_QUEUE_ALIGNMENT = 64;
+
+/**
+ * A fixed-size ring for exactly one producer thread and one consumer thread, with
+ * no locks. Each end owns one index and only reads the other's, so a push or pop
+ * is a copy and one release store. Capacity has to be a power of two; one slot
+ * always stays empty, so it holds Capacity - 1 items.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity has to be a power of two");
+
+    T m_items[Capacity];
+    alignas(SPSC_QUEUE_ALIGNMENT) std::atomic<size_t> m_head;   // next to pop, written by the consumer
+    alignas(SPSC_QUEUE_ALIGNMENT) std::atomic<size_t> m_tail;   // next to push, written by the producer
+
+public:
+    SpscQueue() : m_head(0), m_tail(0) {}
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. False if it's full, and the item isn't queued.
+    bool push(const T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) & (Capacity - 1);
+        if (next == m_head.load(std::memory_order_acquire)) return false;
+
+        m_items[tail] = item;
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. The oldest item without taking it, or null if there isn't one.
+    const T* peek() const
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return nullptr;
+        return &m_items[head];
+    }
+
+    // Consumer only, after peek() has found something
+    void pop()
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        m_head.store((head + 1) & (Capacity - 1), std::memory_order_release);
+    }
+
+    bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); };
+};
@@ -0,0 +1,164 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include <iostream>
+#include "StreamBuffer.h"
+
+namespace
+{
+    constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;   // only reached if the GPU is a whole second behind
+}
+
+void StreamBuffer::init(size_t segment_size)
+{
+    m_segment_size = segment_size;
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+#ifdef LUNAR_CORE_PROFILE
+    if (buffer_storage_supported())
+    {
+        // Coherent, so writes show up to the GPU without flushing them
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr size = (GLsizeiptr)(segment_size * STREAM_BUFFER_SEGMENTS);
+
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        m_mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        m_persistent = m_mapped != nullptr;
+
+        if (!m_persistent)
+        {
+            // Storage is immutable now, so start again with a buffer that isn't
+            std::cout << "StreamBuffer: couldn't map persistently, orphaning instead" << std::endl;
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &m_buffer);
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        }
+    }
+#endif
+
+    if (!m_persistent)
+    {
+        glBufferData(GL_ARRAY_BUFFER, segment_size, nullptr, GL_STREAM_DRAW);
+        m_staging.assign(segment_size, 0);
+        m_mapped = m_staging.data();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // So the first begin_frame() lands on segment 0
+    m_segment = STREAM_BUFFER_SEGMENTS - 1;
+    m_head = m_segment_end = 0;
+}
+
+void StreamBuffer::release()
+{
+#ifdef LUNAR_CORE_PROFILE
+    for (GLsync& fence : m_fences)
+    {
+        if (fence != nullptr) glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (m_persistent)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+#endif
+
+    if (m_buffer != 0) glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+    m_mapped = nullptr;
+    m_persistent = false;
+}
+
+void StreamBuffer::begin_frame()
+{
+    m_last_frame_bytes = m_frame_bytes;
+    m_peak_frame_bytes = std::max(m_peak_frame_bytes, m_frame_bytes);
+    m_frame_bytes = 0;
+    m_reserved = 0;
+
+#ifdef LUNAR_CORE_PROFILE
+    if (m_persistent)
+    {
+        m_segment = (m_segment + 1) % STREAM_BUFFER_SEGMENTS;
+
+        // Two frames have gone by since this segment was drawn from, so this should
+        // already have passed. If it hasn't, the GPU is far enough behind that waiting is all we can do.
+        GLsync& fence = m_fences[m_segment];
+        if (fence != nullptr)
+        {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            {
+                m_stall_count++;
+                glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        m_head = m_segment * m_segment_size;
+        m_segment_end = m_head + m_segment_size;
+        return;
+    }
+#endif
+
+    // Hand last frame's storage to the driver and start on fresh storage
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glBufferData(GL_ARRAY_BUFFER, m_segment_size, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_head = 0;
+    m_segment_end = m_segment_size;
+}
+
+void StreamBuffer::end_frame()
+{
+#ifdef LUNAR_CORE_PROFILE
+    if (m_persistent) m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+}
+
+size_t StreamBuffer::remaining(size_t alignment) const
+{
+    size_t start = (m_head + alignment - 1) / alignment * alignment;
+    if (m_mapped == nullptr || start >= m_segment_end) return 0;
+    return m_segment_end - start;
+}
+
+void* StreamBuffer::reserve(size_t bytes, size_t alignment)
+{
+    size_t start = (m_head + alignment - 1) / alignment * alignment;
+    if (m_mapped == nullptr || start + bytes > m_segment_end)
+    {
+        m_overflow_count++;
+        m_reserved = 0;
+        return nullptr;
+    }
+
+    m_head = start;
+    m_reserved = bytes;
+    return m_mapped + start;
+}
+
+GLintptr StreamBuffer::commit(size_t bytes)
+{
+    bytes = std::min(bytes, m_reserved);
+    GLintptr offset = (GLintptr)m_head;
+
+    // Persistent and coherent means the GPU can already see it; otherwise copy it up
+    if (!m_persistent && bytes > 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, m_mapped + m_head);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    m_head += bytes;
+    m_reserved = 0;
+    m_frame_bytes += bytes;
+    return offset;
+}
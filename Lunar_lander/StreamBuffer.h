@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "RenderBackend.h"
+
+// Per frame, and how many frames the GPU can be behind before a segment is reused
+constexpr size_t STREAM_BUFFER_SEGMENT_SIZE = 4 << 20;
+constexpr int STREAM_BUFFER_SEGMENTS = 3;
+
+/**
+ * One vertex buffer that everything streamed per frame is written into: sprite
+ * batches, text and particles. Writers reserve() room at the head, write their
+ * vertices straight into the pointer they get back, then commit() however much
+ * they actually used and draw from the offset it returns.
+ *
+ * With glBufferStorage the buffer is mapped once, persistently, and split into
+ * one segment per frame in flight. A fence goes down behind each frame's draws,
+ * and a segment is only written again once its fence has passed, which with
+ * three of them it always should have, so the CPU doesn't wait. Without it, the
+ * buffer is orphaned at the start of each frame and commit() copies up from a
+ * staging area with glBufferSubData.
+ */
+class StreamBuffer
+{
+private:
+    GLuint m_buffer = 0;
+    size_t m_segment_size = 0;
+    bool m_persistent = false;
+
+    char* m_mapped = nullptr;               // whole buffer when persistent, the staging area when not
+    std::vector<char> m_staging;
+#ifdef LUNAR_CORE_PROFILE
+    GLsync m_fences[STREAM_BUFFER_SEGMENTS] = {};
+#endif
+    int m_segment = 0;
+
+    size_t m_head = 0;                      // next free byte, from the start of the buffer
+    size_t m_segment_end = 0;
+    size_t m_reserved = 0;                  // bytes the last reserve() made room for
+
+    size_t m_frame_bytes = 0;               // committed so far this frame
+    size_t m_last_frame_bytes = 0;
+    size_t m_peak_frame_bytes = 0;
+    int m_stall_count = 0;                  // frames where a fence hadn't passed yet
+    int m_overflow_count = 0;               // reserves turned down for lack of room
+
+public:
+    // Needs a GL context
+    void init(size_t segment_size = STREAM_BUFFER_SEGMENT_SIZE);
+    void release();
+
+    // Once a frame before anything streams, and end_frame() after the last draw that used it
+    void begin_frame();
+    void end_frame();
+
+    // Room for up to `bytes` at the head, or null if this frame's segment is full
+    void* reserve(size_t bytes, size_t alignment = 16);
+
+    // The most reserve() would give right now at that alignment, for writers that can make do with less
+    size_t remaining(size_t alignment = 16) const;
+
+    // Takes the first `bytes` of the last reservation; returns where they start in the buffer
+    GLintptr commit(size_t bytes);
+
+    GLuint const get_buffer()              const { return m_buffer;           };
+    bool   const is_persistent()           const { return m_persistent;       };
+    size_t const get_segment_size()        const { return m_segment_size;     };
+    size_t const get_last_frame_bytes()    const { return m_last_frame_bytes; };
+    size_t const get_peak_frame_bytes()    const { return m_peak_frame_bytes; };
+    int    const get_stall_count()         const { return m_stall_count;      };
+    int    const get_overflow_count()      const { return m_overflow_count;   };
+};
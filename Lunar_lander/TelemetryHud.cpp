@@ -0,0 +1,193 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstring>
+#include "TelemetryHud.h"
+#include "NumberFormat.h"
+#include "SdfFont.h"
+#include "ShaderProgram.h"
+#include "RenderBackend.h"
+
+namespace
+{
+    constexpr int FLOATS_PER_VERTEX = 4;   // x, y, u, v
+    constexpr int VERTICES_PER_GLYPH = 6;
+    constexpr int FLOATS_PER_GLYPH = VERTICES_PER_GLYPH * FLOATS_PER_VERTEX;
+
+    constexpr float ROW_SPACING = 1.1f;    // line heights
+
+    struct FieldLayout
+    {
+        const char* label;
+        int decimals;
+    };
+
+    constexpr FieldLayout FIELDS[TELEMETRY_FIELD_COUNT] =
+    {
+        { "ALT",   2 },   // TELEMETRY_ALTITUDE, above the ground under the ship
+        { "VX",    2 },   // TELEMETRY_VELOCITY_X
+        { "VY",    2 },   // TELEMETRY_VELOCITY_Y
+        { "ACCEL", 2 },   // TELEMETRY_ACCELERATION, length of the thrust plus gravity
+        { "BURN",  1 },   // TELEMETRY_BURN_RATE, fuel a second
+        { "FPS",   0 },   // TELEMETRY_FPS
+        { "STDEV", 2 },   // TELEMETRY_FRAME_DEVIATION, of the frame time, ms
+        { "LAG",   1 },   // TELEMETRY_INPUT_LATENCY, estimated input to photon, ms
+    };
+
+    // The values come first in the buffer, so each slot is a fixed run from the start
+    int value_glyph(int field, int character)
+    {
+        return field * TELEMETRY_SLOT_WIDTH + character;
+    }
+}
+
+void TelemetryHud::init(const SdfFont& font, float size, glm::vec2 position)
+{
+    m_font = &font;
+    m_size = size;
+    m_cell_width = font.get_glyph('0').advance * size;
+
+    int label_glyphs = 0;
+    for (const FieldLayout& field : FIELDS) label_glyphs += (int)strlen(field.label);
+
+    int glyph_count = TELEMETRY_FIELD_COUNT * TELEMETRY_SLOT_WIDTH + label_glyphs;
+    m_vertices.assign(glyph_count * FLOATS_PER_GLYPH, 0.0f);
+    m_vertex_count = glyph_count * VERTICES_PER_GLYPH;
+
+    // Labels go in once, after the value slots
+    int label_glyph = TELEMETRY_FIELD_COUNT * TELEMETRY_SLOT_WIDTH;
+    for (int field = 0; field < TELEMETRY_FIELD_COUNT; field++)
+    {
+        float top = position.y - field * ROW_SPACING * size;
+        m_slot_origins[field] = glm::vec2(position.x + TELEMETRY_LABEL_WIDTH * m_cell_width, top);
+
+        float pen = position.x;
+        for (const char* character = FIELDS[field].label; *character != '\0'; character++)
+        {
+            write_character(&m_vertices[label_glyph++ * FLOATS_PER_GLYPH], *character, pen, top);
+            pen += m_cell_width;
+        }
+
+        // Blank until the first update, which then patches every character in
+        memset(m_shown[field], ' ', TELEMETRY_SLOT_WIDTH);
+    }
+
+    glGenBuffers(1, &m_vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(float), m_vertices.data(), GL_DYNAMIC_DRAW);
+
+    m_vertex_array = create_vertex_array();
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(m_vertex_array);
+        bind_attributes();
+        bind_vertex_array(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TelemetryHud::release()
+{
+    delete_vertex_array(m_vertex_array);
+    if (m_vertex_buffer != 0) glDeleteBuffers(1, &m_vertex_buffer);
+    m_vertex_buffer = 0;
+    m_vertex_count = 0;
+}
+
+void TelemetryHud::bind_attributes() const
+{
+    GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, false, stride, 0);
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glVertexAttribPointer(ATTRIBUTE_TEX_COORD, 2, GL_FLOAT, false, stride, (const void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+}
+
+void TelemetryHud::write_character(float* vertices, char character, float cell_left, float top) const
+{
+    const SdfGlyph& glyph = m_font->get_glyph(character);
+
+    // Blanks are a quad with no area, so the vertex count never changes
+    if (glyph.width <= 0.0f)
+    {
+        memset(vertices, 0, FLOATS_PER_GLYPH * sizeof(float));
+        return;
+    }
+
+    // Narrow characters like '.' and '-' sit in the middle of their cell
+    float left = cell_left + (m_cell_width - glyph.advance * m_size) * 0.5f + glyph.x_offset * m_size;
+    float right = left + glyph.width * m_size;
+    float glyph_top = top - glyph.y_offset * m_size;
+    float bottom = glyph_top - glyph.height * m_size;
+
+    const float corners[FLOATS_PER_GLYPH] =
+    {
+        left,  bottom,    glyph.uv.x, glyph.uv.w,
+        right, bottom,    glyph.uv.z, glyph.uv.w,
+        right, glyph_top, glyph.uv.z, glyph.uv.y,
+        left,  bottom,    glyph.uv.x, glyph.uv.w,
+        right, glyph_top, glyph.uv.z, glyph.uv.y,
+        left,  glyph_top, glyph.uv.x, glyph.uv.y,
+    };
+    memcpy(vertices, corners, sizeof(corners));
+}
+
+void TelemetryHud::update(const float values[TELEMETRY_FIELD_COUNT])
+{
+    if (m_vertex_buffer == 0) return;
+
+    bool bound = false;
+    for (int field = 0; field < TELEMETRY_FIELD_COUNT; field++)
+    {
+        char text[TELEMETRY_SLOT_WIDTH];
+        format_fixed(text, TELEMETRY_SLOT_WIDTH, values[field], FIELDS[field].decimals);
+
+        int first = TELEMETRY_SLOT_WIDTH, last = -1;
+        for (int i = 0; i < TELEMETRY_SLOT_WIDTH; i++)
+        {
+            if (text[i] == m_shown[field][i]) continue;
+
+            m_shown[field][i] = text[i];
+            write_character(&m_vertices[value_glyph(field, i) * FLOATS_PER_GLYPH], text[i],
+                m_slot_origins[field].x + i * m_cell_width, m_slot_origins[field].y);
+
+            if (i < first) first = i;
+            last = i;
+            m_patched_characters++;
+        }
+        if (last < 0) continue;
+
+        // One upload a slot, from its first changed character to its last
+        if (!bound)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+            bound = true;
+        }
+        GLintptr offset = value_glyph(field, first) * FLOATS_PER_GLYPH * sizeof(float);
+        GLsizeiptr bytes = (last - first + 1) * FLOATS_PER_GLYPH * sizeof(float);
+        glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, &m_vertices[value_glyph(field, first) * FLOATS_PER_GLYPH]);
+        m_uploads++;
+    }
+
+    if (bound) glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TelemetryHud::draw() const
+{
+    if (m_vertex_count == 0) return;
+
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(m_vertex_array);
+        glDrawArrays(GL_TRIANGLES, 0, m_vertex_count);
+        bind_vertex_array(0);
+        return;
+    }
+
+    bind_attributes();
+    glDrawArrays(GL_TRIANGLES, 0, m_vertex_count);
+    glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+    glDisableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
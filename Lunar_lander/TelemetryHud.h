@@ -0,0 +1,71 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <vector>
+#include "glm/vec2.hpp"
+
+class SdfFont;
+
+enum TelemetryField
+{
+    TELEMETRY_ALTITUDE,
+    TELEMETRY_VELOCITY_X,
+    TELEMETRY_VELOCITY_Y,
+    TELEMETRY_ACCELERATION,
+    TELEMETRY_BURN_RATE,
+    TELEMETRY_FPS,
+    TELEMETRY_FRAME_DEVIATION,
+    TELEMETRY_INPUT_LATENCY,
+    TELEMETRY_FIELD_COUNT
+};
+
+constexpr int TELEMETRY_SLOT_WIDTH = 8;       // characters a value gets, right-aligned
+constexpr int TELEMETRY_LABEL_WIDTH = 6;      // characters before the value starts
+
+/**
+ * Live flight readouts in the corner, one row per field: a label and a value.
+ * Everything is laid out once in init() into one vertex buffer, labels and all,
+ * and every value character has its own fixed quad in there. Each frame the
+ * values are formatted into stack buffers, compared with what's on screen, and
+ * only the characters that changed are rewritten and uploaded, so a value that
+ * holds still costs a compare. Drawn in one call, like a TextMesh.
+ */
+class TelemetryHud
+{
+private:
+    GLuint m_vertex_buffer = 0;
+    GLuint m_vertex_array = 0;
+    int m_vertex_count = 0;
+
+    const SdfFont* m_font = nullptr;
+    float m_size = 0.0f;
+    float m_cell_width = 0.0f;                            // every value character is one digit wide
+    glm::vec2 m_slot_origins[TELEMETRY_FIELD_COUNT];      // top left of each value
+
+    char m_shown[TELEMETRY_FIELD_COUNT][TELEMETRY_SLOT_WIDTH];   // what's in the buffer now
+    std::vector<float> m_vertices;                        // CPU copy, so a patch is a memcpy and an upload
+
+    int m_patched_characters = 0;
+    int m_uploads = 0;
+
+    void bind_attributes() const;
+    void write_character(float* vertices, char character, float cell_left, float top) const;
+
+public:
+    // Needs a GL context and a loaded font. `position` is the top left of the first row, in screen units.
+    void init(const SdfFont& font, float size, glm::vec2 position);
+    void release();
+
+    // Formats every field and patches whichever characters changed
+    void update(const float values[TELEMETRY_FIELD_COUNT]);
+
+    // With the SDF program and the font's atlas bound
+    void draw() const;
+
+    int const get_patched_characters() const { return m_patched_characters; };
+    int const get_uploads()            const { return m_uploads;            };
+};
@@ -0,0 +1,372 @@
+#include <cmath>
+#include <algorithm>
+#include "glm/geometric.hpp"
+#include "Terrain.h"
+#include "ConvexHull.h"
+#include "RenderBackend.h"
+
+namespace
+{
+    constexpr float PAD_MARKER_HEIGHT = 0.06f;
+}
+
+void Terrain::release()
+{
+    delete_vertex_array(m_vertex_array);
+    if (m_vertex_buffer != 0) glDeleteBuffers(1, &m_vertex_buffer);
+    if (m_index_buffer != 0) glDeleteBuffers(1, &m_index_buffer);
+    m_vertex_buffer = m_index_buffer = 0;
+}
+
+float Terrain::sample_height(float x) const
+{
+    return terrain_height(m_seed, m_offset_x + x);
+}
+
+void Terrain::generate(unsigned int seed, float origin_x, int segment_count, float spacing, double offset_x)
+{
+    m_seed = seed;
+    m_offset_x = offset_x;
+    m_origin_x = origin_x;
+    m_spacing = spacing;
+    m_segment_count = (segment_count + TERRAIN_BLOCK_SEGMENTS - 1) / TERRAIN_BLOCK_SEGMENTS * TERRAIN_BLOCK_SEGMENTS;
+
+    m_heights.resize(m_segment_count + 1);
+    for (int i = 0; i <= m_segment_count; i++)
+    {
+        m_heights[i] = terrain_height(seed, offset_x + (double)origin_x + (double)i * spacing);
+    }
+
+    build_pyramid();
+    build_mesh();
+}
+
+void Terrain::build_pyramid()
+{
+    m_level_offsets.clear();
+    m_level_sizes.clear();
+
+    int total = 0;
+    for (int size = m_segment_count; ; size = (size + 1) / 2)
+    {
+        m_level_offsets.push_back(total);
+        m_level_sizes.push_back(size);
+        total += size;
+        if (size == 1) break;
+    }
+
+    m_max_pyramid.resize(total);
+    m_min_pyramid.resize(total);
+
+    // A segment is a straight line, so its extremes are its endpoints
+    for (int i = 0; i < m_segment_count; i++)
+    {
+        m_max_pyramid[i] = std::max(m_heights[i], m_heights[i + 1]);
+        m_min_pyramid[i] = std::min(m_heights[i], m_heights[i + 1]);
+    }
+
+    for (size_t level = 1; level < m_level_sizes.size(); level++)
+    {
+        int below = m_level_offsets[level - 1];
+        int below_size = m_level_sizes[level - 1];
+        int here = m_level_offsets[level];
+
+        for (int i = 0; i < m_level_sizes[level]; i++)
+        {
+            int left = below + 2 * i;
+            int right = 2 * i + 1 < below_size ? left + 1 : left;
+
+            m_max_pyramid[here + i] = std::max(m_max_pyramid[left], m_max_pyramid[right]);
+            m_min_pyramid[here + i] = std::min(m_min_pyramid[left], m_min_pyramid[right]);
+        }
+    }
+}
+
+float Terrain::query_pyramid(const std::vector<float>& pyramid, float min_x, float max_x, bool want_max) const
+{
+    int first = (int)floorf((min_x - m_origin_x) / m_spacing);
+    int last = (int)floorf((max_x - m_origin_x) / m_spacing);
+    first = std::max(first, 0);
+    last = std::min(last, m_segment_count - 1);
+
+    float result = want_max ? -INFINITY : INFINITY;
+    if (first > last) return result;
+
+    // Climb the pyramid, picking up the odd nodes at either end of the range as we go
+    for (size_t level = 0; first <= last; level++)
+    {
+        const float* values = pyramid.data() + m_level_offsets[level];
+
+        if (first & 1)
+        {
+            result = want_max ? std::max(result, values[first]) : std::min(result, values[first]);
+            first++;
+        }
+        if (!(last & 1) && first <= last)
+        {
+            result = want_max ? std::max(result, values[last]) : std::min(result, values[last]);
+            last--;
+        }
+
+        first >>= 1;
+        last >>= 1;
+    }
+
+    return result;
+}
+
+float Terrain::max_height(float min_x, float max_x) const
+{
+    return query_pyramid(m_max_pyramid, min_x, max_x, true);
+}
+
+float Terrain::min_height(float min_x, float max_x) const
+{
+    return query_pyramid(m_min_pyramid, min_x, max_x, false);
+}
+
+float Terrain::height_at(float x) const
+{
+    float t = (x - m_origin_x) / m_spacing;
+    int i = (int)floorf(t);
+
+    if (i < 0) return m_heights.front();
+    if (i >= m_segment_count) return m_heights.back();
+
+    float fraction = t - i;
+    return m_heights[i] + (m_heights[i + 1] - m_heights[i]) * fraction;
+}
+
+bool Terrain::collide(const glm::vec2* vertices, int vertex_count, ContactManifold& manifold) const
+{
+    glm::vec2 low = vertices[0], high = vertices[0];
+    for (int i = 1; i < vertex_count; i++)
+    {
+        low = glm::min(low, vertices[i]);
+        high = glm::max(high, vertices[i]);
+    }
+
+    // Most frames the whole outline is above the tallest ground under it
+    if (max_height(low.x, high.x) < low.y) return false;
+
+    // Deepest two penetrations, either an outline vertex under the ground...
+    glm::vec2 points[MAX_CONTACT_POINTS];
+    float depths[MAX_CONTACT_POINTS] = { 0.0f, 0.0f };
+    int count = 0;
+
+    auto add_contact = [&](glm::vec2 point, float depth) {
+        if (count < MAX_CONTACT_POINTS)
+        {
+            points[count] = point;
+            depths[count++] = depth;
+        }
+        else if (depth > std::min(depths[0], depths[1]))
+        {
+            int slot = depths[0] < depths[1] ? 0 : 1;
+            points[slot] = point;
+            depths[slot] = depth;
+        }
+    };
+
+    for (int i = 0; i < vertex_count; i++)
+    {
+        float depth = height_at(vertices[i].x) - vertices[i].y;
+        if (depth > 0.0f) add_contact(vertices[i], depth);
+    }
+
+    // ...or a peak in the ground poking up into the outline
+    int first = std::max(0, (int)ceilf((low.x - m_origin_x) / m_spacing));
+    int last = std::min(m_segment_count, (int)floorf((high.x - m_origin_x) / m_spacing));
+    for (int s = first; s <= last; s++)
+    {
+        glm::vec2 peak(m_origin_x + s * m_spacing, m_heights[s]);
+
+        float depth = INFINITY;
+        for (int i = 0; i < vertex_count && depth > 0.0f; i++)
+        {
+            glm::vec2 a = vertices[i];
+            glm::vec2 edge = vertices[(i + 1) % vertex_count] - a;
+            glm::vec2 inward = glm::normalize(glm::vec2(-edge.y, edge.x));
+            depth = std::min(depth, glm::dot(inward, peak - a));
+        }
+        if (depth > 0.0f) add_contact(peak, depth);
+    }
+
+    if (count == 0) return false;
+
+    int deepest = count > 1 && depths[1] > depths[0] ? 1 : 0;
+
+    // Push back out along the slope of the ground under the deepest point
+    float x = points[deepest].x;
+    float slope = (height_at(x + m_spacing * 0.5f) - height_at(x - m_spacing * 0.5f)) / m_spacing;
+
+    manifold.normal = glm::normalize(glm::vec2(-slope, 1.0f));
+    manifold.penetration = depths[deepest] * manifold.normal.y;
+    manifold.point_count = count;
+    for (int i = 0; i < count; i++) manifold.points[i] = points[i];
+
+    return true;
+}
+
+bool Terrain::is_landing_pad(float min_x, float max_x) const
+{
+    int64_t cell = (int64_t)floor((m_offset_x + min_x) / LANDING_PAD_INTERVAL);
+    double centre = landing_pad_centre(m_seed, cell) - m_offset_x;
+
+    return min_x >= centre - LANDING_PAD_HALF_WIDTH && max_x <= centre + LANDING_PAD_HALF_WIDTH;
+}
+
+float Terrain::nearest_landing_pad(float x) const
+{
+    return (float)(::nearest_landing_pad(m_seed, m_offset_x + x) - m_offset_x);
+}
+
+void Terrain::build_mesh()
+{
+    // Two vertices per sample, the ground and a point far below it, so the
+    // strip fills everything underneath. Pad markers go on the end.
+    m_vertex_data.clear();
+    m_index_data.clear();
+
+    float bottom = TERRAIN_BASE_HEIGHT - TERRAIN_DEPTH;
+    for (int i = 0; i <= m_segment_count; i++)
+    {
+        float x = m_origin_x + i * m_spacing;
+        m_vertex_data.insert(m_vertex_data.end(), { x, m_heights[i], x, bottom });
+    }
+
+    m_pad_vertex_start = (int)m_vertex_data.size() / 2;
+    int64_t first_cell = (int64_t)floor((m_offset_x + m_origin_x) / LANDING_PAD_INTERVAL);
+    int64_t last_cell = (int64_t)floor((m_offset_x + get_end_x()) / LANDING_PAD_INTERVAL);
+    for (int64_t cell = first_cell; cell <= last_cell; cell++)
+    {
+        float centre = (float)(landing_pad_centre(m_seed, cell) - m_offset_x);
+        float left = centre - LANDING_PAD_HALF_WIDTH, right = centre + LANDING_PAD_HALF_WIDTH;
+        if (left < m_origin_x || right > get_end_x()) continue;
+
+        float low = height_at(centre), high = low + PAD_MARKER_HEIGHT;
+        m_vertex_data.insert(m_vertex_data.end(), {
+            left, low, right, low, right, high,
+            left, low, right, high, left, high
+            });
+    }
+    m_pad_vertex_count = (int)m_vertex_data.size() / 2 - m_pad_vertex_start;
+
+    // Every block gets one strip per LOD, all in the same index buffer
+    int block_count = m_segment_count / TERRAIN_BLOCK_SEGMENTS;
+    m_lod_counts.resize(block_count * TERRAIN_LOD_LEVELS);
+    m_lod_offsets.resize(block_count * TERRAIN_LOD_LEVELS);
+
+    for (int block = 0; block < block_count; block++)
+    {
+        for (int lod = 0; lod < TERRAIN_LOD_LEVELS; lod++)
+        {
+            int stride = 1 << lod;
+            m_lod_offsets[block * TERRAIN_LOD_LEVELS + lod] = m_index_data.size();
+
+            for (int s = 0; s <= TERRAIN_BLOCK_SEGMENTS; s += stride)
+            {
+                GLuint sample = block * TERRAIN_BLOCK_SEGMENTS + s;
+                m_index_data.push_back(sample * 2);
+                m_index_data.push_back(sample * 2 + 1);
+            }
+            m_lod_counts[block * TERRAIN_LOD_LEVELS + lod] = (GLsizei)(m_index_data.size() - m_lod_offsets[block * TERRAIN_LOD_LEVELS + lod]);
+        }
+    }
+
+    m_draw_counts.resize(block_count);
+    m_draw_offsets.resize(block_count);
+}
+
+void Terrain::upload()
+{
+    if (m_vertex_buffer == 0) glGenBuffers(1, &m_vertex_buffer);
+    if (m_index_buffer == 0) glGenBuffers(1, &m_index_buffer);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, m_vertex_data.size() * sizeof(float), m_vertex_data.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_index_data.size() * sizeof(GLuint), m_index_data.data(), GL_STATIC_DRAW);
+
+    // Tiles get generated again as the world streams, but into the same buffers,
+    // so the vertex array only needs setting up the first time
+    if (m_vertex_array == 0)
+    {
+        m_vertex_array = create_vertex_array();
+        if (m_vertex_array != 0)
+        {
+            bind_vertex_array(m_vertex_array);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+            glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, false, 0, 0);
+            glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+            bind_vertex_array(0);
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void Terrain::set_offset(double offset_x)
+{
+    float shift = (float)(offset_x - m_offset_x);
+    m_offset_x = offset_x;
+    m_origin_x -= shift;
+
+    // Every other float is an x, the ground and pad vertices alike
+    for (size_t i = 0; i < m_vertex_data.size(); i += 2) m_vertex_data[i] -= shift;
+}
+
+void Terrain::render(ShaderProgram* program, float focus_x, float view_min_x, float view_max_x)
+{
+    if (m_vertex_buffer == 0) return;
+
+    // Pick a stride per visible block: full detail near the focus, coarser further out
+    float block_width = TERRAIN_BLOCK_SEGMENTS * m_spacing;
+    int draw_count = 0;
+    for (size_t block = 0; block < m_draw_counts.size(); block++)
+    {
+        float left = m_origin_x + block * block_width;
+        if (left > view_max_x || left + block_width < view_min_x) continue;
+
+        float distance = std::max(0.0f, fabsf(left + block_width / 2.0f - focus_x) - block_width / 2.0f);
+        int lod = std::min(TERRAIN_LOD_LEVELS - 1, (int)(distance / TERRAIN_LOD_DISTANCE));
+
+        m_draw_counts[draw_count] = m_lod_counts[block * TERRAIN_LOD_LEVELS + lod];
+        m_draw_offsets[draw_count] = (const void*)(m_lod_offsets[block * TERRAIN_LOD_LEVELS + lod] * sizeof(GLuint));
+        draw_count++;
+    }
+    if (draw_count == 0) return;
+
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(m_vertex_array);
+    }
+    else
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+        glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, false, 0, 0);
+        glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    }
+
+    // The whole strip in one call
+    program->set_colour(0.55f, 0.55f, 0.58f, 1.0f);
+    glMultiDrawElements(GL_TRIANGLE_STRIP, m_draw_counts.data(), GL_UNSIGNED_INT, m_draw_offsets.data(), draw_count);
+
+    if (m_pad_vertex_count > 0)
+    {
+        program->set_colour(0.95f, 0.75f, 0.2f, 1.0f);
+        glDrawArrays(GL_TRIANGLES, m_pad_vertex_start, m_pad_vertex_count);
+    }
+
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(0);
+        return;
+    }
+
+    glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include "glm/vec2.hpp"
+#include "ShaderProgram.h"
+#include "Heightfield.h"
+
+struct ContactManifold;
+
+constexpr float TERRAIN_DEPTH = 20.0f;       // how far below the base the strip is filled in
+
+// The strip is drawn in blocks of this many segments, and each block picks its
+// own stride (1, 2, 4, 8...) from how far it is from the focus point
+constexpr int TERRAIN_BLOCK_SEGMENTS = 64;
+constexpr int TERRAIN_LOD_LEVELS = 4;
+constexpr float TERRAIN_LOD_DISTANCE = 6.0f;
+
+/**
+ * A span of procedural heightfield. Heights come from terrain_height(), a pure
+ * function of the seed and world x, so any span of the world can be generated on its own and will line up
+ * with its neighbours. Collision queries go through a min/max pyramid over the
+ * segments, so asking about a range of x costs O(log n) rather than O(n).
+ *
+ * Every x going in or out is local, and world x is that plus the offset, kept in
+ * a double. That way the floats stay small however far out the span is.
+ */
+class Terrain
+{
+private:
+    unsigned int m_seed = 0;
+    double m_offset_x = 0.0;            // world x of local 0
+    float m_origin_x = 0.0f;
+    float m_spacing = 0.0f;
+    int m_segment_count = 0;
+
+    std::vector<float> m_heights;       // one per sample, m_segment_count + 1 of them
+
+    // Level 0 has one entry per segment, each level above halves the count
+    std::vector<float> m_max_pyramid;
+    std::vector<float> m_min_pyramid;
+    std::vector<int> m_level_offsets;
+    std::vector<int> m_level_sizes;
+
+    // Mesh built alongside the heights, kept around so generating again reuses the storage
+    std::vector<float> m_vertex_data;
+    std::vector<GLuint> m_index_data;
+
+    GLuint m_vertex_buffer = 0;
+    GLuint m_index_buffer = 0;
+    GLuint m_vertex_array = 0;   // 0 where there are no vertex arrays
+    int m_pad_vertex_start = 0;
+    int m_pad_vertex_count = 0;
+
+    // Per-block index ranges for each LOD, and the scratch arrays we hand to glMultiDrawElements
+    std::vector<GLsizei> m_lod_counts;
+    std::vector<size_t> m_lod_offsets;
+    std::vector<GLsizei> m_draw_counts;
+    std::vector<const void*> m_draw_offsets;
+
+    void build_pyramid();
+    void build_mesh();
+    float query_pyramid(const std::vector<float>& pyramid, float min_x, float max_x, bool want_max) const;
+
+public:
+    // Frees the GPU buffers. Left to the caller rather than a destructor, since
+    // the GL context is long gone by the time globals get destroyed.
+    void release();
+
+    // Heights and mesh for `segment_count` segments starting at `origin_x`. Rounds
+    // segment_count up to a whole number of blocks. Touches no GL, so any thread can call it.
+    void generate(unsigned int seed, float origin_x, int segment_count, float spacing, double offset_x = 0.0);
+
+    // Sends the mesh from generate() to the GPU, so it has to be on the GL thread
+    void upload();
+
+    // Moves local 0 to world `offset_x`, sliding the span and its mesh to match. Needs upload() again after.
+    void set_offset(double offset_x);
+
+    float sample_height(float x) const;    // straight from the noise, no table involved
+    float height_at(float x) const;        // interpolated from the table
+    float max_height(float min_x, float max_x) const;
+    float min_height(float min_x, float max_x) const;
+
+    // Tests a convex outline against the ground, filling in the normal and depth if it's touching
+    bool collide(const glm::vec2* vertices, int vertex_count, ContactManifold& manifold) const;
+
+    // True if [min_x, max_x] sits entirely on one landing pad
+    bool is_landing_pad(float min_x, float max_x) const;
+
+    // Centre of the pad closest to x, which needn't be inside this span
+    float nearest_landing_pad(float x) const;
+
+    // `program` has to be the one bound, it only sets its colour
+    void render(ShaderProgram* program, float focus_x, float view_min_x, float view_max_x);
+
+    double const get_offset_x() const { return m_offset_x; }
+    float const get_origin_x() const { return m_origin_x; }
+    float const get_end_x() const { return m_origin_x + m_segment_count * m_spacing; }
+};
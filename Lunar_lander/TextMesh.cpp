@@ -0,0 +1,134 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include <cstring>
+#include "TextMesh.h"
+#include "SdfFont.h"
+#include "ShaderProgram.h"
+#include "RenderBackend.h"
+
+namespace
+{
+    constexpr int FLOATS_PER_VERTEX = 4;   // x, y, u, v
+    constexpr int VERTICES_PER_GLYPH = 6;
+}
+
+void TextMesh::init(int capacity)
+{
+    m_capacity = capacity;
+    m_vertices.resize(capacity * VERTICES_PER_GLYPH * FLOATS_PER_VERTEX);
+    m_text.reserve(capacity);
+}
+
+void TextMesh::upload()
+{
+    // Whatever got built before there was a buffer goes up with it
+    glGenBuffers(1, &m_vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(float), m_vertices.data(), GL_DYNAMIC_DRAW);
+
+    m_vertex_array = create_vertex_array();
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(m_vertex_array);
+        bind_attributes();
+        bind_vertex_array(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TextMesh::release()
+{
+    delete_vertex_array(m_vertex_array);
+    if (m_vertex_buffer != 0) glDeleteBuffers(1, &m_vertex_buffer);
+    m_vertex_buffer = 0;
+    m_vertex_count = 0;
+}
+
+void TextMesh::bind_attributes() const
+{
+    GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, false, stride, 0);
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glVertexAttribPointer(ATTRIBUTE_TEX_COORD, 2, GL_FLOAT, false, stride, (const void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+}
+
+void TextMesh::set_text(const SdfFont& font, const char* text, float size, float spacing, glm::vec2 position)
+{
+    if (m_capacity == 0) return;
+
+    int length = (int)std::min(strlen(text), (size_t)m_capacity);
+    bool unchanged = &font == m_font && size == m_size && spacing == m_spacing && position == m_position
+        && m_text.compare(0, std::string::npos, text, length) == 0;
+    if (unchanged) return;
+
+    m_text.assign(text, length);
+    m_font = &font;
+    m_size = size;
+    m_spacing = spacing;
+    m_position = position;
+
+    float* vertex = m_vertices.data();
+    float pen = position.x;
+    int glyph_count = 0;
+
+    for (int i = 0; i < length; i++)
+    {
+        const SdfGlyph& glyph = font.get_glyph(text[i]);
+
+        // Spaces only move the pen
+        if (glyph.width > 0.0f)
+        {
+            float left = pen + glyph.x_offset * size;
+            float right = left + glyph.width * size;
+            float top = position.y - glyph.y_offset * size;
+            float bottom = top - glyph.height * size;
+
+            // Both triangles, bottom-left round to top-left, v0 at the top
+            const float corners[VERTICES_PER_GLYPH][FLOATS_PER_VERTEX] =
+            {
+                { left,  bottom, glyph.uv.x, glyph.uv.w },
+                { right, bottom, glyph.uv.z, glyph.uv.w },
+                { right, top,    glyph.uv.z, glyph.uv.y },
+                { left,  bottom, glyph.uv.x, glyph.uv.w },
+                { right, top,    glyph.uv.z, glyph.uv.y },
+                { left,  top,    glyph.uv.x, glyph.uv.y },
+            };
+            memcpy(vertex, corners, sizeof(corners));
+            vertex += VERTICES_PER_GLYPH * FLOATS_PER_VERTEX;
+            glyph_count++;
+        }
+
+        pen += glyph.advance * size + spacing;
+    }
+
+    m_vertex_count = glyph_count * VERTICES_PER_GLYPH;
+    m_rebuild_count++;
+    if (m_vertex_buffer == 0) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertex_count * FLOATS_PER_VERTEX * sizeof(float), m_vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TextMesh::draw() const
+{
+    if (m_vertex_count == 0 || m_vertex_buffer == 0) return;
+
+    if (m_vertex_array != 0)
+    {
+        bind_vertex_array(m_vertex_array);
+        glDrawArrays(GL_TRIANGLES, 0, m_vertex_count);
+        bind_vertex_array(0);
+        return;
+    }
+
+    bind_attributes();
+    glDrawArrays(GL_TRIANGLES, 0, m_vertex_count);
+    glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+    glDisableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <string>
+#include <vector>
+#include "glm/vec2.hpp"
+
+class SdfFont;
+
+constexpr int TEXT_MESH_CAPACITY = 64;   // characters, anything past that is cut off
+
+/**
+ * A line of text built into its own vertex buffer and kept there. set_text() is
+ * called every frame, but only rebuilds the mesh when the text, or where and how
+ * big it is, has actually changed, so a HUD line that changes a few times a
+ * second costs one small upload then and a single draw call every frame.
+ * Same vertex layout as the SpriteBatch: x, y, u, v.
+ */
+class TextMesh
+{
+private:
+    GLuint m_vertex_buffer = 0;
+    GLuint m_vertex_array = 0;
+    int m_capacity = 0;
+    int m_vertex_count = 0;
+
+    // What the mesh was last built from
+    std::string m_text;
+    const SdfFont* m_font = nullptr;
+    float m_size = 0.0f;
+    float m_spacing = 0.0f;
+    glm::vec2 m_position = glm::vec2(0.0f);
+
+    std::vector<float> m_vertices;   // scratch for a rebuild, sized once
+    int m_rebuild_count = 0;
+
+    void bind_attributes() const;
+
+public:
+    // Sizes the scratch up front, nothing allocates after this
+    void init(int capacity = TEXT_MESH_CAPACITY);
+
+    // GL side, needs a context. Until then set_text() still builds the mesh, it just doesn't upload it.
+    void upload();
+    void release();
+
+    // `position` is the top left of the line, size is the line height, both in whatever space the program draws in
+    void set_text(const SdfFont& font, const char* text, float size, float spacing, glm::vec2 position);
+
+    // With the SDF program and the font's atlas bound
+    void draw() const;
+
+    int const get_rebuild_count() const { return m_rebuild_count; };
+};
@@ -0,0 +1,87 @@
+#include "ThreadPool.h"
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::start(int worker_count)
+{
+    if (worker_count <= 0) worker_count = (int)std::thread::hardware_concurrency() - 1;
+    if (worker_count < 1) worker_count = 1;
+
+    m_stopping = false;
+    for (int i = 0; i < worker_count; i++) m_workers.emplace_back(&ThreadPool::worker_loop, this);
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+
+    for (std::thread& worker : m_workers) worker.join();
+    m_workers.clear();
+}
+
+void ThreadPool::work_through_tasks()
+{
+    while (true)
+    {
+        int task = m_next_task.fetch_add(1, std::memory_order_relaxed);
+        if (task >= m_task_count) return;
+
+        m_task(m_context, task);
+    }
+}
+
+void ThreadPool::worker_loop()
+{
+    unsigned int seen_generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_available.wait(lock, [&] { return m_stopping || m_generation != seen_generation; });
+            if (m_stopping) return;
+            seen_generation = m_generation;
+        }
+
+        work_through_tasks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy_workers == 0) m_work_done.notify_one();
+    }
+}
+
+void ThreadPool::run(int task_count, ThreadPoolTask task, void* context)
+{
+    if (task_count <= 0) return;
+
+    // No workers (not started, or already stopped), so it's all on us
+    if (m_workers.empty())
+    {
+        for (int i = 0; i < task_count; i++) task(context, i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = task;
+        m_context = context;
+        m_task_count = task_count;
+        m_next_task.store(0, std::memory_order_relaxed);
+        m_busy_workers = (int)m_workers.size();
+        m_generation++;
+    }
+    m_work_available.notify_all();
+
+    work_through_tasks();
+
+    // Every worker has to check in, even the ones that found nothing left, before the next run can reuse the fields
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_work_done.wait(lock, [this] { return m_busy_workers == 0; });
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A task gets the context it was run with and its index, 0 to task_count - 1
+typedef void (*ThreadPoolTask)(void* context, int task);
+
+/**
+ * A handful of long-lived workers for splitting one job into independent pieces.
+ * run() hands out task indices from a shared counter, helps out on the calling
+ * thread, and returns once every task is done. Tasks are a plain function pointer
+ * and a context rather than std::function, so running a job never allocates.
+ */
+class ThreadPool
+{
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_work_done;
+
+    ThreadPoolTask m_task = nullptr;
+    void* m_context = nullptr;
+    int m_task_count = 0;
+    std::atomic<int> m_next_task;
+    int m_busy_workers = 0;
+    unsigned int m_generation = 0;  // bumped per run() so workers can tell a new job from a spurious wake
+    bool m_stopping = false;
+
+    void worker_loop();
+    void work_through_tasks();
+
+public:
+    ThreadPool() : m_next_task(0) {}
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    // 0 picks one fewer than the hardware has, leaving the calling thread its own core
+    void start(int worker_count = 0);
+    void stop();
+
+    void run(int task_count, ThreadPoolTask task, void* context);
+
+    int const get_thread_count() const { return (int)m_workers.size() + 1; };
+};
@@ -0,0 +1,317 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <random>
+#include "glm/mat4x4.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "ShaderProgram.h"
+#include "Entity.h"
+#include "ConvexHull.h"
+#include "AABBTree.h"
+#include "WorldStreamer.h"
+
+WorldStreamer::~WorldStreamer()
+{
+    stop();
+}
+
+void WorldStreamer::start(unsigned int seed, ObjectPool<Entity>* entities, PoolHandle asteroid_prototype, AABBTree* broadphase, bool upload_ground)
+{
+    m_seed = seed;
+    m_upload_ground = upload_ground;
+    m_origin_tile = 0;
+    m_entities = entities;
+    m_asteroid_prototype = asteroid_prototype;
+    m_broadphase = broadphase;
+    m_stopping = false;
+
+    // Grow every tile's ground to full size now, so no slot allocates the first time it comes into use
+    for (Tile& tile : m_tiles) tile.terrain.generate(m_seed, 0.0f, TILE_SEGMENTS, TILE_SPACING);
+
+    m_worker = std::thread(&WorldStreamer::worker_loop, this);
+}
+
+void WorldStreamer::stop()
+{
+    if (!m_worker.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+    m_worker.join();
+
+    for (Tile& tile : m_tiles)
+    {
+        if (tile.state == TILE_ACTIVE) recycle_tile(tile);
+        tile.state = TILE_FREE;
+        tile.terrain.release();
+    }
+    m_request_count = m_completed_count = 0;
+}
+
+void WorldStreamer::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_work_available.wait(lock, [this] { return m_stopping || m_request_count > 0; });
+        if (m_stopping) return;
+
+        Tile* tile = m_requests[m_request_head];
+        m_request_head = (m_request_head + 1) % TILE_POOL_SIZE;
+        m_request_count--;
+
+        // The tile is ours until it goes on the completed ring, so no lock needed
+        lock.unlock();
+        generate_tile(*tile);
+        lock.lock();
+
+        m_completed[(m_completed_head + m_completed_count) % TILE_POOL_SIZE] = tile;
+        m_completed_count++;
+        m_work_done.notify_all();
+    }
+}
+
+void WorldStreamer::generate_tile(Tile& tile)
+{
+    // Never more than a few tiles from the origin, so the local x is small
+    double offset_x = (double)tile.origin_tile * TILE_WIDTH;
+    float origin_x = (float)(tile.index - tile.origin_tile) * TILE_WIDTH;
+    tile.terrain.generate(m_seed, origin_x, TILE_SEGMENTS, TILE_SPACING, offset_x);
+
+    // Same tile, same asteroids, whenever it gets streamed back in
+    std::minstd_rand random(m_seed ^ (uint32_t)(tile.index * 2654435761ll));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    tile.spawn_count = 0;
+    int wanted = (int)(unit(random) * (MAX_TILE_ASTEROIDS + 1));
+    for (int i = 0; i < wanted && i < MAX_TILE_ASTEROIDS; i++)
+    {
+        float x = origin_x + (0.05f + 0.9f * unit(random)) * TILE_WIDTH;
+        if (fabs(offset_x + x) < TILE_CLEAR_HALF_WIDTH) continue;
+
+        float size = 0.6f + 0.6f * unit(random);
+        float ground = tile.terrain.max_height(x - size, x + size);
+
+        tile.spawns[tile.spawn_count++] = { glm::vec2(x, ground + size + 0.5f + 2.0f * unit(random)), size };
+    }
+}
+
+void WorldStreamer::activate_tile(Tile& tile)
+{
+    // The origin may have moved while the worker had it
+    if (tile.origin_tile != m_origin_tile) move_tile_to_origin(tile);
+    if (m_upload_ground) tile.terrain.upload();
+
+    // Copying the prototype comes out of the pool, so tiles coming and going never touch the heap
+    const Entity* prototype = m_entities->get(m_asteroid_prototype);
+    for (int i = 0; prototype != nullptr && i < tile.spawn_count; i++)
+    {
+        tile.asteroids[i] = m_entities->create(*prototype);
+
+        Entity* asteroid = m_entities->get(tile.asteroids[i]);
+        if (asteroid == nullptr) continue;
+
+        asteroid->set_position(glm::vec3(tile.spawns[i].position, 0.0f));
+        asteroid->set_scale(glm::vec3(tile.spawns[i].size, tile.spawns[i].size, 1.0f));
+        asteroid->set_movement(glm::vec3(0.0f));
+        asteroid->update(0.0f); // just to build the model matrix, streamed asteroids don't move
+
+        asteroid->set_broadphase_proxy(m_broadphase->create_proxy(asteroid->get_bounds(), asteroid));
+    }
+
+    tile.state = TILE_ACTIVE;
+}
+
+void WorldStreamer::recycle_tile(Tile& tile)
+{
+    for (int i = 0; i < tile.spawn_count; i++)
+    {
+        Entity* asteroid = m_entities->get(tile.asteroids[i]);
+        if (asteroid == nullptr) continue;
+
+        m_broadphase->destroy_proxy(asteroid->get_broadphase_proxy());
+        m_entities->destroy(tile.asteroids[i]);
+        tile.asteroids[i] = PoolHandle();
+    }
+
+    tile.state = TILE_FREE;
+}
+
+void WorldStreamer::move_tile_to_origin(Tile& tile)
+{
+    float shift = (float)(m_origin_tile - tile.origin_tile) * TILE_WIDTH;
+    tile.origin_tile = m_origin_tile;
+
+    tile.terrain.set_offset(get_origin_x());
+    for (int i = 0; i < tile.spawn_count; i++) tile.spawns[i].position.x -= shift;
+}
+
+float WorldStreamer::rebase(float focus_x)
+{
+    int64_t tiles = (int64_t)floorf(focus_x / TILE_WIDTH);
+    float shift = (float)tiles * TILE_WIDTH;
+    if (tiles == 0) return 0.0f;
+    m_origin_tile += tiles;
+
+    // Pending tiles catch up when they're activated
+    for (Tile& tile : m_tiles)
+    {
+        if (tile.state != TILE_ACTIVE) continue;
+        move_tile_to_origin(tile);
+        if (m_upload_ground) tile.terrain.upload();
+
+        for (int i = 0; i < tile.spawn_count; i++)
+        {
+            Entity* asteroid = m_entities->get(tile.asteroids[i]);
+            if (asteroid == nullptr) continue;
+
+            asteroid->set_position(asteroid->get_position() - glm::vec3(shift, 0.0f, 0.0f));
+            asteroid->update(0.0f);
+        }
+    }
+    return shift;
+}
+
+WorldStreamer::Tile* WorldStreamer::find_tile(int64_t index)
+{
+    for (Tile& tile : m_tiles)
+    {
+        if (tile.state != TILE_FREE && tile.index == index) return &tile;
+    }
+    return nullptr;
+}
+
+int WorldStreamer::stream(float focus_x, int activation_limit)
+{
+    int64_t centre = tile_index_for(focus_x);
+
+    // Give back whatever has drifted out past the keep radius
+    for (Tile& tile : m_tiles)
+    {
+        if (tile.state != TILE_ACTIVE) continue;
+
+        int64_t distance = tile.index > centre ? tile.index - centre : centre - tile.index;
+        if (distance > TILE_PREFETCH_RADIUS + 1) recycle_tile(tile);
+    }
+
+    // Ask for anything inside the prefetch radius we don't have yet
+    int requested = 0;
+    for (int64_t index = centre - TILE_PREFETCH_RADIUS; index <= centre + TILE_PREFETCH_RADIUS; index++)
+    {
+        if (find_tile(index) != nullptr) continue;
+
+        Tile* free_tile = nullptr;
+        for (Tile& tile : m_tiles)
+        {
+            if (tile.state == TILE_FREE)
+            {
+                free_tile = &tile;
+                break;
+            }
+        }
+        if (free_tile == nullptr) break;
+
+        free_tile->state = TILE_PENDING;
+        free_tile->index = index;
+        free_tile->origin_tile = m_origin_tile;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests[(m_request_head + m_request_count) % TILE_POOL_SIZE] = free_tile;
+        m_request_count++;
+        requested++;
+    }
+    if (requested > 0) m_work_available.notify_one();
+
+    // Take a bounded number of finished tiles off the worker
+    Tile* ready[TILE_POOL_SIZE];
+    int ready_count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (m_completed_count > 0 && ready_count < activation_limit)
+        {
+            ready[ready_count++] = m_completed[m_completed_head];
+            m_completed_head = (m_completed_head + 1) % TILE_POOL_SIZE;
+            m_completed_count--;
+        }
+    }
+
+    for (int i = 0; i < ready_count; i++) activate_tile(*ready[i]);
+
+    return requested;
+}
+
+void WorldStreamer::prime(float focus_x)
+{
+    int requested = stream(focus_x, 0);
+
+    // Wait for the worker to get through everything we just asked for
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_work_done.wait(lock, [&] { return m_completed_count >= requested; });
+    }
+
+    stream(focus_x, TILE_POOL_SIZE);
+}
+
+bool WorldStreamer::check_ground_contact(Entity* ship, ContactManifold& manifold)
+{
+    AABB bounds = ship->get_bounds();
+
+    for (Tile& tile : m_tiles)
+    {
+        if (tile.state != TILE_ACTIVE) continue;
+        if (bounds.max.x < tile.terrain.get_origin_x() || bounds.min.x > tile.terrain.get_end_x()) continue;
+
+        if (ship->check_contact(tile.terrain, manifold)) return true;
+    }
+    return false;
+}
+
+bool WorldStreamer::is_landing_pad(float min_x, float max_x)
+{
+    Tile* tile = find_tile(tile_index_for(min_x));
+    return tile != nullptr && tile->state == TILE_ACTIVE && tile->terrain.is_landing_pad(min_x, max_x);
+}
+
+float WorldStreamer::nearest_landing_pad(float x)
+{
+    return (float)(::nearest_landing_pad(m_seed, get_origin_x() + x) - get_origin_x());
+}
+
+void WorldStreamer::sample_ground(float origin_x, float spacing, float* heights, int count)
+{
+    Tile* tile = nullptr;
+    for (int i = 0; i < count; i++)
+    {
+        float x = origin_x + i * spacing;
+
+        // Samples walk left to right, so the tile only changes at boundaries
+        if (tile == nullptr || x > tile->terrain.get_end_x())
+        {
+            tile = find_tile(tile_index_for(x));
+            if (tile != nullptr && tile->state != TILE_ACTIVE) tile = nullptr;
+        }
+
+        if (tile != nullptr)
+        {
+            heights[i] = tile->terrain.height_at(x);
+            continue;
+        }
+
+        heights[i] = terrain_height(m_seed, get_origin_x() + x);
+    }
+}
+
+void WorldStreamer::render(ShaderProgram* terrain_program, float focus_x, float view_min_x, float view_max_x)
+{
+    for (Tile& tile : m_tiles)
+    {
+        if (tile.state != TILE_ACTIVE) continue;
+        if (tile.terrain.get_end_x() < view_min_x || tile.terrain.get_origin_x() > view_max_x) continue;
+
+        tile.terrain.render(terrain_program, focus_x, view_min_x, view_max_x);
+    }
+}
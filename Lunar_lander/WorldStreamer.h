@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "glm/vec2.hpp"
+#include "Terrain.h"
+#include "ObjectPool.h"
+
+class Entity;
+class AABBTree;
+struct ContactManifold;
+
+// The world is cut into tiles along x, each one a Terrain span plus its asteroids
+constexpr int TILE_SEGMENTS = 4 * TERRAIN_BLOCK_SEGMENTS;
+constexpr float TILE_SPACING = 0.05f;
+constexpr float TILE_WIDTH = TILE_SEGMENTS * TILE_SPACING;
+
+// Tiles this many either side of the focus tile get generated ahead of time,
+// and are only recycled once they're one further out than that
+constexpr int TILE_PREFETCH_RADIUS = 2;
+constexpr int TILE_POOL_SIZE = 2 * (TILE_PREFETCH_RADIUS + 1) + 1;
+
+// Finished tiles handed over per frame, so crossing a boundary never costs more than this
+constexpr int MAX_TILE_ACTIVATIONS_PER_FRAME = 1;
+
+constexpr int MAX_TILE_ASTEROIDS = 4;
+constexpr float TILE_CLEAR_HALF_WIDTH = 6.0f; // the starting screen has its own hand-placed asteroids
+
+// Past this far from the origin it gets moved under the ship, while a float step is still far finer than TILE_SPACING
+constexpr float WORLD_REBASE_DISTANCE = 64 * TILE_WIDTH;
+
+/**
+ * Keeps the tiles around a focus point loaded. Tiles entering the prefetch radius
+ * are generated on a background thread, then handed back to the main thread which
+ * uploads the ground and drops the asteroids into the broadphase. Tiles leaving it
+ * go back into a fixed pool, so memory stays flat however far the ship flies.
+ *
+ * Every x here is local, measured from an origin that sits a whole number of
+ * tiles into the world. rebase() moves that origin, so floats never have to
+ * hold a big x.
+ */
+class WorldStreamer
+{
+private:
+    // Only the main thread touches these. A pending tile stays pending through the
+    // worker and the completed ring, and goes straight to active when it comes off it.
+    enum TileState { TILE_FREE, TILE_PENDING, TILE_ACTIVE };
+
+    struct AsteroidSpawn
+    {
+        glm::vec2 position;
+        float size;
+    };
+
+    struct Tile
+    {
+        TileState state = TILE_FREE;
+        int64_t index = 0;
+        int64_t origin_tile = 0;    // the origin it was generated against, caught up on activation
+
+        Terrain terrain;
+        AsteroidSpawn spawns[MAX_TILE_ASTEROIDS];
+        int spawn_count = 0;
+
+        PoolHandle asteroids[MAX_TILE_ASTEROIDS];   // only while the tile is active
+    };
+
+    unsigned int m_seed = 0;
+    bool m_upload_ground = true;
+    int64_t m_origin_tile = 0;  // world tile local 0 sits at
+    AABBTree* m_broadphase = nullptr;
+    ObjectPool<Entity>* m_entities = nullptr;
+    PoolHandle m_asteroid_prototype;
+    Tile m_tiles[TILE_POOL_SIZE];
+
+    // Pending -> worker and worker -> main hand-offs, both fixed rings guarded by m_mutex
+    Tile* m_requests[TILE_POOL_SIZE];
+    Tile* m_completed[TILE_POOL_SIZE];
+    int m_request_head = 0, m_request_count = 0;
+    int m_completed_head = 0, m_completed_count = 0;
+
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_work_done;
+    bool m_stopping = false;
+
+    void worker_loop();
+    void generate_tile(Tile& tile);
+    void activate_tile(Tile& tile);
+    void recycle_tile(Tile& tile);
+    void move_tile_to_origin(Tile& tile);
+    Tile* find_tile(int64_t index);
+    int stream(float focus_x, int activation_limit); // returns how many tiles it asked for
+
+public:
+    ~WorldStreamer();
+
+    // Asteroids are copied out of the prototype into `entities` as tiles come in, and destroyed as they go.
+    // A null prototype streams the ground alone. Without upload_ground the tiles never touch GL,
+    // so it runs with no context, and render() draws nothing.
+    void start(unsigned int seed, ObjectPool<Entity>* entities, PoolHandle asteroid_prototype, AABBTree* broadphase, bool upload_ground = true);
+
+    // Joins the worker and frees every tile, GPU side and asteroids included, so call it before the context goes
+    void stop();
+
+    // Blocks until every tile around focus_x is in. For loading, not for frames.
+    void prime(float focus_x);
+
+    // Once per frame on the main thread
+    void update(float focus_x) { stream(focus_x, MAX_TILE_ACTIVATIONS_PER_FRAME); }
+
+    // Moves the origin to the start of focus_x's tile, taking the loaded ground and the streamed
+    // asteroids with it. Returns how far local x moved back, for the caller to move everything
+    // else by, the broadphase included.
+    float rebase(float focus_x);
+
+    bool check_ground_contact(Entity* ship, ContactManifold& manifold);
+    bool is_landing_pad(float min_x, float max_x);
+    float nearest_landing_pad(float x);
+
+    // Fills `count` heights from `origin_x` on, `spacing` apart. Anywhere not loaded
+    // comes straight from the noise, since the terrain is a pure function of x.
+    void sample_ground(float origin_x, float spacing, float* heights, int count);
+
+    // Ground only; the streamed asteroids live in the broadphase and get drawn from there
+    void render(ShaderProgram* terrain_program, float focus_x, float view_min_x, float view_max_x);
+
+    int64_t tile_index_for(float x) const { return m_origin_tile + (int64_t)floorf(x / TILE_WIDTH); }
+    double const get_origin_x() const { return (double)m_origin_tile * TILE_WIDTH; }
+};
@@ -6,57 +6,49 @@
 #endif
 
 #define GL_GLEXT_PROTOTYPES 1
+#include <cstring>
 #include <SDL.h>
 #include <SDL_opengl.h>
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
 #include "Entity.h"
+#include "CollisionMask.h"
+#include "ConvexHull.h"
+#include "AABBTree.h"
+#include "Terrain.h"
+#include "FrameArena.h"
+#include "RenderQueue.h"
 
 constexpr int FONTBANK_SIZE = 16;
 
 Entity::Entity()
     : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
-    m_speed(0.0f), m_animation_cols(0), m_animation_frames(0), m_animation_index(0),
-    m_animation_rows(0), m_animation_indices(nullptr), m_animation_time(0.0f),
-    m_current_animation(MOVE_STRAIGHT)
+    m_speed(0.0f)
 {
 }
 
-Entity::Entity(std::vector<GLuint> texture_ids, float speed,
-    std::vector<std::vector<int>> animations, float animation_time,
-    int animation_frames, int animation_index, int animation_cols,
-    int animation_rows, Animation animation)
+Entity::Entity(AnimationSystem* animations, int clip, float speed)
     : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
-    m_speed(speed), m_texture_ids(texture_ids), m_animations(animations),
-    m_animation_cols(animation_cols), m_animation_frames(animation_frames),
-    m_animation_index(animation_index), m_animation_rows(animation_rows),
-    m_animation_time(animation_time), m_current_animation(animation)
+    m_speed(speed), m_animator(animations, clip)
 {
-    set_animation_state(m_current_animation);
 }
 
 Entity::~Entity() {}
 
-void Entity::set_animation_state(Animation new_animation)
+glm::vec3 Entity::get_half_extents() const
 {
-    m_current_animation = new_animation;
-    m_animation_indices = m_animations[m_current_animation].data();
-
-    switch (new_animation)
-    {
-   
-    case MOVE_STRAIGHT:
-        m_animation_frames = 1;
-        m_animation_rows = 1;
-        m_scale = glm::vec3(2.0f, 2.0f, 0.0f);
-        break;
-    default:
-        m_animation_frames = 1;
-        m_animation_rows = 1;
-        m_scale = glm::vec3(2.0f, 2.0f, 0.0f);
-        break;
-    }
+    // Box around the rotated quad, which is just m_scale / 2 while we're upright
+    float c = fabsf(cosf(m_rotation));
+    float s = fabsf(sinf(m_rotation));
+
+    return glm::vec3(c * m_scale.x + s * m_scale.y, s * m_scale.x + c * m_scale.y, 0.0f) / 2.0f;
+}
+
+AABB Entity::get_bounds() const
+{
+    glm::vec2 half = glm::vec2(get_half_extents());
+    return { glm::vec2(m_position) - half, glm::vec2(m_position) + half };
 }
 
 bool Entity::check_collision(Entity* other)
@@ -64,55 +56,81 @@ bool Entity::check_collision(Entity* other)
     glm::vec3 posA = this->m_position;
     glm::vec3 posB = other->m_position;
 
-    float ax = this->m_scale.x / 2.0f;
-    float ay = this->m_scale.y / 2.0f;
-    float bx = other->m_scale.x / 2.0f;
-    float by = other->m_scale.y / 2.0f;
+    glm::vec3 half_a = this->get_half_extents();
+    glm::vec3 half_b = other->get_half_extents();
 
-    return (fabs(posA.x - posB.x) < (ax + bx)) && (fabs(posA.y - posB.y) < (ay + by));
+    // Broadphase: cheap box test on the full m_scale extents
+    if (fabs(posA.x - posB.x) >= (half_a.x + half_b.x) || fabs(posA.y - posB.y) >= (half_a.y + half_b.y)) return false;
+
+    // Narrowphase: only boxes that overlap pay for the per-pixel test.
+    // The masks are axis-aligned, so rotated sprites are left to the hulls.
+    if (m_collision_mask == nullptr || other->m_collision_mask == nullptr) return true;
+    if (m_rotation != 0.0f || other->m_rotation != 0.0f) return true;
+
+    return masks_overlap(*m_collision_mask, posA, m_scale, *other->m_collision_mask, posB, other->m_scale);
 }
 
+bool Entity::check_contact(Entity* other, ContactManifold& manifold)
+{
+    if (!check_collision(other)) return false;
+
+    static const ConvexHull UNIT_BOX = ConvexHull::unit_box();
 
-void Entity::draw_sprite_from_texture_atlas(ShaderProgram* program)
+    const ConvexHull& hull_a = m_hull != nullptr ? *m_hull : UNIT_BOX;
+    const ConvexHull& hull_b = other->m_hull != nullptr ? *other->m_hull : UNIT_BOX;
+
+    HullTransform transform_a = { glm::vec2(m_position), glm::vec2(m_scale), m_rotation };
+    HullTransform transform_b = { glm::vec2(other->m_position), glm::vec2(other->m_scale), other->m_rotation };
+
+    if (!collide_hulls(hull_a, transform_a, hull_b, transform_b, manifold)) return false;
+
+    // Position changes by m_movement * m_speed each second, so that's our velocity
+    manifold.relative_velocity = glm::vec2(m_movement * m_speed - other->m_movement * other->m_speed);
+    return true;
+}
+
+bool Entity::check_contact(const Terrain& terrain, ContactManifold& manifold)
 {
-    GLuint current_texture = m_texture_ids[m_current_animation];
+    static const ConvexHull UNIT_BOX = ConvexHull::unit_box();
+    const ConvexHull& hull = m_hull != nullptr ? *m_hull : UNIT_BOX;
 
-    // Ensure m_animation_cols and m_animation_rows are not zero
-    if (m_animation_cols == 0 || m_animation_rows == 0) {
-        std::cerr << "Error: Animation columns or rows are zero." << std::endl;
-        return;
-    }
+    glm::vec2 outline[MAX_HULL_VERTICES];
+    hull.to_world({ glm::vec2(m_position), glm::vec2(m_scale), m_rotation }, outline);
 
-    float u_coord = (float)(m_animation_index % m_animation_cols) / (float)m_animation_cols;
-    float v_coord = (float)(m_animation_index / m_animation_cols) / (float)m_animation_rows;
+    if (!terrain.collide(outline, hull.vertex_count, manifold)) return false;
+
+    // The ground doesn't move
+    manifold.relative_velocity = glm::vec2(m_movement * m_speed);
+    return true;
+}
 
-    float width = 1.0f / (float)m_animation_cols;
-    float height = 1.0f / (float)m_animation_rows;
+void Entity::resolve_contact(const ContactManifold& manifold)
+{
+    glm::vec3 normal(manifold.normal, 0.0f);
 
-    float tex_coords[] =
-    {
-        u_coord, v_coord + height, u_coord + width, v_coord + height, u_coord + width,
-        v_coord, u_coord, v_coord + height, u_coord + width, v_coord, u_coord, v_coord
-    };
+    // Push back out of the surface...
+    m_position += normal * manifold.penetration;
 
-    float vertices[] =
-    {
-        -0.5, -0.5, 0.5, -0.5,  0.5, 0.5,
-        -0.5, -0.5, 0.5,  0.5, -0.5, 0.5
-    };
+    // ...and drop whatever part of the movement still heads into it
+    float into_surface = glm::dot(m_movement, normal);
+    if (into_surface < 0.0f) m_movement -= normal * into_surface;
+}
 
-    glBindTexture(GL_TEXTURE_2D, current_texture);
 
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->get_position_attribute());
+void Entity::draw_sprite_from_texture_atlas(RenderQueue& queue, ShaderProgram* program)
+{
+    // Which cell to show was worked out in the AnimationSystem's update pass
+    const AnimationSystem* animations = m_animator.get_system();
+    const SpriteSheet& sheet = animations->get_player_sheet(m_animator.get_player());
+    int cell = animations->get_player(m_animator.get_player()).cell;
 
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
+    float u_coord = (float)(cell % sheet.cols) / (float)sheet.cols;
+    float v_coord = (float)(cell / sheet.cols) / (float)sheet.rows;
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    float width = 1.0f / (float)sheet.cols;
+    float height = 1.0f / (float)sheet.rows;
 
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    queue.draw_sprite(LAYER_WORLD, program, sheet.texture, m_model_matrix, glm::vec4(u_coord, v_coord, u_coord + width, v_coord + height));
 }
 
 void Entity::update(float delta_time)
@@ -127,99 +145,50 @@ void Entity::update(float delta_time)
     m_position += m_movement * m_speed * delta_time;
 
     // Slowly reduce acceleration (simulate drag/friction)
-    m_acceleration *= 0.98f;
+    m_acceleration *= m_acceleration_decay;
 
     // Update model matrix
     m_model_matrix = glm::mat4(1.0f);
     m_model_matrix = glm::translate(m_model_matrix, m_position);
+    m_model_matrix = glm::rotate(m_model_matrix, m_rotation, glm::vec3(0.0f, 0.0f, 1.0f));
     m_model_matrix = glm::scale(m_model_matrix, m_scale);
 }
-void Entity::render(ShaderProgram* program)
+void Entity::render(RenderQueue& queue, ShaderProgram* program)
 {
-    program->set_model_matrix(m_model_matrix);
-
-    if (m_animation_indices != nullptr) draw_sprite_from_texture_atlas(program);
+    if (m_animator.is_valid()) draw_sprite_from_texture_atlas(queue, program);
 }
 
 
-
-
-void Entity::move_straight()
-{
-    if (m_current_animation != MOVE_STRAIGHT)
-    {
-        set_animation_state(MOVE_STRAIGHT);
-    }
-}
-
-
-void Entity::draw_text(ShaderProgram* program, GLuint font_texture_id, std::string text, float font_size, float spacing, glm::vec3 position) {
+void Entity::draw_text(RenderQueue& queue, ShaderProgram* program, GLuint font_texture_id, const char* text, float font_size, float spacing, glm::vec3 position) {
     // Scale the size of the fontbank in the UV-plane
     // We will use this for spacing and positioning
     float width = 1.0f / FONTBANK_SIZE;
     float height = 1.0f / FONTBANK_SIZE;
 
-    // Instead of having a single pair of arrays, we'll have a series of pairsone for
-    // each character. Don't forget to include <vector>!
-    std::vector<float> vertices;
-    std::vector<float> texture_coordinates;
-
-    // For every character...
-    for (int i = 0; i < text.size(); i++) {
+    // One quad per character, and the queue draws them all in one go
+    int length = (int)strlen(text);
+    for (int i = 0; i < length; i++) {
         // 1. Get their index in the spritesheet, as well as their offset (i.e. their
         //    position relative to the whole sentence)
         int spritesheet_index = (int)text[i];  // ascii value of character
-        float offset = (font_size + spacing) * i;
+        float offset = position.x + (font_size + spacing) * i;
 
         // 2. Using the spritesheet index, we can calculate our U- and V-coordinates
         float u_coordinate = (float)(spritesheet_index % FONTBANK_SIZE) / FONTBANK_SIZE;
         float v_coordinate = (float)(spritesheet_index / FONTBANK_SIZE) / FONTBANK_SIZE;
 
-        // 3. Inset the current pair in both vectors
-        vertices.insert(vertices.end(), {
-            offset + (-0.5f * font_size), 0.5f * font_size,
-            offset + (-0.5f * font_size), -0.5f * font_size,
-            offset + (0.5f * font_size), 0.5f * font_size,
-            offset + (0.5f * font_size), -0.5f * font_size,
-            offset + (0.5f * font_size), 0.5f * font_size,
-            offset + (-0.5f * font_size), -0.5f * font_size,
-            });
-
-        texture_coordinates.insert(texture_coordinates.end(), {
-            u_coordinate, v_coordinate,
-            u_coordinate, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate + width, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate, v_coordinate + height,
-            });
+        // 3. And hand it over
+        queue.draw_rect(LAYER_HUD, program, font_texture_id,
+            offset - 0.5f * font_size, position.y - 0.5f * font_size,
+            offset + 0.5f * font_size, position.y + 0.5f * font_size,
+            glm::vec4(u_coordinate, v_coordinate, u_coordinate + width, v_coordinate + height));
     }
-
-    // 4. And render all of them using the pairs
-    glm::mat4 model_matrix = glm::mat4(1.0f);
-    model_matrix = glm::translate(model_matrix, position);
-
-    program->set_model_matrix(model_matrix);
-    glUseProgram(program->get_program_id());
-
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0,
-        vertices.data());
-    glEnableVertexAttribArray(program->get_position_attribute());
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0,
-        texture_coordinates.data());
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
-
-    glBindTexture(GL_TEXTURE_2D, font_texture_id);
-    glDrawArrays(GL_TRIANGLES, 0, (int)(text.size() * 6));
-
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
 }
 
-void Entity::display_fuel(ShaderProgram* program, GLuint font_texture_id, float font_size, float spacing) {
-    std::string fuel_text = "Fuel: " + std::to_string((int)m_fuel);
+void Entity::display_fuel(RenderQueue& queue, ShaderProgram* program, FrameArena& arena, GLuint font_texture_id, float font_size, float spacing) {
+    const char* fuel_text = arena.format("Fuel: %d", (int)m_fuel);
 
     glm::vec3 top_left(-4.5f, 3.4f, 0.0f);
 
-    draw_text(program, font_texture_id, fuel_text, font_size, spacing, top_left);
+    draw_text(queue, program, font_texture_id, fuel_text, font_size, spacing, top_left);
 }
\ No newline at end of file
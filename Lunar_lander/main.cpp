@@ -24,6 +24,34 @@
 #include "ShaderProgram.h"
 #include "stb_image.h"
 #include "Entity.h"
+#include "CollisionMask.h"
+#include "ConvexHull.h"
+#include "AABBTree.h"
+#include "Terrain.h"
+#include "WorldStreamer.h"
+#include "Camera.h"
+#include "ParticleSystem.h"
+#include "AnimationSystem.h"
+#include "ObjectPool.h"
+#include "FrameArena.h"
+#include "ThreadPool.h"
+#include "Autopilot.h"
+#include "Config.h"
+#include "FileWatcher.h"
+#include "FrameUniforms.h"
+#include "SpriteBatch.h"
+#include "GeometryCache.h"
+#include "RenderBackend.h"
+#include "StreamBuffer.h"
+#include "RenderQueue.h"
+#include "SdfFont.h"
+#include "TextMesh.h"
+#include "TelemetryHud.h"
+#include "InputLayer.h"
+#include "FramePacer.h"
+#include "Lockstep.h"
+#include <algorithm>
+#include <cstring>
 #include <ctime>
 #include "cmath"
 
@@ -31,24 +59,93 @@
 constexpr int WINDOW_WIDTH = 640,
 WINDOW_HEIGHT = 480;
 
+// What config.ini can ask the window to be
+constexpr int MIN_WINDOW_SIZE = 64,
+MAX_WINDOW_SIZE = 8192;
+
 constexpr float BG_RED = 0.1765625f,
 BG_GREEN = 0.17265625f,
 BG_BLUE = 0.1609375f,
 BG_OPACITY = 1.0f;
 
 constexpr int VIEWPORT_X = 0,
-VIEWPORT_Y = 0,
-VIEWPORT_WIDTH = WINDOW_WIDTH,
-VIEWPORT_HEIGHT = WINDOW_HEIGHT;
+VIEWPORT_Y = 0;
 
 constexpr char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
-F_SHADER_PATH[] = "shaders/fragment_textured.glsl";
+F_SHADER_PATH[] = "shaders/fragment_textured.glsl",
+V_UNTEXTURED_SHADER_PATH[] = "shaders/vertex.glsl",
+F_UNTEXTURED_SHADER_PATH[] = "shaders/fragment.glsl",
+V_PARTICLE_SHADER_PATH[] = "shaders/vertex_particle.glsl",
+F_PARTICLE_SHADER_PATH[] = "shaders/fragment_particle.glsl",
+V_SCREEN_SHADER_PATH[] = "shaders/vertex_screen.glsl",
+F_SDF_SHADER_PATH[] = "shaders/fragment_sdf.glsl";
+
+constexpr char ANIMATIONS_PATH[] = "assets/animations.txt";
+
+// Baked by FontBaker from font1.png; the bitmap is still used if this isn't there
+constexpr char HUD_FONT_PATH[] = "assets/font_sdf.txt";
+constexpr float HUD_FONT_SIZE = 0.5f,      // line height, screen units
+HUD_FONT_SPACING = 0.02f;
+
+// Flight readouts down the right-hand side, T to hide them
+constexpr float TELEMETRY_FONT_SIZE = 0.3f;
+constexpr float TELEMETRY_X = 2.5f,
+TELEMETRY_Y = 3.65f;
+constexpr float TELEMETRY_SMOOTHING = 0.1f;   // of the way to the new reading, each frame
+
+// Everything tunable without a rebuild; saving it applies it to the running game
+constexpr char CONFIG_PATH[] = "config.ini";
 
 constexpr float MILLISECONDS_IN_SECOND = 1000.0;
 
+// The ship, asteroids and collisions move in steps this long, whatever the frame rate
+constexpr double SIMULATION_STEP = 1.0 / 60.0;
+constexpr int MAX_STEPS_PER_FRAME = 8;   // any further behind than this and the time is dropped
+
+// Half the size of the visible area in world units, at zoom 1
+constexpr float VIEW_HALF_WIDTH = 5.0f,
+VIEW_HALF_HEIGHT = 3.75f;
+
+// Sprites are culled against the view grown by this much, so big ones don't pop at the edges
+constexpr float CULL_MARGIN = 1.0f;
+
 constexpr glm::vec3 PLANE_IDLE_SCALE = glm::vec3(1.0f, 1.0f, 0.0f);
 constexpr glm::vec3 PLANE_IDLE_LOCATION = glm::vec3(-1.0f, 0.0f, 0.0f);
 
+constexpr unsigned int TERRAIN_SEED = 1969;
+
+// Exhaust comes out of the opposite side to the thrust, on top of whatever the ship is doing
+constexpr float EXHAUST_PARTICLES_PER_SECOND = 400.0f,
+EXHAUST_SPEED = 2.5f,
+EXHAUST_SPREAD = 0.25f,
+EXHAUST_LIFETIME = 0.6f,
+EXHAUST_SIZE = 6.0f;
+
+constexpr int DEBRIS_PARTICLES = 800;
+constexpr float DEBRIS_SPEED = 2.0f,
+DEBRIS_LIFETIME = 1.5f,
+DEBRIS_SIZE = 4.0f;
+
+// The hand-placed asteroids, scattered over this rectangle
+constexpr int ASTEROID_COUNT = 5,
+MAX_ASTEROIDS = 256;
+constexpr float ASTEROID_MIN_X = -4.0f,
+ASTEROID_MAX_X = 4.0f,
+ASTEROID_MIN_Y = -2.5f,
+ASTEROID_MAX_Y = 1.5f;
+
+// Room for the hand-placed asteroids plus everything every loaded tile can spawn
+constexpr int MAX_ENTITIES = 1024;
+
+// Loading, the first tiles and the first few pool slots all allocate, so don't
+// start complaining about heap use until things have settled
+constexpr int ALLOCATION_WARMUP_FRAMES = 120;
+
+// The autopilot looks this far either side of the ship for ground
+constexpr float AUTOPILOT_PROFILE_BEHIND = TERRAIN_PROFILE_SAMPLES * TERRAIN_PROFILE_SPACING * 0.5f;
+
+constexpr Uint32 RACE_JOIN_POLL_MS = 10;  // while the window waits for everyone to turn up
+
 constexpr GLint NUMBER_OF_TEXTURES = 1,
 LEVEL_OF_DETAIL = 0,
 TEXTURE_BORDER = 0;
@@ -57,9 +154,33 @@ TEXTURE_BORDER = 0;
 enum AppStatus { RUNNING, TERMINATED };
 enum FilterType { NEAREST, LINEAR };
 
+// What config.ini can change, starting from the constants above
+struct Settings {
+    int window_width = WINDOW_WIDTH;
+    int window_height = WINDOW_HEIGHT;
+    float view_half_width = VIEW_HALF_WIDTH;
+    float view_half_height = VIEW_HALF_HEIGHT;
+    int asteroid_count = ASTEROID_COUNT;
+    float asteroid_min_x = ASTEROID_MIN_X;
+    float asteroid_max_x = ASTEROID_MAX_X;
+    float asteroid_min_y = ASTEROID_MIN_Y;
+    float asteroid_max_y = ASTEROID_MAX_Y;
+    int core_profile = 1;   // 0 to always use the legacy renderer; startup only
+    int vsync = SWAP_ON;    // a SwapMode
+    int target_fps = 0;     // 0 for no limit
+    int just_in_time = 0;   // 1 to read input as late in the frame as it's safe to
+};
+
 struct GameState{
-    Entity * spaceship;
-    std::vector<Entity*> asteroids; // obstacles
+    AnimationSystem animations;     // first in so it outlives every entity playing from it
+    ObjectPool<Entity> entities;    // every entity lives in here
+    PoolHandle spaceship;
+    std::vector<PoolHandle> asteroids; // obstacles
+    std::vector<PoolHandle> racers; // everyone else's ship in a race, by player; ours and the crashed are null
+    PoolHandle asteroid_prototype;  // copied by the streamer, never drawn or collided with
+    AABBTree broadphase;            // every asteroid has a leaf in here
+    WorldStreamer world;            // ground and asteroids beyond the first screen, streamed in tiles
+    ParticleSystem particles;       // exhaust and debris
     bool game_over = false;         // collision/game over flag
     bool game_won = false;          // win flag
 };
@@ -72,9 +193,54 @@ SDL_Window* g_display_window;
 AppStatus g_app_status = RUNNING;
 
 ShaderProgram g_shader_program;
-glm::mat4 g_view_matrix, g_projection_matrix;
+ShaderProgram g_terrain_program;
+ShaderProgram g_particle_program;
+ShaderProgram g_screen_program;        // textured, but ignores the camera
+ShaderProgram g_text_program;          // distance field text, also in screen space
+FrameUniforms g_frame_uniforms;        // view, projection and time, shared by every program
+StreamBuffer g_stream_buffer;          // every vertex written per frame goes through here
+SpriteBatch g_sprite_batch;
+GeometryCache g_geometry_cache;        // the quads that never change
+RenderQueue g_render_queue;            // every draw of the frame, sorted by state before it happens
+Camera g_camera(VIEW_HALF_WIDTH, VIEW_HALF_HEIGHT);
 
 float g_previous_ticks = 0.0f;
+double g_simulation_time = 0.0;       // seconds on the SDL_GetTicks clock, up to where the steps have got
+float g_exhaust_accumulator = 0.0f;   // fractional particles carried over between frames
+
+FrameArena g_frame_arena;             // everything that only has to last the frame
+
+Settings g_settings;
+PhysicsParams g_physics;
+LevelParams g_level;
+Config g_config;
+FileWatcher g_config_watcher;
+ThreadPool g_thread_pool;
+Autopilot g_autopilot;
+TerrainProfile g_terrain_profile;
+bool g_autopilot_enabled = false;
+uint8_t g_autopilot_buttons = 0;      // this frame's plan, flown by every step in it
+
+InputLayer g_input;
+FramePacer g_frame_pacer;
+
+LockstepClient g_lockstep;            // only connected for a race
+bool g_racing = false;
+
+// Readouts that need more than one frame to work out, smoothed so they're readable
+struct TelemetryRates
+{
+    float fps = 0.0f;
+    float burn_rate = 0.0f;   // fuel a second
+};
+
+TelemetryHud g_telemetry_hud;
+TelemetryRates g_telemetry_rates;
+bool g_telemetry_enabled = true;
+#ifdef LUNAR_TRACK_ALLOCATIONS
+Uint64 g_telemetry_ticks = 0;   // performance counter ticks spent updating it, and over how many frames
+int g_telemetry_frames = 0;
+#endif
 
 
 GLuint g_background_texture;
@@ -82,15 +248,34 @@ GLuint g_game_over_texture;
 GLuint g_win_texture;
 GLuint g_font_texture_id;
 
-void initialise();
+SdfFont g_hud_font;
+TextMesh g_fuel_text;
+TextMesh g_autopilot_text;
+
+CollisionMask g_spaceship_mask;
+CollisionMask g_asteroid_mask;
+ConvexHull g_spaceship_hull;
+ConvexHull g_asteroid_hull;
+
+void initialise(const char* race_server, bool rollback);
+void bind_settings();
+void validate_settings(Settings& settings, const Settings& fallback);
+void validate_flight(PhysicsParams& physics, LevelParams& level, const PhysicsParams& fallback_physics, const LevelParams& fallback_level);
+void apply_settings(const Settings& previous);
+void spawn_asteroids();
+bool join_race(const char* address, bool rollback);
+void spawn_racers();
 void process_input();
 void update();
+void step_simulation(uint8_t buttons, float delta_time);
+void step_race(uint8_t buttons);
+void emit_debris(glm::vec2 position);
 void render();
 void shutdown();
 
 
 //  GENERAL FUNCTIONS  //
-GLuint load_texture(const char* filepath, FilterType filterType)
+GLuint load_texture(const char* filepath, FilterType filterType, CollisionMask* collision_mask = nullptr)
 {
     int width, height, number_of_components;
     unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components,
@@ -116,21 +301,33 @@ GLuint load_texture(const char* filepath, FilterType filterType)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
+    // Build the alpha mask while we still have the decoded pixels around
+    if (collision_mask != nullptr) collision_mask->build(image, width, height);
+
     stbi_image_free(image);
 
     return textureID;
 }
 
-void initialise()
+void initialise(const char* race_server, bool rollback)
 {
-    SDL_Init(SDL_INIT_VIDEO);
+    // Before the window, since the window size comes from here too
+    bind_settings();
+    g_config.load(CONFIG_PATH);
+    validate_settings(g_settings, Settings());
+    validate_flight(g_physics, g_level, PhysicsParams(), LevelParams());
+    g_config_watcher.watch(CONFIG_PATH);
+
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
     g_display_window = SDL_CreateWindow("Let's play Lunar-lander!",
         SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        WINDOW_WIDTH, WINDOW_HEIGHT,
+        g_settings.window_width, g_settings.window_height,
         SDL_WINDOW_OPENGL);
 
-    SDL_GLContext context = SDL_GL_CreateContext(g_display_window);
+    // Core if we can get it, the legacy one if not
+    SDL_GLContext context = create_render_context(g_display_window, g_settings.core_profile != 0);
     SDL_GL_MakeCurrent(g_display_window, context);
+    g_frame_pacer.init(g_settings.target_fps, (SwapMode)g_settings.vsync, g_settings.just_in_time != 0);
 
     if (g_display_window == nullptr)
     {
@@ -139,16 +336,45 @@ void initialise()
     }
 
 #ifdef _WINDOWS
+    // Without this GLEW skips everything a core context doesn't list the old way,
+    // and the GL_EXTENSIONS query it tries anyway leaves an error behind
+    glewExperimental = GL_TRUE;
     glewInit();
+    glGetError();
 #endif
+    std::cout << "Renderer: " << get_render_backend_name() << ", " << glGetString(GL_VERSION) << std::endl;
+
+    glViewport(VIEWPORT_X, VIEWPORT_Y, g_settings.window_width, g_settings.window_height);
+
+    // Nothing draws without these, so there's no point carrying on if one doesn't build
+    if (!g_shader_program.load(V_SHADER_PATH, F_SHADER_PATH)
+        || !g_terrain_program.load(V_UNTEXTURED_SHADER_PATH, F_UNTEXTURED_SHADER_PATH)
+        || !g_particle_program.load(V_PARTICLE_SHADER_PATH, F_PARTICLE_SHADER_PATH)
+        || !g_screen_program.load(V_SCREEN_SHADER_PATH, F_SHADER_PATH)
+        || !g_text_program.load(V_SCREEN_SHADER_PATH, F_SDF_SHADER_PATH))
+    {
+        std::cerr << "Error: shaders could not be built.\n";
+        g_app_status = TERMINATED;
+        return;
+    }
 
-    glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    // Only needs to know about the programs when there are no uniform blocks to share
+    g_frame_uniforms.init();
+    g_frame_uniforms.add_program(&g_shader_program);
+    g_frame_uniforms.add_program(&g_terrain_program);
+    g_frame_uniforms.add_program(&g_particle_program);
+    g_frame_uniforms.add_program(&g_screen_program);
+    g_frame_uniforms.add_program(&g_text_program);
 
-    g_shader_program.load(V_SHADER_PATH, F_SHADER_PATH);
-    g_view_matrix = glm::mat4(1.0f);
-    g_projection_matrix = glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f);
-    g_shader_program.set_projection_matrix(g_projection_matrix);
-    g_shader_program.set_view_matrix(g_view_matrix);
+    g_frame_uniforms.set_projection(glm::ortho(-g_settings.view_half_width, g_settings.view_half_width, -g_settings.view_half_height, g_settings.view_half_height, -1.0f, 1.0f));
+    g_camera.set_half_extents(g_settings.view_half_width, g_settings.view_half_height);
+
+    g_game_state.particles.init();
+    g_stream_buffer.init();
+    g_game_state.particles.upload(&g_stream_buffer);
+    g_sprite_batch.init(&g_stream_buffer);
+    g_geometry_cache.init(g_settings.view_half_width, g_settings.view_half_height);
+    g_render_queue.init(&g_sprite_batch, &g_geometry_cache);
 
     glUseProgram(g_shader_program.get_program_id());
 
@@ -156,81 +382,426 @@ void initialise()
 
     // Load textures
     g_background_texture = load_texture("assets/Lunar_bg.png", NEAREST);
-    GLuint asteroid_texture = load_texture("assets/asteroid.png", NEAREST);
     g_game_over_texture = load_texture("assets/over.png", NEAREST);
     g_win_texture = load_texture("assets/win.png", NEAREST);
     g_font_texture_id = load_texture("assets/font1.png", NEAREST);
 
+    // Linear, the shader finds the edge between texels
+    if (g_hud_font.load(HUD_FONT_PATH)) g_hud_font.set_texture(load_texture(g_hud_font.get_texture_path().c_str(), LINEAR));
+    g_fuel_text.init();
+    g_fuel_text.upload();
+    g_autopilot_text.init();
+    g_autopilot_text.upload();
+    if (g_hud_font.is_loaded()) g_telemetry_hud.init(g_hud_font, TELEMETRY_FONT_SIZE, glm::vec2(TELEMETRY_X, TELEMETRY_Y));
+
+    // Sprite sheets and their clips; the masks come from the sheet textures
+    AnimationSystem& animations = g_game_state.animations;
+    if (!animations.load(ANIMATIONS_PATH))
+    {
+        std::cerr << "Error: animations could not be loaded from " << ANIMATIONS_PATH << ".\n";
+        g_app_status = TERMINATED;
+        return;
+    }
+
+    int ship_sheet = animations.find_sheet("spaceship");
+    int asteroid_sheet = animations.find_sheet("asteroid");
+    if (ship_sheet >= 0) animations.set_sheet_texture(ship_sheet, load_texture(animations.get_sheet(ship_sheet).texture_path.c_str(), NEAREST, &g_spaceship_mask));
+    if (asteroid_sheet >= 0) animations.set_sheet_texture(asteroid_sheet, load_texture(animations.get_sheet(asteroid_sheet).texture_path.c_str(), NEAREST, &g_asteroid_mask));
 
+    int ship_idle = animations.find_clip("spaceship.idle");
+    int asteroid_idle = animations.find_clip("asteroid.idle");
+    if (ship_idle < 0 || asteroid_idle < 0)
+    {
+        std::cerr << "Error: " << ANIMATIONS_PATH << " is missing spaceship.idle or asteroid.idle.\n";
+        g_app_status = TERMINATED;
+        return;
+    }
+
+    g_asteroid_hull.build_from_mask(g_asteroid_mask);
+
+
+    g_game_state.entities.init(MAX_ENTITIES);
+    g_frame_arena.init();
+
+    // Before the ship, since a race brings its own physics and start
+    if (race_server != nullptr) g_racing = join_race(race_server, rollback);
 
     // Spaceship setup  
-    std::vector<GLuint> game_textures_ids = { load_texture("assets/spaceship.png", NEAREST) };
-    std::vector<std::vector<int>> ship_animations = { {0} };
-
-    g_game_state.spaceship = new Entity(
-        game_textures_ids,
-        3.0f,  // Non-zero speed
-        ship_animations,
-        0.0f,
-        1,
-        0,
-        1,
-        1,
-        MOVE_STRAIGHT
+    g_game_state.spaceship = g_game_state.entities.create(
+        &animations,
+        ship_idle,
+        g_physics.speed
     );
+    Entity* ship = g_game_state.entities.get(g_game_state.spaceship);
+
+    ship->set_scale(glm::vec3(0.5f, 0.5f, 1.0f));
+    ship->set_position(glm::vec3(0.0f, g_level.start_height, 0.0f));
+    ship->set_movement(glm::vec3(g_level.start_drift, 0.0f, 0.0f));
+    ship->set_fuel(g_level.start_fuel);
+    ship->set_gravity(g_physics.gravity);
+    ship->set_acceleration_decay(g_physics.acceleration_decay);
+    ship->set_collision_mask(&g_spaceship_mask);
+    g_spaceship_hull.build_from_mask(g_spaceship_mask);
+    ship->set_hull(&g_spaceship_hull);
+
+    spawn_asteroids();
+
+    // The race only knows about the ground, so a race is flown over the server's and nothing else
+    if (g_racing) {
+        spawn_racers();
+        g_game_state.world.start(g_lockstep.get_settings().seed, &g_game_state.entities, PoolHandle(), &g_game_state.broadphase);
+    }
+    else {
+        PoolHandle handle = g_game_state.entities.create(
+            &animations,
+            asteroid_idle,
+            2.0f
+        );
+        Entity* asteroid = g_game_state.entities.get(handle);
+
+        asteroid->set_position(glm::vec3(3, 0, 0.0f));
+        asteroid->set_scale(glm::vec3(1.0f, 1.0f, 1.0f));
+        asteroid->set_collision_mask(&g_asteroid_mask);
+        asteroid->set_hull(&g_asteroid_hull);
+        asteroid->set_broadphase_proxy(g_game_state.broadphase.create_proxy(asteroid->get_bounds(), asteroid));
+
+        g_game_state.asteroids.push_back(handle);
 
-    g_game_state.spaceship->set_scale(glm::vec3(0.5f, 0.5f, 1.0f));
-    g_game_state.spaceship->set_position(glm::vec3(0.0f, 2.0f, 0.0f));
-
-    // Create multiple asteroid obstacles
-    for (int i = 0; i < 5; i++) {
-        Entity* asteroid = new Entity(
-            { asteroid_texture },
-            0.0f, // Asteroids do not move
-            { {0} },
-            0.0f,
-            1,
-            0,
-            1,
-            1,
-            MOVE_STRAIGHT
+        // Template for the asteroids the streamer scatters over each tile
+        g_game_state.asteroid_prototype = g_game_state.entities.create(
+            &animations,
+            asteroid_idle,
+            0.0f
         );
+        Entity* asteroid_prototype = g_game_state.entities.get(g_game_state.asteroid_prototype);
+        asteroid_prototype->set_collision_mask(&g_asteroid_mask);
+        asteroid_prototype->set_hull(&g_asteroid_hull);
+
+        g_game_state.world.start(TERRAIN_SEED, &g_game_state.entities, g_game_state.asteroid_prototype, &g_game_state.broadphase);
+    }
+    g_game_state.world.prime(ship->get_position().x);
+
+    g_camera.follow(glm::vec2(ship->get_position()), glm::vec2(0.0f));
+    g_camera.snap();
+
+    g_thread_pool.start();
+    g_autopilot.init(&g_thread_pool, g_physics);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Loading took a while, and none of it should be caught up on
+    g_simulation_time = (double)SDL_GetTicks() / MILLISECONDS_IN_SECOND;
+}
+// Every setting, by the name it has in config.ini
+void bind_settings()
+{
+    g_config.bind("window.width", &g_settings.window_width);
+    g_config.bind("window.height", &g_settings.window_height);
+    g_config.bind("view.half_width", &g_settings.view_half_width);
+    g_config.bind("view.half_height", &g_settings.view_half_height);
+    g_config.bind("render.core_profile", &g_settings.core_profile);
+    g_config.bind("render.vsync", &g_settings.vsync);
+    g_config.bind("render.target_fps", &g_settings.target_fps);
+    g_config.bind("render.just_in_time", &g_settings.just_in_time);
+
+    g_config.bind("physics.gravity", &g_physics.gravity);
+    g_config.bind("physics.speed", &g_physics.speed);
+    g_config.bind("physics.acceleration_decay", &g_physics.acceleration_decay);
+    g_config.bind("physics.side_thrust", &g_physics.side_thrust);
+    g_config.bind("physics.up_thrust", &g_physics.up_thrust);
+    g_config.bind("physics.idle_vertical", &g_physics.idle_vertical);
+    g_config.bind("physics.fuel_burn", &g_physics.fuel_burn);
+
+    // Only read at startup, the ship has already started by the time a reload comes in
+    g_config.bind("level.start_fuel", &g_level.start_fuel);
+    g_config.bind("level.start_height", &g_level.start_height);
+    g_config.bind("level.start_drift", &g_level.start_drift);
+
+    g_config.bind("asteroids.count", &g_settings.asteroid_count);
+    g_config.bind("asteroids.min_x", &g_settings.asteroid_min_x);
+    g_config.bind("asteroids.max_x", &g_settings.asteroid_max_x);
+    g_config.bind("asteroids.min_y", &g_settings.asteroid_min_y);
+    g_config.bind("asteroids.max_y", &g_settings.asteroid_max_y);
+}
+
+// Blocks until the server has everyone and sends the start, keeping the window alive meanwhile
+bool join_race(const char* address, bool rollback)
+{
+    g_lockstep.set_rollback(rollback ? LOCKSTEP_ROLLBACK_STEPS : 0);
+    if (!g_lockstep.connect(address)) {
+        LOG("Couldn't reach a race server at " << address << ", flying alone");
+        return false;
+    }
+
+    LOG("Waiting for the race at " << address << "...");
+    while (!g_lockstep.is_started()) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                g_lockstep.close();
+                g_app_status = TERMINATED;
+                return false;
+            }
+        }
+
+        g_lockstep.poll();
+        SDL_Delay(RACE_JOIN_POLL_MS);
+    }
+
+    // Everyone flies the server's ship, whatever their own config.ini says
+    g_physics = g_lockstep.get_settings().physics;
+    g_level = g_lockstep.get_settings().level;
+    return true;
+}
+
+// Puts a ship where the race has it. Nothing moves a race ship but the race.
+void place_from_lander(Entity* ship, const LanderState& lander)
+{
+    ship->set_position(glm::vec3(lander.position, 0.0f));
+    ship->set_movement(glm::vec3(lander.movement, 0.0f));
+    ship->set_fuel(lander.fuel);
+    ship->update(0.0f);     // just the model matrix
+    ship->set_acceleration(glm::vec3(lander.acceleration, 0.0f));
+}
+
+void sync_race_ships()
+{
+    // Rolling back, everyone's shown where the guesses put them, and a ship's only
+    // blown up once the crash is confirmed, since a guessed one can be taken back
+    const RaceState& race = g_lockstep.get_race();
+    const RaceState& shown = g_lockstep.is_rolling_back() ? g_lockstep.get_predicted() : race;
+    for (uint32_t i = 0; i < race.player_count; i++) {
+        Entity* racer = g_game_state.entities.get(g_game_state.racers[i]);
+        if (racer == nullptr) continue;
+
+        place_from_lander(racer, shown.players[i].lander);
+        if (race.players[i].status == RACER_CRASHED) {
+            emit_debris(glm::vec2(racer->get_position()));
+            g_game_state.entities.destroy(g_game_state.racers[i]);
+            g_game_state.racers[i] = PoolHandle();
+        }
+    }
+
+    // Ours runs ahead on what's been pressed, so it answers the controls without waiting
+    // out the input delay. The predicted race only gets as far as input_delay steps ago.
+    Entity* ship = g_game_state.entities.get(g_game_state.spaceship);
+    place_from_lander(ship, g_lockstep.predict_player().lander);
+}
+
+void spawn_racers()
+{
+    AnimationSystem& animations = g_game_state.animations;
+    int ship_idle = animations.find_clip("spaceship.idle");
+
+    const RaceState& race = g_lockstep.get_race();
+    g_game_state.racers.assign(race.player_count, PoolHandle());
+    for (uint32_t i = 0; i < race.player_count; i++) {
+        if ((int)i == g_lockstep.get_player()) continue;
+
+        g_game_state.racers[i] = g_game_state.entities.create(&animations, ship_idle, g_physics.speed);
+        Entity* racer = g_game_state.entities.get(g_game_state.racers[i]);
+        racer->set_scale(glm::vec3(0.5f, 0.5f, 1.0f));
+        racer->set_collision_mask(&g_spaceship_mask);
+        racer->set_hull(&g_spaceship_hull);
+    }
+
+    sync_race_ships();
+}
+
+// Without the server there's no race, but the ship can still be flown
+void leave_race()
+{
+    for (PoolHandle& handle : g_game_state.racers) {
+        if (!handle.is_null()) g_game_state.entities.destroy(handle);
+        handle = PoolHandle();
+    }
+
+    g_lockstep.close();
+    g_racing = false;
+    LOG("Flying on alone");
+}
+
+// Scatters the hand-placed asteroids, replacing any already out there
+void spawn_asteroids()
+{
+    for (PoolHandle handle : g_game_state.asteroids) {
+        g_game_state.broadphase.destroy_proxy(g_game_state.entities.get(handle)->get_broadphase_proxy());
+        g_game_state.entities.destroy(handle);
+    }
+    g_game_state.asteroids.clear();
+
+    AnimationSystem& animations = g_game_state.animations;
+    int asteroid_idle = animations.find_clip("asteroid.idle");
+    const Settings& settings = g_settings;
+
+    int count = g_racing ? 0 : std::max(0, std::min(settings.asteroid_count, MAX_ASTEROIDS));
+    for (int i = 0; i < count; i++) {
+        PoolHandle handle = g_game_state.entities.create(
+            &animations,
+            asteroid_idle,
+            0.0f // Asteroids do not move
+        );
+        Entity* asteroid = g_game_state.entities.get(handle);
 
         // Randomly position asteroids
-        float x = -4.0f + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / 8.0f)); // Keep within the screen width
-        float y = -2.5f + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / 4.0f)); // Keep within the screen height
+        float x = settings.asteroid_min_x + static_cast<float>(rand()) / RAND_MAX * (settings.asteroid_max_x - settings.asteroid_min_x);
+        float y = settings.asteroid_min_y + static_cast<float>(rand()) / RAND_MAX * (settings.asteroid_max_y - settings.asteroid_min_y);
 
         asteroid->set_position(glm::vec3(x, y, 0.0f));
         asteroid->set_scale(glm::vec3(1.0f, 1.0f, 1.0f));
+        asteroid->set_collision_mask(&g_asteroid_mask);
+        asteroid->set_hull(&g_asteroid_hull);
+        asteroid->set_broadphase_proxy(g_game_state.broadphase.create_proxy(asteroid->get_bounds(), asteroid));
 
-        g_game_state.asteroids.push_back(asteroid);
+        g_game_state.asteroids.push_back(handle);
     }
+}
 
-    Entity* asteroid = new Entity(
-        { asteroid_texture },
-        2.0f, 
-        { {0} },
-        0.0f,
-        1,
-        0,
-        1,
-        1,
-        MOVE_STRAIGHT
-    );
+// SDL, glm::ortho and the pacer take whatever they're given, so anything they
+// can't use goes back to what it was before, and says why
+void validate_settings(Settings& settings, const Settings& fallback)
+{
+    if (settings.window_width < MIN_WINDOW_SIZE || settings.window_width > MAX_WINDOW_SIZE
+        || settings.window_height < MIN_WINDOW_SIZE || settings.window_height > MAX_WINDOW_SIZE) {
+        LOG(CONFIG_PATH << ": a window of " << settings.window_width << " x " << settings.window_height << " isn't between "
+            << MIN_WINDOW_SIZE << " and " << MAX_WINDOW_SIZE << " each way, keeping " << fallback.window_width << " x " << fallback.window_height);
+        settings.window_width = fallback.window_width;
+        settings.window_height = fallback.window_height;
+    }
 
-    asteroid->set_position(glm::vec3(3, 0, 0.0f));
-    asteroid->set_scale(glm::vec3(1.0f, 1.0f, 1.0f));
+    // Written this way round so NaN fails too
+    if (!(settings.view_half_width > 0.0f && settings.view_half_height > 0.0f)
+        || std::isinf(settings.view_half_width) || std::isinf(settings.view_half_height)) {
+        LOG(CONFIG_PATH << ": a view of " << settings.view_half_width << " x " << settings.view_half_height
+            << " has to be positive, keeping " << fallback.view_half_width << " x " << fallback.view_half_height);
+        settings.view_half_width = fallback.view_half_width;
+        settings.view_half_height = fallback.view_half_height;
+    }
 
-    g_game_state.asteroids.push_back(asteroid);
+    if (settings.vsync < SWAP_OFF || settings.vsync > SWAP_ADAPTIVE) {
+        LOG(CONFIG_PATH << ": vsync " << settings.vsync << " isn't 0, 1 or 2, keeping " << fallback.vsync);
+        settings.vsync = fallback.vsync;
+    }
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (settings.target_fps < 0) {
+        LOG(CONFIG_PATH << ": target_fps " << settings.target_fps << " can't be negative, keeping " << fallback.target_fps);
+        settings.target_fps = fallback.target_fps;
+    }
+
+    // Out of range counts are clamped when they're spawned, but a backwards range has nowhere to put them
+    if (!(settings.asteroid_min_x <= settings.asteroid_max_x && settings.asteroid_min_y <= settings.asteroid_max_y)) {
+        LOG(CONFIG_PATH << ": asteroids between x " << settings.asteroid_min_x << " and " << settings.asteroid_max_x
+            << ", y " << settings.asteroid_min_y << " and " << settings.asteroid_max_y << " need each min no more than its max, keeping the old ones");
+        settings.asteroid_min_x = fallback.asteroid_min_x;
+        settings.asteroid_max_x = fallback.asteroid_max_x;
+        settings.asteroid_min_y = fallback.asteroid_min_y;
+        settings.asteroid_max_y = fallback.asteroid_max_y;
+    }
+}
+
+// For the settings where any value is fine, as long as it is one
+void keep_finite(const char* name, float& value, float fallback)
+{
+    if (std::isfinite(value)) return;
+    LOG(CONFIG_PATH << ": " << name << " isn't a number, keeping " << fallback);
+    value = fallback;
+}
+
+// Every step runs on these, so one bad value sends the ship (and the autopilot's plans) off to infinity
+void validate_flight(PhysicsParams& physics, LevelParams& level, const PhysicsParams& fallback_physics, const LevelParams& fallback_level)
+{
+    keep_finite("physics.gravity", physics.gravity, fallback_physics.gravity);
+    keep_finite("physics.side_thrust", physics.side_thrust, fallback_physics.side_thrust);
+    keep_finite("physics.up_thrust", physics.up_thrust, fallback_physics.up_thrust);
+    keep_finite("physics.idle_vertical", physics.idle_vertical, fallback_physics.idle_vertical);
+    keep_finite("level.start_height", level.start_height, fallback_level.start_height);
+    keep_finite("level.start_drift", level.start_drift, fallback_level.start_drift);
+
+    // Written this way round so NaN fails too
+    if (!(physics.speed > 0.0f) || std::isinf(physics.speed)) {
+        LOG(CONFIG_PATH << ": physics.speed " << physics.speed << " has to be positive, keeping " << fallback_physics.speed);
+        physics.speed = fallback_physics.speed;
+    }
+
+    // Above 1 the "drag" speeds the ship up a bit more every step
+    if (!(physics.acceleration_decay >= 0.0f && physics.acceleration_decay <= 1.0f)) {
+        LOG(CONFIG_PATH << ": physics.acceleration_decay " << physics.acceleration_decay << " isn't between 0 and 1, keeping " << fallback_physics.acceleration_decay);
+        physics.acceleration_decay = fallback_physics.acceleration_decay;
+    }
+
+    if (!(physics.fuel_burn >= 0.0f) || std::isinf(physics.fuel_burn)) {
+        LOG(CONFIG_PATH << ": physics.fuel_burn " << physics.fuel_burn << " can't be negative, keeping " << fallback_physics.fuel_burn);
+        physics.fuel_burn = fallback_physics.fuel_burn;
+    }
+
+    if (!(level.start_fuel >= 0.0f) || std::isinf(level.start_fuel)) {
+        LOG(CONFIG_PATH << ": level.start_fuel " << level.start_fuel << " can't be negative, keeping " << fallback_level.start_fuel);
+        level.start_fuel = fallback_level.start_fuel;
+    }
+}
+
+// Pushes freshly loaded settings into the running game, only redoing what actually changed
+void apply_settings(const Settings& previous)
+{
+    validate_settings(g_settings, previous);
+    const Settings& settings = g_settings;
+
+    if (settings.window_width != previous.window_width || settings.window_height != previous.window_height) {
+        SDL_SetWindowSize(g_display_window, settings.window_width, settings.window_height);
+        glViewport(VIEWPORT_X, VIEWPORT_Y, settings.window_width, settings.window_height);
+    }
+
+    if (settings.view_half_width != previous.view_half_width || settings.view_half_height != previous.view_half_height) {
+        // Goes out with the next frame's upload
+        g_frame_uniforms.set_projection(glm::ortho(-settings.view_half_width, settings.view_half_width, -settings.view_half_height, settings.view_half_height, -1.0f, 1.0f));
+        g_camera.set_half_extents(settings.view_half_width, settings.view_half_height);
+        g_geometry_cache.resize(settings.view_half_width, settings.view_half_height);
+    }
+
+    if (settings.vsync != previous.vsync) g_frame_pacer.set_swap_mode((SwapMode)settings.vsync);
+    g_frame_pacer.set_target_fps(settings.target_fps);
+    g_frame_pacer.set_just_in_time(settings.just_in_time != 0);
+
+    Entity* ship = g_game_state.entities.get(g_game_state.spaceship);
+    ship->set_speed(g_physics.speed);
+    ship->set_gravity(g_physics.gravity);
+    ship->set_acceleration_decay(g_physics.acceleration_decay);
+    g_autopilot.set_params(g_physics);
+
+    if (settings.asteroid_count != previous.asteroid_count
+        || settings.asteroid_min_x != previous.asteroid_min_x || settings.asteroid_max_x != previous.asteroid_max_x
+        || settings.asteroid_min_y != previous.asteroid_min_y || settings.asteroid_max_y != previous.asteroid_max_y) {
+        spawn_asteroids();
+    }
+}
+
+void reload_settings()
+{
+    Settings previous = g_settings;
+    PhysicsParams previous_physics = g_physics;
+    LevelParams previous_level = g_level;
+    if (!g_config.load(CONFIG_PATH)) return;
+    validate_flight(g_physics, g_level, previous_physics, previous_level);
+
+    // The load just put back our own physics and level, but the race is still on the server's
+    if (g_racing) {
+        g_physics = g_lockstep.get_settings().physics;
+        g_level = g_lockstep.get_settings().level;
+    }
+
+    apply_settings(previous);
+    LOG("Reloaded " << CONFIG_PATH);
 }
+
 void process_input()
 {
     SDL_Event event;
     while (SDL_PollEvent(&event))
     {
+        // Flying controls are queued with their timestamps and picked up by the steps in update()
+        if (g_input.handle_event(event)) continue;
+
         switch (event.type) {
         case SDL_QUIT:
         case SDL_WINDOWEVENT_CLOSE:
@@ -240,200 +811,527 @@ void process_input()
         case SDL_KEYDOWN:
             if (event.key.keysym.sym == SDLK_q)
                 g_app_status = TERMINATED;
+            else if (event.key.keysym.sym == SDLK_p) {
+                // Start from a blank plan rather than whatever it was doing last time it flew
+                g_autopilot_enabled = !g_autopilot_enabled;
+                if (g_autopilot_enabled) g_autopilot.reset();
+            }
+            else if (event.key.keysym.sym == SDLK_t)
+                g_telemetry_enabled = !g_telemetry_enabled;
             break;
         }
     }
 
-    const Uint8* key_state = SDL_GetKeyboardState(NULL);
+    if (g_autopilot_enabled) {
+        Entity* ship = g_game_state.entities.get(g_game_state.spaceship);
 
-    glm::vec3 acceleration = g_game_state.spaceship->get_acceleration();
+        LanderState state;
+        state.position = glm::vec2(ship->get_position());
+        state.movement = glm::vec2(ship->get_movement());
+        state.acceleration = glm::vec2(ship->get_acceleration());
+        state.fuel = ship->get_fuel();
 
-    // Apply acceleration when pressing movement keys
-    if (g_game_state.spaceship->get_fuel() > 0.0f)
-    {
-        if (key_state[SDL_SCANCODE_A]) {
-            acceleration.x = -1.5f; // Move left
-        }
-        else if (key_state[SDL_SCANCODE_D]) {
-            acceleration.x = 1.5f;  // Move right
-        }
-        else {
-            acceleration.x = 0.0f;  // No horizontal thrust
-        }
+        // The planner works on its own copy of the ground, the streamer's tiles stay on this thread
+        g_terrain_profile.origin_x = state.position.x - AUTOPILOT_PROFILE_BEHIND;
+        g_game_state.world.sample_ground(g_terrain_profile.origin_x, TERRAIN_PROFILE_SPACING, g_terrain_profile.heights, TERRAIN_PROFILE_SAMPLES);
 
-        // For vertical thrust, if desired:
-        if (key_state[SDL_SCANCODE_W]) {
-            acceleration.y = 1.5f; // For example, thrust upward
-        }
-        else {
-            // Let gravity do its work (or set a baseline, if needed)
-            acceleration.y = -0.5f;
-        }
+        AutopilotGoal goal;
+        // A race only counts its own pad, however near another one is
+        goal.pad_x = g_racing ? g_lockstep.get_course().pad_x : g_game_state.world.nearest_landing_pad(state.position.x);
+        goal.pad_half_width = LANDING_PAD_HALF_WIDTH;
+        goal.ship_half_extents = glm::vec2(ship->get_half_extents());
+
+        // Every step the plan gets flown by is a fixed one, so that's what it slides along by
+        g_autopilot_buttons = buttons_from_control(g_autopilot.plan(state, g_terrain_profile, goal, (float)SIMULATION_STEP));
     }
-    else {
-        // No fuel left: ensure no acceleration is applied
-        acceleration = glm::vec3(0.0f);
-        acceleration.y = -0.5f;
+}
+
+
+void emit_exhaust(float delta_time)
+{
+    Entity* ship = g_game_state.entities.get(g_game_state.spaceship);
+    glm::vec3 accel = ship->get_acceleration();
+
+    // Only W pushes up, anything else on y is just the baseline pull
+    glm::vec2 thrust(accel.x, accel.y > 0.0f ? accel.y : 0.0f);
+    if (glm::length(thrust) < 0.01f || ship->get_fuel() <= 0.0f) {
+        g_exhaust_accumulator = 0.0f;
+        return;
     }
 
-    g_game_state.spaceship->set_acceleration(acceleration);
+    g_exhaust_accumulator += EXHAUST_PARTICLES_PER_SECOND * delta_time;
+    int count = (int)g_exhaust_accumulator;
+    g_exhaust_accumulator -= count;
+
+    glm::vec2 direction = -glm::normalize(thrust);
+    ParticleEmitter exhaust;
+    exhaust.position = glm::vec2(ship->get_position()) + direction * glm::vec2(ship->get_half_extents()) * 0.8f;
+    exhaust.velocity = direction * EXHAUST_SPEED + glm::vec2(ship->get_movement() * ship->get_speed());
+    exhaust.spread = EXHAUST_SPREAD;
+    exhaust.speed_jitter = 0.3f;
+    exhaust.position_jitter = 0.03f;
+    exhaust.lifetime = EXHAUST_LIFETIME;
+    exhaust.size = EXHAUST_SIZE;
+
+    g_game_state.particles.emit(exhaust, count);
 }
 
+void emit_debris(glm::vec2 position)
+{
+    // Straight up with the full circle of spread, so it goes everywhere
+    ParticleEmitter debris;
+    debris.position = position;
+    debris.velocity = glm::vec2(0.0f, DEBRIS_SPEED);
+    debris.spread = 3.14159265f;
+    debris.speed_jitter = 0.8f;
+    debris.position_jitter = 0.15f;
+    debris.lifetime = DEBRIS_LIFETIME;
+    debris.size = DEBRIS_SIZE;
+
+    g_game_state.particles.emit(debris, DEBRIS_PARTICLES);
+}
 
-void update()
+void crash()
 {
-    if (g_game_state.game_over) return; // Stop updating if the game is over
+    g_game_state.game_over = true;
+    emit_debris(glm::vec2(g_game_state.entities.get(g_game_state.spaceship)->get_position()));
+}
+
+// Moves the world back under the ship a whole number of tiles, before floats get
+// too coarse for the ground out there
+void rebase_world()
+{
+    Entity* ship = g_game_state.entities.get(g_game_state.spaceship);
+    float shift = g_game_state.world.rebase(ship->get_position().x);
+    if (shift == 0.0f) return;
+
+    // The streamer moves its own asteroids, everything else is ours
+    glm::vec3 offset(shift, 0.0f, 0.0f);
+    ship->set_position(ship->get_position() - offset);
+    for (PoolHandle handle : g_game_state.asteroids) {
+        Entity* asteroid = g_game_state.entities.get(handle);
+        asteroid->set_position(asteroid->get_position() - offset);
+        asteroid->update(0.0f);
+    }
+    g_game_state.broadphase.shift_origin(glm::vec2(shift, 0.0f));
+    g_game_state.particles.shift_origin(glm::vec2(shift, 0.0f));
+    g_camera.shift_origin(glm::vec2(shift, 0.0f));
+}
 
+void update()
+{
     float ticks = (float)SDL_GetTicks() / MILLISECONDS_IN_SECOND;
     float delta_time = ticks - g_previous_ticks;
     g_previous_ticks = ticks;
+    g_frame_uniforms.set_time(ticks, delta_time);
+    if (delta_time > 0.0f) g_telemetry_rates.fps += (1.0f / delta_time - g_telemetry_rates.fps) * TELEMETRY_SMOOTHING;
+
+    if (g_config_watcher.has_changed(delta_time)) reload_settings();
 
-    g_game_state.spaceship->update(delta_time);
+    // Only does anything in debug builds
+    g_shader_program.reload_if_changed(delta_time);
+    g_terrain_program.reload_if_changed(delta_time);
+    g_particle_program.reload_if_changed(delta_time);
+    g_screen_program.reload_if_changed(delta_time);
+    g_text_program.reload_if_changed(delta_time);
+
+    // Debris keeps flying after the crash, so particles run even when the game has stopped
+    g_game_state.particles.update(delta_time);
+
+    // Every animated sprite in one pass
+    g_game_state.animations.update(delta_time);
+
+    if (g_racing) {
+        g_lockstep.poll();
+        if (g_lockstep.is_timed_out()) leave_race();
+    }
+
+    // Stop updating if the game is over, but keep the input queue drained. A race
+    // carries on until everyone's down, this ship or not.
+    if ((g_game_state.game_over || g_game_state.game_won) && !g_racing) {
+        g_input.take_step(SDL_GetTicks());
+        return;
+    }
+
+    Entity* ship = g_game_state.entities.get(g_game_state.spaceship);
+
+    // Race courses are short and every peer has to step the same floats, so only
+    // free flight ever moves the origin
+    if (!g_racing && fabsf(ship->get_position().x) > WORLD_REBASE_DISTANCE) rebase_world();
+
+    // Pull in new tiles ahead of the ship and let go of the ones behind it
+    g_game_state.world.update(ship->get_position().x);
+
+    // As many steps as fit up to now, each one with the input from its own slice
+    // of it. Anything pressed after the last step waits in the queue for the next frame.
+    double now = (double)SDL_GetTicks() / MILLISECONDS_IN_SECOND;
+    g_simulation_time = std::max(g_simulation_time, now - MAX_STEPS_PER_FRAME * SIMULATION_STEP);
+
+    float fuel_before = ship->get_fuel();
+    while (g_simulation_time + SIMULATION_STEP <= now) {
+        g_simulation_time += SIMULATION_STEP;
+        uint8_t buttons = g_input.take_step((Uint32)(g_simulation_time * MILLISECONDS_IN_SECOND));
+
+        if (g_racing) {
+            step_race(g_autopilot_enabled ? g_autopilot_buttons : buttons);
+            continue;
+        }
+
+        // The game can end on any step, the rest of the frame's input still gets used up
+        if (g_game_state.game_over || g_game_state.game_won) continue;
+        step_simulation(g_autopilot_enabled ? g_autopilot_buttons : buttons, (float)SIMULATION_STEP);
+    }
+    if (delta_time > 0.0f) {
+        float burn_rate = (fuel_before - ship->get_fuel()) / delta_time;
+        g_telemetry_rates.burn_rate += (burn_rate - g_telemetry_rates.burn_rate) * TELEMETRY_SMOOTHING;
+    }
+
+    g_camera.follow(glm::vec2(ship->get_position()), glm::vec2(ship->get_movement() * ship->get_speed()));
+    g_camera.update(delta_time);
+}
+
+void step_simulation(uint8_t buttons, float delta_time)
+{
+    Entity* ship = g_game_state.entities.get(g_game_state.spaceship);
+
+    // With no fuel left this is just the idle sink
+    LanderControl control = control_from_buttons(buttons);
+    ship->set_acceleration(glm::vec3(control_acceleration(control, ship->get_fuel(), g_physics), 0.0f));
+
+    ship->update(delta_time);
+    emit_exhaust(delta_time);
 
     // Update each asteroid so their model matrices are recalculated
-    for (Entity* asteroid : g_game_state.asteroids) {
+    for (PoolHandle handle : g_game_state.asteroids) {
+        Entity* asteroid = g_game_state.entities.get(handle);
+        glm::vec3 previous_position = asteroid->get_position();
         asteroid->update(delta_time);
+
+        // Static asteroids never leave their fat box, so only the movers need refitting
+        if (asteroid->get_speed() != 0.0f) {
+            glm::vec3 displacement = asteroid->get_position() - previous_position;
+            g_game_state.broadphase.move_proxy(asteroid->get_broadphase_proxy(), asteroid->get_bounds(), glm::vec2(displacement));
+        }
     }
 
-    glm::vec3 accel = g_game_state.spaceship->get_acceleration();
-    if ((fabs(accel.x) > 0.01f || fabs(accel.y) > 0.01f) && g_game_state.spaceship->get_fuel() > 0.0f)
+    glm::vec3 accel = ship->get_acceleration();
+    if ((fabs(accel.x) > 0.01f || fabs(accel.y) > 0.01f) && ship->get_fuel() > 0.0f)
     {
-        // Consume fuel at a rate of 10 units per second (adjust as needed)
-        g_game_state.spaceship->consume_fuel(5.0f * delta_time);
+        ship->consume_fuel(g_physics.fuel_burn * delta_time);
     }
 
-    if (g_game_state.spaceship->get_position().x >= 5.0f) {
-        g_game_state.game_won = true;
-        return;
-    }
+    // Touching down gently on a pad wins, anywhere else on the ground we just
+    // come to rest, and coming in too fast is a crash
+    ContactManifold ground_contact;
+    if (g_game_state.world.check_ground_contact(ship, ground_contact)) {
+        if (!ground_contact.is_soft_landing()) {
+            crash();
+            return;
+        }
+
+        ship->resolve_contact(ground_contact);
 
-    // Check for collisions with asteroids
-    for (Entity* asteroid : g_game_state.asteroids) {
-        if (g_game_state.spaceship->check_collision(asteroid)) {
-            g_game_state.game_over = true;
+        AABB ship_bounds = ship->get_bounds();
+        if (g_game_state.world.is_landing_pad(ship_bounds.min.x, ship_bounds.max.x)) {
+            g_game_state.game_won = true;
             return;
         }
     }
+
+    // Check for collisions with the asteroids near the ship: touching down gently
+    // on top of one is fine, anything else is a crash
+    ContactManifold manifold;
+    g_game_state.broadphase.query(ship->get_bounds(), [&](int proxy) {
+        Entity* asteroid = static_cast<Entity*>(g_game_state.broadphase.get_user_data(proxy));
+        if (!ship->check_contact(asteroid, manifold)) return true;
+
+        if (manifold.is_soft_landing()) {
+            ship->resolve_contact(manifold);
+            return true;
+        }
+
+        crash();
+        return false;
+        });
 }
 
-void render_background()
+// A race tick: this tick's input goes off to everyone, and the race plays whatever
+// steps everyone's input is in for, two a tick while it's catching up
+void step_race(uint8_t buttons)
 {
-    glUseProgram(g_shader_program.get_program_id()); // Ensure shader is active
+    g_lockstep.submit(buttons);
 
-    glm::mat4 identity_matrix = glm::mat4(1.0f);
-    g_shader_program.set_model_matrix(identity_matrix); // Reset transformations
+    // Rolling back, the confirmed race isn't what's shown, so it takes everything that's in
+    if (g_lockstep.is_rolling_back()) {
+        while (g_lockstep.can_step()) g_lockstep.step();
+        g_lockstep.predict();
+    }
+    else if (!g_lockstep.can_step()) {
+        if (!race_finished(g_lockstep.get_race())) g_lockstep.count_stall();
+    }
+    else {
+        int steps = g_lockstep.get_steps_ready() > LOCKSTEP_CATCH_UP ? 2 : 1;
+        for (int i = 0; i < steps && g_lockstep.can_step(); i++) g_lockstep.step();
+    }
 
-    glBindTexture(GL_TEXTURE_2D, g_background_texture);
+    sync_race_ships();
+    if (g_game_state.game_over || g_game_state.game_won) return;
+    emit_exhaust((float)SIMULATION_STEP);
 
-    float vertices[] = {
-        -5.0f, -3.75f,   // Bottom-left
-         5.0f, -3.75f,   // Bottom-right
-         5.0f,  3.75f,   // Top-right
-        -5.0f,  3.75f    // Top-left
-    };
+    // The verdict waits for the confirmed race, even though ours got there a little sooner
+    const RacePlayer& player = g_lockstep.get_race().players[g_lockstep.get_player()];
+    if (player.status == RACER_LANDED) g_game_state.game_won = true;
+    else if (player.status == RACER_CRASHED) crash();
+}
 
-    float tex_coords[] = {
-        0.0f, 1.0f,  // Bottom-left
-        1.0f, 1.0f,  // Bottom-right
-        1.0f, 0.0f,  // Top-right
-        0.0f, 0.0f   // Top-left
-    };
+void render_background()
+{
+    // Pinned to the screen, filling it
+    g_render_queue.draw_static_quad(LAYER_BACKGROUND, &g_screen_program, g_background_texture, QUAD_BACKGROUND);
+}
 
-    GLuint indices[] = { 0, 1, 2, 0, 2, 3 };  // Two triangles
+void render_end_screen(GLuint texture)
+{
+    // The win or lose picture, in the middle of the screen
+    g_render_queue.draw_static_quad(LAYER_SCREEN, &g_screen_program, texture, QUAD_END_SCREEN);
+}
 
-    glEnableVertexAttribArray(g_shader_program.get_position_attribute());
-    glVertexAttribPointer(g_shader_program.get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
+// What the terrain pass needs once the queue gets round to it
+struct TerrainPass
+{
+    float focus_x;
+    float view_min_x;
+    float view_max_x;
+};
 
-    glEnableVertexAttribArray(g_shader_program.get_tex_coordinate_attribute());
-    glVertexAttribPointer(g_shader_program.get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
+void render_terrain(void* user)
+{
+    const TerrainPass* pass = static_cast<const TerrainPass*>(user);
+    g_game_state.world.render(&g_terrain_program, pass->focus_x, pass->view_min_x, pass->view_max_x);
+}
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, indices);
+void render_particles(void*)
+{
+    g_game_state.particles.render();
+}
 
-    glDisableVertexAttribArray(g_shader_program.get_position_attribute());
-    glDisableVertexAttribArray(g_shader_program.get_tex_coordinate_attribute());
+void render_text(void* user)
+{
+    static_cast<const TextMesh*>(user)->draw();
 }
 
-void render_end_screen(GLuint texture)
+void render_telemetry_mesh(void* user)
+{
+    static_cast<const TelemetryHud*>(user)->draw();
+}
+
+void render_telemetry(Entity* ship)
 {
-    // Bind the given texture (win or lose)
-    glBindTexture(GL_TEXTURE_2D, texture);
+#ifdef LUNAR_TRACK_ALLOCATIONS
+    Uint64 start = SDL_GetPerformanceCounter();
+#endif
+
+    // get_velocity() is never set by anything; what actually moves the ship is movement times speed
+    glm::vec3 velocity = ship->get_movement() * ship->get_speed();
 
-    // Define a quad that covers the desired area.
-    // Adjust these values as needed.
-    float vertices[] = {
-        -2.5f, -2.0f,  // Bottom-left
-         2.5f, -2.0f,  // Bottom-right
-         2.5f,  2.0f,  // Top-right
-        -2.5f,  2.0f   // Top-left
-    };
+    float ground;
+    g_game_state.world.sample_ground(ship->get_position().x, 0.0f, &ground, 1);
 
-    float tex_coords[] = {
-        0.0f, 1.0f,  // Bottom-left
-        1.0f, 1.0f,  // Bottom-right
-        1.0f, 0.0f,  // Top-right
-        0.0f, 0.0f   // Top-left
-    };
+    float values[TELEMETRY_FIELD_COUNT];
+    values[TELEMETRY_ALTITUDE] = ship->get_bounds().min.y - ground;
+    values[TELEMETRY_VELOCITY_X] = velocity.x;
+    values[TELEMETRY_VELOCITY_Y] = velocity.y;
+    values[TELEMETRY_ACCELERATION] = glm::length(glm::vec2(ship->get_acceleration()));
+    values[TELEMETRY_BURN_RATE] = g_telemetry_rates.burn_rate;
+    values[TELEMETRY_FPS] = g_telemetry_rates.fps;
 
-    GLuint indices[] = { 0, 1, 2, 0, 2, 3 };
+    FramePacerStats pacing = g_frame_pacer.get_stats();
+    values[TELEMETRY_FRAME_DEVIATION] = sqrtf(pacing.variance_ms);
+    values[TELEMETRY_INPUT_LATENCY] = pacing.input_to_photon_ms;
+    g_telemetry_hud.update(values);
 
-    // Enable the position attribute and pass in the vertices
-    glEnableVertexAttribArray(g_shader_program.get_position_attribute());
-    glVertexAttribPointer(g_shader_program.get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
+#ifdef LUNAR_TRACK_ALLOCATIONS
+    g_telemetry_ticks += SDL_GetPerformanceCounter() - start;
+    g_telemetry_frames++;
+#endif
+
+    g_render_queue.draw_callback(LAYER_HUD, &g_text_program, g_hud_font.get_texture(), BLEND_ALPHA, render_telemetry_mesh, &g_telemetry_hud);
+}
+
+void render_hud(Entity* ship)
+{
+    if (!g_hud_font.is_loaded()) {
+        ship->display_fuel(g_render_queue, &g_screen_program, g_frame_arena, g_font_texture_id, 0.5f, 0.05f);
+        if (g_autopilot_enabled) {
+            ship->draw_text(g_render_queue, &g_screen_program, g_font_texture_id, "AUTOPILOT", 0.5f, 0.05f, glm::vec3(-4.5f, 2.9f, 0.0f));
+        }
+        return;
+    }
 
-    // Enable the texture coordinate attribute and pass in the texture coordinates
-    glEnableVertexAttribArray(g_shader_program.get_tex_coordinate_attribute());
-    glVertexAttribPointer(g_shader_program.get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
+    // Each line keeps its mesh, and only rebuilds it when the text changes
+    const char* fuel_text = g_frame_arena.format("Fuel: %d", (int)ship->get_fuel());
+    g_fuel_text.set_text(g_hud_font, fuel_text, HUD_FONT_SIZE, HUD_FONT_SPACING, glm::vec2(-4.75f, 3.65f));
+    g_render_queue.draw_callback(LAYER_HUD, &g_text_program, g_hud_font.get_texture(), BLEND_ALPHA, render_text, &g_fuel_text);
 
-    // Draw the quad using indices
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, indices);
+    if (g_autopilot_enabled) {
+        g_autopilot_text.set_text(g_hud_font, "AUTOPILOT", HUD_FONT_SIZE, HUD_FONT_SPACING, glm::vec2(-4.75f, 3.15f));
+        g_render_queue.draw_callback(LAYER_HUD, &g_text_program, g_hud_font.get_texture(), BLEND_ALPHA, render_text, &g_autopilot_text);
+    }
 
-    glDisableVertexAttribArray(g_shader_program.get_position_attribute());
-    glDisableVertexAttribArray(g_shader_program.get_tex_coordinate_attribute());
+    if (g_telemetry_enabled) render_telemetry(ship);
 }
 
 void render()
 {
     glClear(GL_COLOR_BUFFER_BIT);
+    g_stream_buffer.begin_frame();
+    g_render_queue.begin_frame();
 
+    // The only uniform upload of the frame; everything after this reads it
+    g_frame_uniforms.set_view(g_camera.get_view_matrix());
+    g_frame_uniforms.upload();
+
+    // Nothing below draws yet, it all goes in the queue, so the order here doesn't matter
     render_background();
 
+    Entity* ship = g_game_state.entities.get(g_game_state.spaceship);
+    AABB view_bounds = g_camera.get_view_bounds(CULL_MARGIN);
+    TerrainPass terrain_pass = { ship->get_position().x, view_bounds.min.x, view_bounds.max.x };
+    g_render_queue.draw_callback(LAYER_TERRAIN, &g_terrain_program, 0, BLEND_ALPHA, render_terrain, &terrain_pass);
+
+    if (!g_game_state.game_won && !g_game_state.game_over) {
+        // Only what the broadphase says is on screen gets drawn
+        g_game_state.broadphase.query(view_bounds, [](int proxy) {
+            static_cast<Entity*>(g_game_state.broadphase.get_user_data(proxy))->render(g_render_queue, &g_shader_program);
+            return true;
+            });
+
+        if (view_bounds.overlaps(ship->get_bounds())) ship->render(g_render_queue, &g_shader_program);
+    }
+
+    for (PoolHandle handle : g_game_state.racers) {
+        Entity* racer = g_game_state.entities.get(handle);
+        if (racer != nullptr && view_bounds.overlaps(racer->get_bounds())) racer->render(g_render_queue, &g_shader_program);
+    }
+
+    // Every live particle in one draw, glowing where they're dense
+    g_render_queue.draw_callback(LAYER_EFFECTS, &g_particle_program, 0, BLEND_ADDITIVE, render_particles, nullptr);
+
+    // The end screens and HUD don't move with the camera
     if (g_game_state.game_won) {
         render_end_screen(g_win_texture);
     }
     else if (g_game_state.game_over) {
         render_end_screen(g_game_over_texture);
     }
-    else {
-        // Render the normal game objects
-        for (Entity* asteroid : g_game_state.asteroids) {
-            glUseProgram(g_shader_program.get_program_id());
-            asteroid->render(&g_shader_program);
-        }
-        g_game_state.spaceship->render(&g_shader_program);
-    }
 
-    g_game_state.spaceship->display_fuel(&g_shader_program, g_font_texture_id, 0.5f, 0.05f);
+    render_hud(ship);
+
+    g_render_queue.submit();
 
-    SDL_GL_SwapWindow(g_display_window);
+    // Fenced behind everything drawn from this frame's segment
+    g_stream_buffer.end_frame();
 }
 
 
+#ifdef LUNAR_TRACK_ALLOCATIONS
+// Once things have warmed up a frame should never hit the heap, so say so when one does
+void report_frame_allocations()
+{
+    static uint64_t previous_count = 0;
+    static int frame = 0;
+
+    uint64_t count = get_allocation_count();
+    if (++frame > ALLOCATION_WARMUP_FRAMES && count != previous_count) {
+        std::cout << "Frame " << frame << " made " << (count - previous_count) << " heap allocations" << std::endl;
+    }
+    previous_count = count;
+}
+#endif
+
 void shutdown()
 {
+#ifdef LUNAR_TRACK_ALLOCATIONS
+    std::cout << "Frame arena high-water mark: " << g_frame_arena.get_high_water_mark() << " of "
+        << g_frame_arena.get_frame_size() << " bytes, " << g_frame_arena.get_overflow_count() << " overflows" << std::endl;
+    std::cout << "Stream buffer (" << (g_stream_buffer.is_persistent() ? "persistent" : "orphaned") << "): peak "
+        << g_stream_buffer.get_peak_frame_bytes() << " of " << g_stream_buffer.get_segment_size() << " bytes a frame, "
+        << g_stream_buffer.get_stall_count() << " stalls, " << g_stream_buffer.get_overflow_count() << " overflows" << std::endl;
+    std::cout << "Render queue: " << g_render_queue.get_overflow_count() << " overflows" << std::endl;
+    if (g_telemetry_frames > 0) {
+        double microseconds = 1e6 * (double)g_telemetry_ticks / (double)SDL_GetPerformanceFrequency() / g_telemetry_frames;
+        std::cout << "Telemetry: " << microseconds << " us a frame, " << g_telemetry_hud.get_patched_characters() << " characters patched in "
+            << g_telemetry_hud.get_uploads() << " uploads" << std::endl;
+    }
+    FramePacerStats pacing = g_frame_pacer.get_stats();
+    std::cout << "Frame pacing: " << pacing.mean_ms << " ms a frame, variance " << pacing.variance_ms << " ms^2, worst "
+        << pacing.worst_ms << " ms, about " << pacing.input_to_photon_ms << " ms from input to screen" << std::endl;
+    std::cout << "Input: " << g_input.get_dropped_count() << " events dropped, " << g_input.get_average_delay_ms()
+        << " ms on average from an event to the end of its step" << std::endl;
+    if (g_racing) {
+        const NetStats& net = g_lockstep.get_net_stats();
+        std::cout << "Race: " << g_lockstep.get_stalls() << " stalled steps, " << net.packets_sent << " packets sent and "
+            << net.packets_received << " received, " << net.bytes_sent + net.bytes_received << " bytes both ways" << std::endl;
+        const RollbackStats& rollback = g_lockstep.get_rollback_stats();
+        if (g_lockstep.is_rolling_back()) std::cout << "Rollback: " << rollback.rollbacks << " rollbacks, "
+            << rollback.steps_replayed << " steps played again, at most " << rollback.worst_replay << " at once" << std::endl;
+    }
+#endif
+
+    if (g_racing) g_lockstep.close();
+
+    g_thread_pool.stop();
+    g_game_state.world.stop();
+    g_game_state.particles.release();
+    g_shader_program.release();
+    g_terrain_program.release();
+    g_particle_program.release();
+    g_screen_program.release();
+    g_text_program.release();
+    g_fuel_text.release();
+    g_autopilot_text.release();
+    g_telemetry_hud.release();
+    g_sprite_batch.release();
+    g_stream_buffer.release();
+    g_geometry_cache.release();
+    g_frame_uniforms.release();
+    g_input.close_gamepads();
     SDL_Quit();
-    delete   g_game_state.spaceship;
+
+    // Runs every entity's destructor, nothing else to hand back
+    g_game_state.entities.clear();
 }
 
 
 int main(int argc, char* argv[])
 {
-    initialise();
+    // --connect host[:port] races whoever else joins that server, and --rollback
+    // shows the race on guessed input rather than waiting for everyone's
+    const char* race_server = nullptr;
+    bool rollback = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) race_server = argv[++i];
+        else if (strcmp(argv[i], "--rollback") == 0) rollback = true;
+    }
+
+    initialise(race_server, rollback);
+
+    // Loading took a while, and that's no frame
+    g_frame_pacer.restart();
 
     while (g_app_status == RUNNING)
     {
+        g_frame_arena.begin_frame();
+
+        g_frame_pacer.wait_for_input();
         process_input();
         update();
         render();
+        g_frame_pacer.present(g_display_window);
+
+#ifdef LUNAR_TRACK_ALLOCATIONS
+        report_frame_allocations();
+#endif
     }
 
     shutdown();
@@ -1,5 +1,5 @@
 uniform vec4 color;
 
 void main() {
-    gl_FragColor = color;
+    frag_colour = color;
 }
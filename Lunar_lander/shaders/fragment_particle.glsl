@@ -0,0 +1,11 @@
+varying float lifeVar;
+
+void main() {
+    // Round, soft-edged points, white-hot when young and cooling to red as they die
+    vec2 offset = gl_PointCoord - vec2(0.5);
+    float falloff = 1.0 - smoothstep(0.25, 0.5, length(offset));
+
+    vec3 hot = vec3(1.0, 0.95, 0.7);
+    vec3 cold = vec3(0.8, 0.2, 0.05);
+    frag_colour = vec4(mix(cold, hot, lifeVar), falloff * lifeVar);
+}
@@ -0,0 +1,17 @@
+
+uniform sampler2D diffuse;
+uniform vec4 color;
+varying vec2 texCoordVar;
+
+void main() {
+    // Red is the distance to the fill's edge, green to the outline's, 0.5 on the edge.
+    // fwidth keeps the ramp about a pixel wide however big the text is drawn.
+    vec2 field = texture2D(diffuse, texCoordVar).rg;
+    vec2 smoothing = max(fwidth(field) * 0.5, vec2(0.001));
+
+    float fill = smoothstep(0.5 - smoothing.x, 0.5 + smoothing.x, field.x);
+    float shape = smoothstep(0.5 - smoothing.y, 0.5 + smoothing.y, field.y);
+
+    // The outline is black, like the bitmap font's
+    frag_colour = vec4(color.rgb * fill, color.a * shape);
+}
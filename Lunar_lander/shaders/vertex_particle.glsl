@@ -0,0 +1,12 @@
+attribute vec4 position;
+attribute float life;
+attribute float size;
+
+varying float lifeVar;
+
+void main()
+{
+	lifeVar = life;
+	gl_PointSize = size * (0.5 + 0.5 * life);
+	gl_Position = projectionMatrix * viewMatrix * position;
+}
@@ -0,0 +1,11 @@
+attribute vec4 position;
+attribute vec2 texCoord;
+
+varying vec2 texCoordVar;
+
+void main()
+{
+    // Already in screen space, so only the projection applies
+    texCoordVar = texCoord;
+	gl_Position = projectionMatrix * position;
+}
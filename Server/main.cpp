@@ -0,0 +1,378 @@
+/**
+ * Headless race server. Waits for --players clients, then relays their input in
+ * lockstep until the race is over, stepping its own copy of the race to catch
+ * anyone who falls out of sync.
+ *
+ * With --bots it also fills the seats itself: that many clients in this process,
+ * each on its own localhost socket behind the --latency, --jitter and --loss
+ * given, flying a scripted pilot. At the end every bot's race is compared with
+ * the server's, so it tests the whole protocol without a window or a second machine.
+ * With --worst-case as well, the bots' buttons change on nearly every step, which
+ * is the most input there is to send.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glm/geometric.hpp"
+#include "Lockstep.h"
+#include "Heightfield.h"
+
+//  CONSTANTS  //
+constexpr int POLL_INTERVAL_MS = 1;
+constexpr int LINGER_MS = 500;                  // after the race, for the last packets to get out
+constexpr double STEP_MS = 1000.0 * RACE_STEP;
+constexpr double RACE_TIME_LIMIT = 180.0;       // seconds, in case a pilot hovers forever
+
+constexpr float BANDWIDTH_BUDGET = 1024.0f;     // bytes a second a player, both ways
+
+constexpr int BENCH_RACE_STEPS = 60 * 60;       // a minute of race recorded per size, to roll back over
+constexpr int BENCH_PASSES = 20;                // over each recording, for the worst case to turn up
+constexpr double FRAME_MS = 1000.0 / 60.0;
+
+struct Options
+{
+    uint16_t port = LOCKSTEP_PORT;
+    RaceSettings settings;
+    int bots = 0;
+    int rollback = 0;                           // steps the bots guess ahead, 0 for plain lockstep
+    bool rollback_bench = false;
+    bool worst_case = false;                    // bots change buttons every step they can
+    NetConditions conditions;
+};
+
+//  PILOT  //
+/**
+ * Much the same plain pilot as the Tuner's: steer for the pad, come down on the
+ * way, and brake the descent harder the closer the ground gets. Each player
+ * cruises at a slightly different speed, so they don't all fly the same line.
+ * It's given the predicted ship, or the input delay has it overshooting every
+ * correction and burning the tank dry.
+ */
+uint8_t bot_pilot(const LanderState& state, const RaceCourse& course, int player, const PhysicsParams& params)
+{
+    LanderControl control;
+
+    glm::vec2 velocity = state.movement * params.speed;
+    float to_pad = course.pad_x - state.position.x;
+    float altitude = state.position.y - RACE_SHIP_HALF_HEIGHT - course.ground_at(state.position.x);
+
+    float cruise = 1.0f + 0.15f * player;
+    float wanted_vx = std::max(-cruise, std::min(cruise, to_pad * 0.8f));
+    if (velocity.x < wanted_vx - 0.1f) control.x = 1;
+    else if (velocity.x > wanted_vx + 0.1f) control.x = -1;
+
+    // Fuel burns the whole time, so it comes down on the way rather than hovering at the pad
+    float wanted_vy;
+    if (fabsf(to_pad) < LANDING_PAD_HALF_WIDTH) wanted_vy = -std::min(0.8f, std::max(0.4f, altitude * 0.5f));
+    else wanted_vy = altitude > 1.5f ? -0.6f : (altitude < 0.8f ? 0.3f : 0.0f);
+    control.up = velocity.y < wanted_vy;
+
+    return buttons_from_control(control);
+}
+
+/**
+ * Right flipped on every other step, so the buttons hardly ever hold, but the
+ * ship still flies: left wins when both are down, so only steering right gets
+ * weaker, and the pilot makes up for that.
+ */
+uint8_t worst_case_pilot(const LanderState& state, const RaceCourse& course, int player, const PhysicsParams& params, uint32_t step)
+{
+    uint8_t buttons = bot_pilot(state, course, player, params);
+    return step % 2 == 0 ? buttons : (uint8_t)(buttons ^ INPUT_RIGHT);
+}
+
+//  RESULTS  //
+void print_results(const RaceState& race)
+{
+    for (uint32_t i = 0; i < race.player_count; i++)
+    {
+        const RacePlayer& player = race.players[i];
+        std::cout << "Player " << i + 1 << ": ";
+        if (player.status == RACER_LANDED) std::cout << "landed after " << player.finish_step * RACE_STEP << " s with " << player.lander.fuel << " fuel";
+        else if (player.status == RACER_CRASHED) std::cout << "crashed after " << player.finish_step * RACE_STEP << " s";
+        else std::cout << "still flying";
+        std::cout << std::endl;
+    }
+}
+
+bool check_bandwidth(const LockstepServer& server, int players)
+{
+    bool within = true;
+    for (int i = 0; i < players; i++)
+    {
+        double rate = server.get_player_bytes_per_second(i);
+        std::cout << "Player " << i + 1 << " traffic: " << rate << " bytes a second, both ways" << std::endl;
+        within = within && rate < BANDWIDTH_BUDGET;
+    }
+    return within;
+}
+
+//  BOTS  //
+struct Bot
+{
+    LockstepClient client;
+    double next_step_ms = 0.0;
+    uint32_t submitted = 0;                     // inputs so far
+};
+
+// The bots' clocks tick at the game's step, and step whenever the input's there
+int run_bots(const Options& options, LockstepServer& server)
+{
+    std::string address = "127.0.0.1:" + std::to_string(options.port);
+    std::vector<std::unique_ptr<Bot>> bots;
+    for (int i = 0; i < options.bots; i++)
+    {
+        bots.emplace_back(new Bot());
+        if (!bots.back()->client.connect(address.c_str(), options.conditions, (uint32_t)i + 1)) return 1;
+        bots.back()->client.set_rollback(options.rollback);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&]() { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+    while (!server.is_finished() && server.get_seconds_running() < RACE_TIME_LIMIT)
+    {
+        server.poll();
+        for (std::unique_ptr<Bot>& bot : bots)
+        {
+            LockstepClient& client = bot->client;
+            client.poll();
+            if (!client.is_started())
+            {
+                bot->next_step_ms = elapsed_ms();
+                continue;
+            }
+
+            for (; bot->next_step_ms <= elapsed_ms(); bot->next_step_ms += STEP_MS)
+            {
+                const LanderState& lander = client.predict_player().lander;
+                const PhysicsParams& physics = client.get_settings().physics;
+                if (options.worst_case) client.submit(worst_case_pilot(lander, client.get_course(), client.get_player(), physics, bot->submitted++));
+                else client.submit(bot_pilot(lander, client.get_course(), client.get_player(), physics));
+
+                // Nothing's shown from the confirmed race then, so it takes everything that's in
+                if (client.is_rolling_back())
+                {
+                    while (client.can_step()) client.step();
+                    client.predict();
+                    continue;
+                }
+
+                if (!client.can_step())
+                {
+                    if (!race_finished(client.get_race())) client.count_stall();
+                    continue;
+                }
+
+                int steps = client.get_steps_ready() > LOCKSTEP_CATCH_UP ? 2 : 1;
+                for (int i = 0; i < steps && client.can_step(); i++) client.step();
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+    }
+
+    // Everyone has all the input by now, but may still be a few steps from playing it
+    for (double linger_end = elapsed_ms() + LINGER_MS; elapsed_ms() < linger_end;)
+    {
+        server.poll();
+        for (std::unique_ptr<Bot>& bot : bots)
+        {
+            bot->client.poll();
+            while (bot->client.can_step()) bot->client.step();
+            bot->client.predict();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+    }
+
+    print_results(server.get_race());
+
+    bool in_sync = server.get_desync_count() == 0;
+    uint32_t server_hash = race_hash(server.get_race());
+    for (int i = 0; i < options.bots; i++)
+    {
+        const LockstepClient& client = bots[i]->client;
+        bool same = race_hash(client.get_race()) == server_hash;
+        in_sync = in_sync && same && !client.is_desynced();
+
+        const NetStats& stats = client.get_net_stats();
+        std::cout << "Bot " << i + 1 << ": " << (same ? "same" : "DIFFERENT") << " final state, " << client.get_stalls() << " stalled steps, "
+            << stats.packets_sent << " packets sent (" << stats.packets_lost << " lost), " << stats.packets_received << " received" << std::endl;
+
+        if (!client.is_rolling_back()) continue;
+
+        // However wrong the guesses were along the way, the last rollback has to land on the real race
+        const RaceState& predicted = client.get_predicted();
+        const RaceState& race = client.get_race();
+        bool settled = memcmp(predicted.players, race.players, race.player_count * sizeof(RacePlayer)) == 0;
+        in_sync = in_sync && settled;
+
+        const RollbackStats& rollback = client.get_rollback_stats();
+        std::cout << "    " << rollback.rollbacks << " rollbacks, " << rollback.steps_replayed << " steps played again, at most "
+            << rollback.worst_replay << " at once; prediction " << (settled ? "settled on" : "DIFFERENT from") << " the race" << std::endl;
+    }
+
+    bool within_budget = check_bandwidth(server, options.bots);
+    std::cout << (in_sync ? "Everyone stayed in sync" : "Out of sync") << ", "
+        << (within_budget ? "within" : "over") << " the bandwidth budget" << std::endl;
+    return in_sync && within_budget ? 0 : 1;
+}
+
+//  ROLLBACK BENCHMARK  //
+/**
+ * The worst a rollback can cost a frame: put the race back the full
+ * LOCKSTEP_ROLLBACK_STEPS and play them all again. Timed at every step of a
+ * recorded race, for each number of players, since players are all a race's
+ * state grows with. Each step keeps its best time over the passes, so the worst
+ * of those is the work and not the scheduler; the slowest single run is shown too.
+ */
+void measure_rollback(const Options& options)
+{
+    RaceCourse course;
+    course.build(options.settings.seed);
+    const PhysicsParams& params = options.settings.physics;
+
+    std::cout << "Rolling back " << LOCKSTEP_ROLLBACK_STEPS << " steps, " << sizeof(RaceState) << " bytes of state. The course is shared"
+        " and never rolled back, so the only size that changes is the number of players." << std::endl;
+    for (int players = 1; players <= MAX_RACE_PLAYERS; players *= 2)
+    {
+        // The pilots fly it once, keeping every step's state and input to go back over
+        std::vector<RaceState> saved(BENCH_RACE_STEPS);
+        std::vector<std::array<uint8_t, MAX_RACE_PLAYERS>> inputs(BENCH_RACE_STEPS);
+        RaceState race;
+        race_start(race, course, players, options.settings.level);
+        int steps = 0;
+        for (; steps < BENCH_RACE_STEPS && !race_finished(race); steps++)
+        {
+            saved[steps] = race;
+            inputs[steps].fill(0);
+            for (int i = 0; i < players; i++) inputs[steps][i] = bot_pilot(race.players[i].lander, course, i, params);
+            race_step(race, course, inputs[steps].data(), params);
+        }
+
+        // A pilot that's down within a rollback's worth of steps leaves nothing to time
+        if (steps < LOCKSTEP_ROLLBACK_STEPS)
+        {
+            std::cout << players << " players, " << steps << " steps raced: too short to roll back " << LOCKSTEP_ROLLBACK_STEPS << " steps" << std::endl;
+            continue;
+        }
+
+        std::vector<double> best_us(steps, 1e9);
+        double total_us = 0.0;
+        double slowest_us = 0.0;
+        int rollbacks = 0;
+        uint32_t check = 0;     // so none of it can be optimised away
+        for (int pass = 0; pass < BENCH_PASSES; pass++)
+        {
+            for (int from = 0; from + LOCKSTEP_ROLLBACK_STEPS <= steps; from++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                race = saved[from];
+                for (int i = 0; i < LOCKSTEP_ROLLBACK_STEPS; i++) race_step(race, course, inputs[from + i].data(), params);
+                double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+                check += race.step;
+                total_us += us;
+                best_us[from] = std::min(best_us[from], us);
+                slowest_us = std::max(slowest_us, us);
+                rollbacks++;
+            }
+        }
+
+        double worst_us = 0.0;
+        for (int from = 0; from + LOCKSTEP_ROLLBACK_STEPS <= steps; from++) worst_us = std::max(worst_us, best_us[from]);
+
+        // Restoring alone is too quick to time once, so it's timed a lot of times over
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rollbacks; i++)
+        {
+            race = saved[i % steps];
+            check += race.players[0].status;
+        }
+        double restore_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rollbacks;
+
+        std::cout << players << " players, " << steps << " steps raced: restore " << restore_us << " us, restore and replay "
+            << total_us / rollbacks << " us on average, " << worst_us << " us at worst (" << 100.0 * worst_us / 1000.0 / FRAME_MS
+            << "% of a frame), slowest single run " << slowest_us << " us" << (check == 0 ? " " : "") << std::endl;
+    }
+}
+
+//  MAIN  //
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        if (flag == "--rollback-bench") { options.rollback_bench = true; continue; }
+        if (flag == "--worst-case") { options.worst_case = true; continue; }
+
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            std::cout << "Missing a value after " << flag << std::endl;
+            return false;
+        }
+
+        if (flag == "--port") options.port = (uint16_t)atoi(value);
+        else if (flag == "--players") options.settings.player_count = std::max(1, std::min(MAX_RACE_PLAYERS, atoi(value)));
+        else if (flag == "--seed") options.settings.seed = (uint32_t)strtoul(value, nullptr, 10);
+        else if (flag == "--delay") options.settings.input_delay = std::max(1, std::min(LOCKSTEP_WINDOW / 2 - 1, atoi(value)));
+        else if (flag == "--rollback") options.rollback = std::max(0, std::min(LOCKSTEP_WINDOW / 2, atoi(value)));
+        else if (flag == "--bots") options.bots = std::max(0, std::min(MAX_RACE_PLAYERS, atoi(value)));
+        else if (flag == "--latency") options.conditions.latency_ms = std::max(0, atoi(value));
+        else if (flag == "--jitter") options.conditions.jitter_ms = std::max(0, atoi(value));
+        else if (flag == "--loss") options.conditions.loss = (float)atof(value);
+        else
+        {
+            std::cout << "Unknown option " << flag << std::endl;
+            return false;
+        }
+        i++;
+    }
+
+    // Bots fill every seat
+    if (options.bots > 0) options.settings.player_count = options.bots;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cout << "Usage: Server [--port N] [--players N] [--seed N] [--delay STEPS]"
+            " [--bots N] [--rollback STEPS] [--latency MS] [--jitter MS] [--loss FRACTION] [--worst-case] [--rollback-bench]" << std::endl;
+        return 1;
+    }
+
+    if (options.rollback_bench)
+    {
+        measure_rollback(options);
+        return 0;
+    }
+
+    // The bad network goes on both ends, so a round trip gets it twice, like a real one
+    LockstepServer server;
+    if (!server.start(options.port, options.settings, options.conditions, 0x5eed)) return 1;
+
+    if (options.bots > 0) return run_bots(options, server);
+
+    while (!server.is_finished())
+    {
+        server.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+    }
+
+    print_results(server.get_race());
+    check_bandwidth(server, options.settings.player_count);
+    return 0;
+}
@@ -0,0 +1,544 @@
+/**
+ * Checks for the parts of the game that don't need a window or a context. Each
+ * test is a function that says what went wrong and returns false if it fails.
+ * With no arguments every test runs, otherwise only the ones named. The exit
+ * code is the number that failed.
+ */
+
+// Our own main, not SDL's
+#define SDL_MAIN_HANDLED
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "FrameArena.h"
+#include "RenderQueue.h"
+#include "Entity.h"
+#include "InputLayer.h"
+#include "Simulation.h"
+#include "FramePacer.h"
+#include "AABBTree.h"
+#include "ConvexHull.h"
+#include "ObjectPool.h"
+#include "Heightfield.h"
+#include "WorldStreamer.h"
+#include "ThreadPool.h"
+#include "Autopilot.h"
+#include "ParticleSystem.h"
+#include "SdfFont.h"
+#include "TextMesh.h"
+
+#ifndef LUNAR_TRACK_ALLOCATIONS
+#error The tests count heap allocations, so they need LUNAR_TRACK_ALLOCATIONS
+#endif
+
+//  CONSTANTS  //
+// Long enough for every buffer to have hit its peak size
+constexpr int ALLOCATION_WARMUP_FRAMES = 120;
+constexpr int ALLOCATION_TEST_FRAMES = 1000;
+
+// The test flight: 60 Hz frames, and a restart further along every so often so tiles keep streaming
+constexpr float ALLOCATION_FRAME_STEP = 1.0f / 60.0f;
+constexpr int ALLOCATION_RESTART_FRAMES = 100;
+constexpr float ALLOCATION_RESTART_TILES = 2.5f;
+constexpr int ALLOCATION_ENTITIES = 64;
+constexpr unsigned int ALLOCATION_SEED = 1969;
+
+// The made-up clock counts in nanoseconds, and every read of it takes one microsecond
+constexpr Uint64 FAKE_CLOCK_FREQUENCY = 1000000000;
+constexpr Uint64 FAKE_CLOCK_READ = 1000;
+constexpr Uint64 FAKE_DELAY_OVERSHOOT = 500000;     // SDL_Delay runs over by about this much
+constexpr Uint64 FAKE_LOADING = 2 * FAKE_CLOCK_FREQUENCY;
+constexpr Uint64 FAKE_REFRESH = FAKE_CLOCK_FREQUENCY / 120;
+constexpr int PACER_TEST_FRAMES = 240;
+constexpr float PACER_TOLERANCE_MS = 0.05f;
+
+// Samples off the vertices on purpose, across a couple of tiles
+constexpr int REBASE_SAMPLES = 200;
+constexpr float REBASE_FAR_X = 2.0e6f;
+constexpr float REBASE_TOLERANCE = 1e-3f;
+
+//  FRAME ALLOCATIONS  //
+/**
+ * A frame of play, everything but the GL side: the streamer following the ship,
+ * the autopilot planning on its pool, the flight model, ground contact and the
+ * broadphase around the ship, the exhaust, a HUD line built into a TextMesh, and
+ * the fuel readout formatted into the arena and turned into sprite commands.
+ * After warming up, none of it should reach operator new.
+ */
+bool test_frame_allocations()
+{
+    // Or the rest proves nothing
+    uint64_t before = get_allocation_count();
+    int* volatile probe = new int(0);   // volatile, so the compiler can't leave the new out
+    delete probe;
+    if (get_allocation_count() == before)
+    {
+        std::cout << "operator new isn't being counted" << std::endl;
+        return false;
+    }
+
+    FrameArena arena;
+    arena.init();
+    RenderQueue queue;
+    queue.init(nullptr, nullptr);   // never submitted, so nothing gets bound or drawn
+
+    ObjectPool<Entity> entities;
+    entities.init(ALLOCATION_ENTITIES);
+    AABBTree broadphase;
+    WorldStreamer world;
+    world.start(ALLOCATION_SEED, &entities, entities.create(), &broadphase, false);
+
+    ThreadPool pool;
+    pool.start();
+    PhysicsParams physics;
+    LevelParams level;
+    Autopilot autopilot;
+    autopilot.init(&pool, physics);
+    TerrainProfile profile;
+
+    ParticleSystem particles;
+    particles.init();
+
+    // Never loaded, so every glyph comes out empty, but the text still gets copied in and the mesh rebuilt
+    SdfFont font;
+    TextMesh speed_text;
+    speed_text.init();
+
+    Entity ship;
+    ship.set_scale(glm::vec3(0.5f, 0.5f, 1.0f));
+    glm::vec2 half_extents = glm::vec2(ship.get_half_extents());
+    LanderState state;
+
+    uint64_t warmed_up = 0;
+    int nearby = 0;
+    for (int frame = 0; frame < ALLOCATION_WARMUP_FRAMES + ALLOCATION_TEST_FRAMES; frame++)
+    {
+        if (frame == ALLOCATION_WARMUP_FRAMES) warmed_up = get_allocation_count();
+
+        // Back at the start height a few tiles on, loaded the way the game loads a level
+        if (frame % ALLOCATION_RESTART_FRAMES == 0)
+        {
+            float x = frame / ALLOCATION_RESTART_FRAMES * ALLOCATION_RESTART_TILES * TILE_WIDTH;
+            state = { glm::vec2(x, level.start_height), glm::vec2(level.start_drift, 0.0f), glm::vec2(0.0f), level.start_fuel };
+            world.prime(x);
+            autopilot.reset();
+        }
+
+        arena.begin_frame();
+        queue.begin_frame();
+        world.update(state.position.x);
+
+        profile.origin_x = state.position.x - TERRAIN_PROFILE_SAMPLES * TERRAIN_PROFILE_SPACING * 0.5f;
+        world.sample_ground(profile.origin_x, TERRAIN_PROFILE_SPACING, profile.heights, TERRAIN_PROFILE_SAMPLES);
+        AutopilotGoal goal = { world.nearest_landing_pad(state.position.x), LANDING_PAD_HALF_WIDTH, half_extents };
+        LanderControl control = autopilot.plan(state, profile, goal, ALLOCATION_FRAME_STEP);
+        step_lander(state, control, ALLOCATION_FRAME_STEP, physics);
+
+        ship.set_position(glm::vec3(state.position, 0.0f));
+        ship.set_movement(glm::vec3(state.movement, 0.0f));
+        ship.set_fuel(state.fuel);
+        ship.update(0.0f);
+
+        // Touching down ends a game, here the ship just carries on into the ground until the next restart
+        ContactManifold contact;
+        world.check_ground_contact(&ship, contact);
+        broadphase.query(ship.get_bounds(), [&nearby](int) { nearby++; return true; });
+
+        if (control.up || control.x != 0)
+        {
+            ParticleEmitter exhaust = { state.position - glm::vec2(0.0f, half_extents.y), glm::vec2(-control.x, -2.0f), 0.3f, 0.3f, 0.03f, 0.6f, 4.0f };
+            particles.emit(exhaust, 8);
+        }
+        particles.update(ALLOCATION_FRAME_STEP);
+
+        speed_text.set_text(font, arena.format("Speed: %.2f", glm::length(state.movement)), 0.5f, 0.05f, glm::vec2(-4.75f, 3.15f));
+        ship.display_fuel(queue, nullptr, arena, 0, 0.5f, 0.05f);
+        ship.draw_text(queue, nullptr, 0, "AUTOPILOT", 0.5f, 0.05f, glm::vec3(-4.5f, 2.9f, 0.0f));
+    }
+
+    uint64_t allocations = get_allocation_count() - warmed_up;
+    if (allocations != 0)
+    {
+        std::cout << allocations << " heap allocations over " << ALLOCATION_TEST_FRAMES << " frames after warming up" << std::endl;
+        return false;
+    }
+
+    if (arena.get_overflow_count() != 0 || queue.get_overflow_count() != 0)
+    {
+        std::cout << "The frame ran out of arena or queue space, so not all of it was done" << std::endl;
+        return false;
+    }
+
+    if (autopilot.get_last_rollouts() == 0 || particles.get_count() == 0 || speed_text.get_rebuild_count() < 2)
+    {
+        std::cout << "Parts of the frame never ran, so they weren't really tested" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//  INPUT STEPS  //
+SDL_Event key_event(bool pressed, Uint32 timestamp, SDL_Scancode scancode, bool repeat = false)
+{
+    SDL_Event event = {};
+    event.type = pressed ? SDL_KEYDOWN : SDL_KEYUP;
+    event.key.timestamp = timestamp;
+    event.key.repeat = repeat ? 1 : 0;
+    event.key.keysym.scancode = scancode;
+    return event;
+}
+
+SDL_Event gamepad_button_event(bool pressed, Uint32 timestamp, Uint8 button)
+{
+    SDL_Event event = {};
+    event.type = pressed ? SDL_CONTROLLERBUTTONDOWN : SDL_CONTROLLERBUTTONUP;
+    event.cbutton.timestamp = timestamp;
+    event.cbutton.button = button;
+    return event;
+}
+
+bool expect_buttons(const char* step, uint8_t buttons, uint8_t expected)
+{
+    if (buttons == expected) return true;
+    std::cout << step << ": buttons " << (int)buttons << ", expected " << (int)expected << std::endl;
+    return false;
+}
+
+// A press and release both inside one step still counts for that step, and only that one
+bool test_input_taps()
+{
+    InputLayer input;
+    input.handle_event(key_event(true, 20, SDL_SCANCODE_W));
+    input.handle_event(key_event(false, 25, SDL_SCANCODE_W));
+
+    return expect_buttons("step to 16", input.take_step(16), 0)
+        && expect_buttons("step to 33", input.take_step(33), INPUT_THRUST)
+        && expect_buttons("step to 50", input.take_step(50), 0);
+}
+
+// Each step gets what happened up to its end, and anything later waits for its own step
+bool test_input_split_across_steps()
+{
+    InputLayer input;
+    input.handle_event(key_event(true, 5, SDL_SCANCODE_A));
+    input.handle_event(key_event(false, 30, SDL_SCANCODE_A));
+    input.handle_event(key_event(true, 30, SDL_SCANCODE_D));
+    input.handle_event(key_event(true, 40, SDL_SCANCODE_W));
+
+    // One frame's worth of steps taken all at once, as a slow frame would
+    return expect_buttons("step to 16", input.take_step(16), INPUT_LEFT)
+        && expect_buttons("step to 33", input.take_step(33), INPUT_RIGHT)
+        && expect_buttons("step to 50", input.take_step(50), INPUT_RIGHT | INPUT_THRUST);
+}
+
+// Letting go on one device doesn't cancel the same button held on another, and key repeats change nothing
+bool test_input_sources()
+{
+    InputLayer input;
+    input.handle_event(key_event(true, 1, SDL_SCANCODE_W));
+    input.handle_event(gamepad_button_event(true, 2, SDL_CONTROLLER_BUTTON_A));
+    input.handle_event(gamepad_button_event(false, 3, SDL_CONTROLLER_BUTTON_A));
+    input.handle_event(key_event(true, 4, SDL_SCANCODE_W, true));
+
+    if (!expect_buttons("step to 16", input.take_step(16), INPUT_THRUST)) return false;
+
+    input.handle_event(key_event(false, 20, SDL_SCANCODE_W));
+    return expect_buttons("step to 33", input.take_step(33), 0);
+}
+
+// A full queue drops the change and counts it, and takes changes again once steps drain it
+bool test_input_drops()
+{
+    InputLayer input;
+
+    // Presses and releases of W, every one a change, until the queue's full
+    int queued = (int)INPUT_QUEUE_CAPACITY - 1;
+    for (int i = 0; i < queued; i++) input.handle_event(key_event(i % 2 == 0, 1, SDL_SCANCODE_W));
+    if (input.get_dropped_count() != 0)
+    {
+        std::cout << input.get_dropped_count() << " dropped before the queue was full" << std::endl;
+        return false;
+    }
+
+    // The last one queued was a press, so a release is a change with nowhere to go
+    input.handle_event(key_event(false, 2, SDL_SCANCODE_W));
+    if (input.get_dropped_count() != 1)
+    {
+        std::cout << input.get_dropped_count() << " dropped with the queue full, expected 1" << std::endl;
+        return false;
+    }
+
+    // Still held, since the release never made it
+    if (!expect_buttons("step to 16", input.take_step(16), INPUT_THRUST)) return false;
+
+    input.handle_event(key_event(false, 20, SDL_SCANCODE_W));
+    return expect_buttons("step to 33", input.take_step(33), 0) && input.get_dropped_count() == 1;
+}
+
+//  FRAME PACING  //
+// Time only moves when FramePacer reads it, sleeps, swaps, or a test says some work got done
+struct FakeClock
+{
+    Uint64 time = 0;
+    Uint64 refresh = 0;         // 0 for a swap that never blocks, otherwise vsync at this period
+    Uint64 reads = 0;
+    int interval = 0;
+};
+
+Uint64 fake_counter(void* user)
+{
+    FakeClock* clock = (FakeClock*)user;
+    clock->time += FAKE_CLOCK_READ;
+    clock->reads++;
+    return clock->time;
+}
+
+Uint64 fake_frequency(void*) { return FAKE_CLOCK_FREQUENCY; }
+
+void fake_delay(void* user, Uint32 ms)
+{
+    ((FakeClock*)user)->time += (Uint64)ms * 1000000 + FAKE_DELAY_OVERSHOOT;
+}
+
+// No adaptive vsync here, like plenty of drivers
+int fake_set_swap_interval(void* user, int interval)
+{
+    if (interval < 0) return -1;
+    ((FakeClock*)user)->interval = interval;
+    return 0;
+}
+
+void fake_swap(void* user, SDL_Window*)
+{
+    FakeClock* clock = (FakeClock*)user;
+    if (clock->refresh > 0) clock->time = (clock->time / clock->refresh + 1) * clock->refresh;
+}
+
+FrameClock fake_frame_clock(FakeClock& fake)
+{
+    FrameClock clock;
+    clock.user = &fake;
+    clock.counter = fake_counter;
+    clock.frequency = fake_frequency;
+    clock.delay = fake_delay;
+    clock.set_swap_interval = fake_set_swap_interval;
+    clock.swap = fake_swap;
+    return clock;
+}
+
+// Returns how many clock reads went on waiting, on average a frame
+float run_paced_frames(FramePacer& pacer, FakeClock& clock, float work_ms, float work_step_ms)
+{
+    Uint64 reads = clock.reads;
+    for (int frame = 0; frame < PACER_TEST_FRAMES; frame++)
+    {
+        pacer.wait_for_input();
+        clock.time += (Uint64)((work_ms + (frame % 7) * work_step_ms) * 1000000.0f);
+        pacer.present(nullptr);
+    }
+    return (float)(clock.reads - reads) / PACER_TEST_FRAMES;
+}
+
+// Frames as long as the target however long the work takes, mostly slept through rather than spun,
+// and none of them counting the loading
+bool test_pacer_limiter()
+{
+    FakeClock clock;
+    FramePacer pacer;
+    pacer.init(120, SWAP_OFF, false, fake_frame_clock(clock));
+    clock.time += FAKE_LOADING;     // the assets, between init() and the main loop
+    pacer.restart();
+
+    float target_ms = 1000.0f / 120;
+    pacer.wait_for_input();
+    pacer.present(nullptr);
+    if (pacer.get_stats().worst_ms > target_ms + PACER_TOLERANCE_MS)
+    {
+        std::cout << "The first frame took " << pacer.get_stats().worst_ms << " ms, loading and all" << std::endl;
+        return false;
+    }
+
+    float reads = run_paced_frames(pacer, clock, 2.0f, 0.3f);
+    FramePacerStats stats = pacer.get_stats();
+    if (std::abs(stats.mean_ms - target_ms) > PACER_TOLERANCE_MS || stats.worst_ms > target_ms + PACER_TOLERANCE_MS)
+    {
+        std::cout << "Frames took " << stats.mean_ms << " ms, worst " << stats.worst_ms << ", for a target of " << target_ms << std::endl;
+        return false;
+    }
+
+    // Whatever isn't slept gets spun, one read a microsecond
+    float spun_ms = reads * FAKE_CLOCK_READ * 1000.0f / FAKE_CLOCK_FREQUENCY;
+    float spin_limit_ms = (float)(FRAME_PACER_SPIN * 1000.0) + 1.0f;
+    if (spun_ms > spin_limit_ms)
+    {
+        std::cout << "Spun " << spun_ms << " ms a frame, more than " << spin_limit_ms << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// With vsync and no target, input gets read just a frame's work before the swap, and no refresh is missed
+bool test_pacer_just_in_time()
+{
+    FakeClock clock;
+    clock.refresh = FAKE_REFRESH;
+    FramePacer pacer;
+    pacer.init(0, SWAP_ADAPTIVE, true, fake_frame_clock(clock));
+    if (pacer.get_swap_mode() != SWAP_ON || clock.interval != 1)
+    {
+        std::cout << "Didn't fall back to plain vsync without adaptive" << std::endl;
+        return false;
+    }
+    run_paced_frames(pacer, clock, 2.0f, 0.0f);
+
+    // The ring only holds frames from after the warm-up by now
+    FramePacerStats stats = pacer.get_stats();
+    float refresh_ms = FAKE_REFRESH * 1000.0f / FAKE_CLOCK_FREQUENCY;
+    if (stats.worst_ms > refresh_ms + PACER_TOLERANCE_MS)
+    {
+        std::cout << "Missed a refresh: worst frame " << stats.worst_ms << " ms against " << refresh_ms << std::endl;
+        return false;
+    }
+
+    // Half a frame waiting to be read, then the work and the margin. Reading straight after
+    // the last swap would add the rest of the refresh on top.
+    float expected_ms = refresh_ms * 0.5f + 2.0f + (float)(JUST_IN_TIME_MARGIN * 1000.0);
+    if (std::abs(stats.input_to_photon_ms - expected_ms) > 0.5f)
+    {
+        std::cout << "Input to photon " << stats.input_to_photon_ms << " ms, expected about " << expected_ms << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//  WORLD REBASE  //
+/**
+ * Moving the origin under a loaded world leaves the ground where it was, and
+ * far out the ground still comes from the full world x, not a float's rounding
+ * of it.
+ */
+bool test_world_rebase()
+{
+    ObjectPool<Entity> entities;
+    entities.init(ALLOCATION_ENTITIES);
+    AABBTree broadphase;
+    WorldStreamer world;
+    world.start(ALLOCATION_SEED, &entities, entities.create(), &broadphase, false);
+
+    float x = WORLD_REBASE_DISTANCE + 0.5f * TILE_WIDTH;
+    world.prime(x);
+    float before[REBASE_SAMPLES];
+    world.sample_ground(x, TILE_SPACING * 0.37f, before, REBASE_SAMPLES);
+    float pad_before = world.nearest_landing_pad(x);
+
+    float shift = world.rebase(x);
+    x -= shift;
+    float after[REBASE_SAMPLES];
+    world.sample_ground(x, TILE_SPACING * 0.37f, after, REBASE_SAMPLES);
+    for (int i = 0; i < REBASE_SAMPLES; i++)
+    {
+        if (fabsf(after[i] - before[i]) > REBASE_TOLERANCE)
+        {
+            std::cout << "Ground moved from " << before[i] << " to " << after[i] << " at sample " << i << std::endl;
+            return false;
+        }
+    }
+    if (fabsf(world.nearest_landing_pad(x) - (pad_before - shift)) > REBASE_TOLERANCE)
+    {
+        std::cout << "Landing pad moved from " << pad_before - shift << " to " << world.nearest_landing_pad(x) << std::endl;
+        return false;
+    }
+
+    // A long way out, where a float step is coarser than the ground's. On the
+    // vertices this time, so the mesh and the heightfield agree exactly
+    world.rebase(REBASE_FAR_X);
+    x = 0.5f * TILE_WIDTH;
+    world.prime(x);
+    world.sample_ground(x, TILE_SPACING, after, REBASE_SAMPLES);
+    for (int i = 0; i < REBASE_SAMPLES; i++)
+    {
+        double world_x = world.get_origin_x() + x + i * TILE_SPACING;
+        float expected = terrain_height(ALLOCATION_SEED, world_x);
+        if (fabsf(after[i] - expected) > REBASE_TOLERANCE)
+        {
+            std::cout << "Ground at " << world_x << " is " << after[i] << ", expected " << expected << std::endl;
+            return false;
+        }
+    }
+    double pad = world.get_origin_x() + world.nearest_landing_pad(x);
+    double expected_pad = nearest_landing_pad(ALLOCATION_SEED, world.get_origin_x() + x);
+    if (fabs(pad - expected_pad) > REBASE_TOLERANCE)
+    {
+        std::cout << "Landing pad at " << pad << ", expected " << expected_pad << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//  BROADPHASE  //
+// Through several growths past the fixed part, everything comes back off in order
+bool test_aabb_stack_growth()
+{
+    AABBTreeStack stack;
+    int count = AABB_TREE_STACK_SIZE * 8 + 3;
+    for (int i = 0; i < count; i++) stack.push(i);
+
+    for (int i = count - 1; i >= 0; i--)
+    {
+        int node = stack.pop();
+        if (node != i)
+        {
+            std::cout << "Popped " << node << ", expected " << i << std::endl;
+            return false;
+        }
+    }
+    return stack.empty();
+}
+
+//  RUNNER  //
+struct Test
+{
+    const char* name;
+    bool (*run)();
+};
+
+constexpr Test TESTS[] = {
+    { "frame_allocations", test_frame_allocations },
+    { "input_taps", test_input_taps },
+    { "input_split_across_steps", test_input_split_across_steps },
+    { "input_sources", test_input_sources },
+    { "input_drops", test_input_drops },
+    { "pacer_limiter", test_pacer_limiter },
+    { "pacer_just_in_time", test_pacer_just_in_time },
+    { "world_rebase", test_world_rebase },
+    { "aabb_stack_growth", test_aabb_stack_growth },
+};
+
+bool is_named(const char* name, int argc, char* argv[])
+{
+    if (argc < 2) return true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+int main(int argc, char* argv[])
+{
+    int ran = 0, failed = 0;
+    for (const Test& test : TESTS)
+    {
+        if (!is_named(test.name, argc, argv)) continue;
+
+        bool passed = test.run();
+        std::cout << (passed ? "PASS " : "FAIL ") << test.name << std::endl;
+        ran++;
+        if (!passed) failed++;
+    }
+
+    std::cout << ran - failed << " of " << ran << " passed" << std::endl;
+    return failed;
+}
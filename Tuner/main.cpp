@@ -0,0 +1,777 @@
+/**
+ * Headless tuner for the physics and level numbers. A genetic search over
+ * PhysicsParams and LevelParams, where every candidate flies the same set of
+ * seeded episodes with a scripted pilot. A candidate scores well when the pilot
+ * lands about as often, and with about as much fuel left, as we're aiming for.
+ * The best few come out as INI files.
+ *
+ * Every (candidate, episode batch) pair is its own task on the thread pool and
+ * writes only to its own slot, so the search keeps every core busy.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "glm/geometric.hpp"
+#include "Simulation.h"
+#include "Heightfield.h"
+#include "ConvexHull.h"
+#include "ThreadPool.h"
+#include "AABBTree.h"
+#include "Autopilot.h"
+
+//  CONSTANTS  //
+constexpr int DEFAULT_POPULATION = 64,
+DEFAULT_GENERATIONS = 40,
+DEFAULT_EPISODES = 128,
+DEFAULT_TOP = 5;
+
+constexpr float DEFAULT_TARGET_SUCCESS = 0.7f,   // fraction of episodes the pilot should land
+DEFAULT_TARGET_FUEL = 0.25f;                    // fraction of the tank left after a landing
+
+constexpr float FUEL_ERROR_WEIGHT = 0.5f;
+
+constexpr int EPISODES_PER_TASK = 8;
+constexpr float EPISODE_STEP = 1.0f / 60.0f;     // same as a frame in the game
+constexpr float EPISODE_TIME_LIMIT = 60.0f;
+constexpr float EPISODE_START_RANGE = 200.0f;    // episodes start anywhere in [-range, range]
+
+// Each episode's ground is tabled this far either side of the start, and flying off the end counts as a miss
+constexpr float EPISODE_GROUND_REACH = 32.0f;
+constexpr float EPISODE_GROUND_SPACING = 0.05f;
+constexpr int EPISODE_GROUND_SAMPLES = (int)(2.0f * EPISODE_GROUND_REACH / EPISODE_GROUND_SPACING) + 1;
+
+// The broadphase benchmark: bodies the size of an asteroid, about as crowded as the
+// asteroid field, drifting up to this far a frame
+constexpr int BROADPHASE_BODY_COUNTS[] = { 100, 1000, 10000 };
+constexpr int BROADPHASE_FRAMES = 60;
+constexpr float BROADPHASE_BODIES_PER_AREA = 0.05f;
+constexpr float BROADPHASE_HALF_SIZE = 0.25f;
+constexpr float BROADPHASE_MAX_SPEED = 0.05f;
+
+// The autopilot benchmark flies the first few episodes with the real planner, a
+// frame at a time, and expects it to land nearly all of them inside its budget
+constexpr int AUTOPILOT_BENCH_EPISODES = 16;
+constexpr float AUTOPILOT_BENCH_MIN_LANDINGS = 0.9f;
+constexpr float AUTOPILOT_BENCH_PERCENTILE = 0.99f;   // of plans that have to come in under the budget
+
+// The ship is drawn at 0.5 x 0.5
+constexpr float SHIP_HALF_WIDTH = 0.25f,
+SHIP_HALF_HEIGHT = 0.25f;
+
+constexpr int ELITE_COUNT = 2;          // carried over unchanged every generation
+constexpr int TOURNAMENT_SIZE = 3;
+constexpr float MUTATION_RATE = 0.3f;   // chance each gene gets nudged
+constexpr float MUTATION_SCALE = 0.1f;  // of the gene's range
+
+//  PARAMETER SPACE  //
+struct Gene
+{
+    const char* section;
+    const char* name;
+    float min;
+    float max;
+};
+
+// Order matters, it's the layout of a genome
+constexpr Gene GENES[] = {
+    { "physics", "gravity",            -1.5f, -0.1f },
+    { "physics", "speed",               1.5f,  5.0f },
+    { "physics", "acceleration_decay",  0.9f,  1.0f },
+    { "physics", "side_thrust",         0.5f,  3.0f },
+    { "physics", "up_thrust",           0.5f,  3.0f },
+    { "physics", "idle_vertical",      -1.0f,  0.0f },
+    { "physics", "fuel_burn",           1.0f, 10.0f },
+    { "level",   "start_fuel",         40.0f, 150.0f },
+    { "level",   "start_height",        0.0f,  4.0f },
+    { "level",   "start_drift",        -0.5f,  0.5f },
+};
+constexpr int GENE_COUNT = sizeof(GENES) / sizeof(GENES[0]);
+
+struct Genome
+{
+    float genes[GENE_COUNT];
+};
+
+PhysicsParams to_physics(const Genome& genome)
+{
+    PhysicsParams params;
+    params.gravity = genome.genes[0];
+    params.speed = genome.genes[1];
+    params.acceleration_decay = genome.genes[2];
+    params.side_thrust = genome.genes[3];
+    params.up_thrust = genome.genes[4];
+    params.idle_vertical = genome.genes[5];
+    params.fuel_burn = genome.genes[6];
+    return params;
+}
+
+LevelParams to_level(const Genome& genome)
+{
+    LevelParams level;
+    level.start_fuel = genome.genes[7];
+    level.start_height = genome.genes[8];
+    level.start_drift = genome.genes[9];
+    return level;
+}
+
+// Where the search starts from: the game as it ships
+Genome default_genome()
+{
+    PhysicsParams params;
+    LevelParams level;
+    return { {
+        params.gravity, params.speed, params.acceleration_decay, params.side_thrust, params.up_thrust,
+        params.idle_vertical, params.fuel_burn, level.start_fuel, level.start_height, level.start_drift
+    } };
+}
+
+//  RANDOM  //
+uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// xorshift32, only ever used from the main thread
+struct Random
+{
+    uint32_t state;
+
+    float unit()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+
+    float normal() { return (unit() + unit() + unit() + unit() - 2.0f) * 1.7320508f; }
+    int below(int n) { return std::min(n - 1, (int)(unit() * n)); }
+};
+
+//  EPISODES  //
+struct EpisodeResult
+{
+    bool landed;
+    float fuel_left;  // fraction of the starting tank
+};
+
+/**
+ * Everything about an episode that doesn't depend on the numbers being tuned.
+ * The noise behind the terrain is far too slow to call every step of every
+ * rollout, so each episode's ground is tabled once up front and shared read-only.
+ */
+struct Episode
+{
+    float start_x;
+    float pad_x;
+    std::vector<float> ground;  // highest point under the ship's width, EPISODE_GROUND_SPACING apart
+
+    float origin_x() const { return start_x - EPISODE_GROUND_REACH; }
+    bool in_range(float x) const { return fabsf(x - start_x) < EPISODE_GROUND_REACH; }
+
+    float ground_at(float x) const
+    {
+        float t = std::max(0.0f, (x - origin_x()) / EPISODE_GROUND_SPACING);
+        int i = std::min((int)t, EPISODE_GROUND_SAMPLES - 2);
+        return ground[i] + (ground[i + 1] - ground[i]) * (t - i);
+    }
+};
+
+struct EpisodeSet
+{
+    uint32_t seed;
+    std::vector<Episode> episodes;
+};
+
+void build_episode(void* context, int index)
+{
+    EpisodeSet* set = static_cast<EpisodeSet*>(context);
+    Episode& episode = set->episodes[index];
+
+    uint32_t episode_seed = set->seed + (uint32_t)index;
+    uint32_t terrain_seed = hash(episode_seed);
+    episode.start_x = (hash(episode_seed ^ 0x9e3779b9u) / 4294967295.0f * 2.0f - 1.0f) * EPISODE_START_RANGE;
+    episode.pad_x = (float)nearest_landing_pad(terrain_seed, episode.start_x);
+
+    // Highest of the ground under the middle and both edges of the ship
+    episode.ground.resize(EPISODE_GROUND_SAMPLES);
+    for (int i = 0; i < EPISODE_GROUND_SAMPLES; i++)
+    {
+        double x = episode.origin_x() + (double)i * EPISODE_GROUND_SPACING;
+        episode.ground[i] = std::max(terrain_height(terrain_seed, x),
+            std::max(terrain_height(terrain_seed, x - SHIP_HALF_WIDTH), terrain_height(terrain_seed, x + SHIP_HALF_WIDTH)));
+    }
+}
+
+/**
+ * A deliberately plain pilot: steer for the nearest pad, and brake the descent
+ * harder the closer the ground gets. It's a yardstick for how forgiving a set of
+ * numbers is, not something that should land every time.
+ */
+LanderControl scripted_pilot(const LanderState& state, float pad_x, float ground, const PhysicsParams& params)
+{
+    LanderControl control;
+
+    glm::vec2 velocity = state.movement * params.speed;
+    float to_pad = pad_x - state.position.x;
+    float altitude = state.position.y - SHIP_HALF_HEIGHT - ground;
+
+    float wanted_vx = std::max(-1.5f, std::min(1.5f, to_pad * 0.8f));
+    if (velocity.x < wanted_vx - 0.1f) control.x = 1;
+    else if (velocity.x > wanted_vx + 0.1f) control.x = -1;
+
+    // Over the pad, come straight down; elsewhere, hold some height to get there
+    float wanted_vy = fabsf(to_pad) < LANDING_PAD_HALF_WIDTH ? -std::max(0.4f, altitude * 0.6f) : (altitude < 1.0f ? 0.3f : -0.2f);
+    control.up = velocity.y < wanted_vy;
+
+    return control;
+}
+
+EpisodeResult run_episode(const PhysicsParams& params, const LevelParams& level, const Episode& episode)
+{
+    LanderState state;
+    state.position = glm::vec2(episode.start_x, level.start_height);
+    state.movement = glm::vec2(level.start_drift, 0.0f);
+    state.acceleration = glm::vec2(0.0f);
+    state.fuel = level.start_fuel;
+
+    // The ground here can be above where the level says to start, so start clear of it
+    state.position.y = std::max(state.position.y, episode.ground_at(episode.start_x) + SHIP_HALF_HEIGHT + 0.5f);
+
+    for (float time = 0.0f; time < EPISODE_TIME_LIMIT; time += EPISODE_STEP)
+    {
+        step_lander(state, scripted_pilot(state, episode.pad_x, episode.ground_at(state.position.x), params), EPISODE_STEP, params);
+        if (!episode.in_range(state.position.x)) break;
+
+        if (state.position.y - SHIP_HALF_HEIGHT > episode.ground_at(state.position.x)) continue;
+
+        // Touched down, the same verdict the game gives
+        float speed = glm::length(state.movement * params.speed);
+        bool on_pad = fabsf(state.position.x - episode.pad_x) <= LANDING_PAD_HALF_WIDTH - SHIP_HALF_WIDTH;
+        return { on_pad && speed <= SOFT_LANDING_MAX_SPEED, level.start_fuel > 0.0f ? state.fuel / level.start_fuel : 0.0f };
+    }
+
+    return { false, 0.0f };
+}
+
+//  EVALUATION  //
+// One per task, padded out to its own cache line so no two threads ever write the same one
+struct alignas(64) BatchResult
+{
+    int landed;
+    float fuel_left;
+};
+
+struct Evaluation
+{
+    const Genome* population;
+    int population_size;
+    const Episode* episodes;
+    int episode_count;
+    int batches_per_genome;
+    BatchResult* results;
+};
+
+void evaluate_batch(void* context, int task)
+{
+    Evaluation* evaluation = static_cast<Evaluation*>(context);
+    int genome = task / evaluation->batches_per_genome;
+    int first = (task % evaluation->batches_per_genome) * EPISODES_PER_TASK;
+    int last = std::min(first + EPISODES_PER_TASK, evaluation->episode_count);
+
+    PhysicsParams params = to_physics(evaluation->population[genome]);
+    LevelParams level = to_level(evaluation->population[genome]);
+
+    // Every genome sees the same episodes, so they're compared on equal terms
+    BatchResult result = { 0, 0.0f };
+    for (int episode = first; episode < last; episode++)
+    {
+        EpisodeResult outcome = run_episode(params, level, evaluation->episodes[episode]);
+        if (!outcome.landed) continue;
+
+        result.landed++;
+        result.fuel_left += outcome.fuel_left;
+    }
+
+    evaluation->results[task] = result;
+}
+
+struct Score
+{
+    float fitness;        // higher is better, 0 is a perfect match for the targets
+    float success_rate;
+    float fuel_left;      // average over the landings
+};
+
+struct Options
+{
+    int population = DEFAULT_POPULATION;
+    int generations = DEFAULT_GENERATIONS;
+    int episodes = DEFAULT_EPISODES;
+    int threads = 0;
+    int top = DEFAULT_TOP;
+    uint32_t seed = 1969;
+    float target_success = DEFAULT_TARGET_SUCCESS;
+    float target_fuel = DEFAULT_TARGET_FUEL;
+    std::string output_dir = ".";
+    bool scaling = false;
+    bool broadphase_bench = false;
+    bool autopilot_bench = false;
+};
+
+void evaluate(ThreadPool& pool, const Options& options, const EpisodeSet& episodes, const std::vector<Genome>& population,
+    std::vector<BatchResult>& results, std::vector<Score>& scores)
+{
+    Evaluation evaluation;
+    evaluation.population = population.data();
+    evaluation.population_size = (int)population.size();
+    evaluation.episodes = episodes.episodes.data();
+    evaluation.episode_count = (int)episodes.episodes.size();
+    evaluation.batches_per_genome = (evaluation.episode_count + EPISODES_PER_TASK - 1) / EPISODES_PER_TASK;
+
+    results.resize(population.size() * evaluation.batches_per_genome);
+    evaluation.results = results.data();
+
+    pool.run((int)results.size(), evaluate_batch, &evaluation);
+
+    scores.resize(population.size());
+    for (int genome = 0; genome < (int)population.size(); genome++)
+    {
+        int landed = 0;
+        float fuel_left = 0.0f;
+        for (int batch = 0; batch < evaluation.batches_per_genome; batch++)
+        {
+            landed += results[genome * evaluation.batches_per_genome + batch].landed;
+            fuel_left += results[genome * evaluation.batches_per_genome + batch].fuel_left;
+        }
+
+        Score& score = scores[genome];
+        score.success_rate = (float)landed / options.episodes;
+        score.fuel_left = landed > 0 ? fuel_left / landed : 0.0f;
+
+        float success_error = score.success_rate - options.target_success;
+        float fuel_error = score.fuel_left - options.target_fuel;
+        score.fitness = -(success_error * success_error + FUEL_ERROR_WEIGHT * fuel_error * fuel_error);
+    }
+}
+
+//  SEARCH  //
+const Genome& tournament(const std::vector<Genome>& population, const std::vector<Score>& scores, Random& random)
+{
+    int best = random.below((int)population.size());
+    for (int i = 1; i < TOURNAMENT_SIZE; i++)
+    {
+        int challenger = random.below((int)population.size());
+        if (scores[challenger].fitness > scores[best].fitness) best = challenger;
+    }
+    return population[best];
+}
+
+Genome breed(const Genome& a, const Genome& b, Random& random)
+{
+    Genome child;
+    for (int gene = 0; gene < GENE_COUNT; gene++)
+    {
+        // Somewhere on the line between the parents, and a little past either end
+        float t = random.unit() * 1.5f - 0.25f;
+        float value = a.genes[gene] + (b.genes[gene] - a.genes[gene]) * t;
+
+        float range = GENES[gene].max - GENES[gene].min;
+        if (random.unit() < MUTATION_RATE) value += random.normal() * MUTATION_SCALE * range;
+
+        child.genes[gene] = std::min(GENES[gene].max, std::max(GENES[gene].min, value));
+    }
+    return child;
+}
+
+std::vector<int> ranked(const std::vector<Score>& scores)
+{
+    std::vector<int> order(scores.size());
+    for (int i = 0; i < (int)order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return scores[a].fitness > scores[b].fitness; });
+    return order;
+}
+
+bool write_config(const std::string& path, const Genome& genome, const Score& score, const Options& options)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "Could not write " << path << std::endl;
+        return false;
+    }
+
+    file << "; Tuned for " << options.target_success << " landings and " << options.target_fuel << " fuel left over "
+        << options.episodes << " episodes from seed " << options.seed << "\n";
+    file << "; Got " << score.success_rate << " landings and " << score.fuel_left << " fuel left\n";
+
+    const char* section = nullptr;
+    for (int gene = 0; gene < GENE_COUNT; gene++)
+    {
+        if (section == nullptr || strcmp(section, GENES[gene].section) != 0)
+        {
+            section = GENES[gene].section;
+            file << "\n[" << section << "]\n";
+        }
+        file << GENES[gene].name << " = " << genome.genes[gene] << "\n";
+    }
+
+    return true;
+}
+
+// Same work on 1, 2, 4... threads, to check the search really does scale
+void measure_scaling(const Options& options, const EpisodeSet& episodes, const std::vector<Genome>& population)
+{
+    int hardware = (int)std::thread::hardware_concurrency();
+    std::vector<BatchResult> results;
+    std::vector<Score> scores;
+    double single_ms = 0.0;
+
+    for (int threads = 1; threads <= hardware; threads = threads * 2 > hardware && threads != hardware ? hardware : threads * 2)
+    {
+        ThreadPool pool;
+        if (threads > 1) pool.start(threads - 1);
+
+        auto start = std::chrono::steady_clock::now();
+        evaluate(pool, options, episodes, population, results, scores);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (threads == 1) single_ms = ms;
+
+        std::cout << threads << " threads: " << ms << " ms, " << single_ms / ms << "x" << std::endl;
+        pool.stop();
+    }
+}
+
+//  BROADPHASE BENCHMARK  //
+struct BroadphaseBody
+{
+    glm::vec2 centre;
+    glm::vec2 velocity;
+    int proxy;
+
+    AABB box() const { return { centre - BROADPHASE_HALF_SIZE, centre + BROADPHASE_HALF_SIZE }; }
+};
+
+/**
+ * Every body moves every frame, then looks for what it touches, the way the game
+ * treats asteroids and the ship. The tree's update (move_proxy) and its queries are
+ * timed on their own, next to checking every pair. Both have to find the same
+ * overlapping pairs, or the tree's missing some.
+ */
+bool measure_broadphase(uint32_t seed)
+{
+    bool matched = true;
+    for (int count : BROADPHASE_BODY_COUNTS)
+    {
+        Random random = { seed * 2654435761u + (uint32_t)count };
+        float side = sqrtf(count / BROADPHASE_BODIES_PER_AREA);
+
+        std::vector<BroadphaseBody> bodies(count);
+        AABBTree tree;
+        for (int i = 0; i < count; i++)
+        {
+            BroadphaseBody& body = bodies[i];
+            body.centre = glm::vec2(random.unit(), random.unit()) * side;
+            body.velocity = (glm::vec2(random.unit(), random.unit()) * 2.0f - 1.0f) * BROADPHASE_MAX_SPEED;
+            body.proxy = tree.create_proxy(body.box(), (void*)(intptr_t)i);
+        }
+
+        double update_ms = 0.0, query_ms = 0.0, brute_ms = 0.0;
+        long long tree_pairs = 0, brute_pairs = 0, reinserted = 0;
+
+        for (int frame = 0; frame < BROADPHASE_FRAMES; frame++)
+        {
+            // Bouncing off the edges keeps the crowd the same all the way through
+            for (BroadphaseBody& body : bodies)
+            {
+                body.centre += body.velocity;
+                for (int axis = 0; axis < 2; axis++)
+                {
+                    if (body.centre[axis] < 0.0f || body.centre[axis] > side) body.velocity[axis] = -body.velocity[axis];
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            for (const BroadphaseBody& body : bodies)
+            {
+                if (tree.move_proxy(body.proxy, body.box(), body.velocity)) reinserted++;
+            }
+            auto updated = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < count; i++)
+            {
+                AABB box = bodies[i].box();
+                tree.query(box, [&](int proxy) {
+                    int other = (int)(intptr_t)tree.get_user_data(proxy);
+                    if (other > i && bodies[other].box().overlaps(box)) tree_pairs++;
+                    return true;
+                });
+            }
+            auto queried = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < count; i++)
+            {
+                AABB box = bodies[i].box();
+                for (int other = i + 1; other < count; other++)
+                {
+                    if (bodies[other].box().overlaps(box)) brute_pairs++;
+                }
+            }
+            auto checked = std::chrono::steady_clock::now();
+
+            update_ms += std::chrono::duration<double, std::milli>(updated - start).count();
+            query_ms += std::chrono::duration<double, std::milli>(queried - updated).count();
+            brute_ms += std::chrono::duration<double, std::milli>(checked - queried).count();
+        }
+
+        std::cout << count << " bodies: update " << update_ms / BROADPHASE_FRAMES << " ms a frame ("
+            << (double)reinserted / BROADPHASE_FRAMES << " re-inserted), queries " << query_ms / BROADPHASE_FRAMES
+            << " ms, every pair " << brute_ms / BROADPHASE_FRAMES << " ms, tree height " << tree.get_height() << std::endl;
+
+        if (tree_pairs != brute_pairs)
+        {
+            std::cout << "The tree found " << tree_pairs << " overlapping pairs but there were " << brute_pairs << std::endl;
+            matched = false;
+        }
+    }
+    return matched;
+}
+
+//  AUTOPILOT BENCHMARK  //
+/**
+ * The game's autopilot flying an episode the way the game runs it: a plan a
+ * frame on a thread pool, on a profile of the real ground around the ship. The
+ * verdict is the same one run_episode() gives the scripted pilot. Every plan's
+ * time goes into plan_ms.
+ */
+EpisodeResult fly_autopilot(Autopilot& autopilot, const Episode& episode, uint32_t terrain_seed, std::vector<float>& plan_ms)
+{
+    PhysicsParams params;
+    LevelParams level;
+
+    LanderState state;
+    state.position = glm::vec2(episode.start_x, std::max(level.start_height, episode.ground_at(episode.start_x) + SHIP_HALF_HEIGHT + 0.5f));
+    state.movement = glm::vec2(level.start_drift, 0.0f);
+    state.acceleration = glm::vec2(0.0f);
+    state.fuel = level.start_fuel;
+
+    AutopilotGoal goal;
+    goal.pad_x = episode.pad_x;
+    goal.pad_half_width = LANDING_PAD_HALF_WIDTH;
+    goal.ship_half_extents = glm::vec2(SHIP_HALF_WIDTH, SHIP_HALF_HEIGHT);
+
+    TerrainProfile profile;
+    autopilot.reset();
+
+    for (float time = 0.0f; time < EPISODE_TIME_LIMIT; time += EPISODE_STEP)
+    {
+        // Straight from the noise, which is what the streamer does for ground it hasn't loaded
+        profile.origin_x = state.position.x - TERRAIN_PROFILE_SAMPLES * TERRAIN_PROFILE_SPACING * 0.5f;
+        for (int i = 0; i < TERRAIN_PROFILE_SAMPLES; i++)
+        {
+            profile.heights[i] = terrain_height(terrain_seed, (double)profile.origin_x + (double)i * TERRAIN_PROFILE_SPACING);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        LanderControl control = autopilot.plan(state, profile, goal, EPISODE_STEP);
+        plan_ms.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        step_lander(state, control, EPISODE_STEP, params);
+        if (!episode.in_range(state.position.x)) break;
+        if (state.position.y - SHIP_HALF_HEIGHT > episode.ground_at(state.position.x)) continue;
+
+        float speed = glm::length(state.movement * params.speed);
+        bool on_pad = fabsf(state.position.x - episode.pad_x) <= LANDING_PAD_HALF_WIDTH - SHIP_HALF_WIDTH;
+        return { on_pad && speed <= SOFT_LANDING_MAX_SPEED, level.start_fuel > 0.0f ? state.fuel / level.start_fuel : 0.0f };
+    }
+
+    return { false, 0.0f };
+}
+
+// Fails if too few episodes land, or too many plans run over AUTOPILOT_BUDGET_MS
+bool measure_autopilot(const EpisodeSet& episodes, ThreadPool& pool)
+{
+    Autopilot autopilot;
+    autopilot.init(&pool, PhysicsParams());
+
+    std::vector<float> plan_ms;
+    int count = std::min(AUTOPILOT_BENCH_EPISODES, (int)episodes.episodes.size());
+    int landed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        size_t first_plan = plan_ms.size();
+        EpisodeResult outcome = fly_autopilot(autopilot, episodes.episodes[i], hash(episodes.seed + (uint32_t)i), plan_ms);
+        if (outcome.landed) landed++;
+
+        float seconds = (plan_ms.size() - first_plan) * EPISODE_STEP;
+        std::cout << "Episode " << i << ": " << (outcome.landed ? "landed" : "missed") << " after " << seconds << " s";
+        if (outcome.landed) std::cout << " with " << outcome.fuel_left * 100.0f << "% of the fuel left";
+        std::cout << std::endl;
+    }
+
+    if (plan_ms.empty())
+    {
+        std::cout << "No episodes to fly the autopilot on" << std::endl;
+        return false;
+    }
+
+    std::sort(plan_ms.begin(), plan_ms.end());
+    double total_ms = 0.0;
+    for (float ms : plan_ms) total_ms += ms;
+    float percentile_ms = plan_ms[std::min(plan_ms.size() - 1, (size_t)(plan_ms.size() * AUTOPILOT_BENCH_PERCENTILE))];
+    float landing_rate = (float)landed / count;
+
+    std::cout << landed << " of " << count << " landed, on " << pool.get_thread_count() << " threads" << std::endl;
+    std::cout << plan_ms.size() << " plans: " << total_ms / plan_ms.size() << " ms on average, " << percentile_ms << " ms at the "
+        << AUTOPILOT_BENCH_PERCENTILE * 100.0f << "th percentile, " << plan_ms.back() << " ms at worst, against a budget of "
+        << AUTOPILOT_BUDGET_MS << " ms" << std::endl;
+
+    bool passed = true;
+    if (landing_rate < AUTOPILOT_BENCH_MIN_LANDINGS)
+    {
+        std::cout << "Fewer than " << AUTOPILOT_BENCH_MIN_LANDINGS * 100.0f << "% of the episodes landed" << std::endl;
+        passed = false;
+    }
+    if (percentile_ms > AUTOPILOT_BUDGET_MS)
+    {
+        std::cout << "Planning ran over its budget too often" << std::endl;
+        passed = false;
+    }
+    return passed;
+}
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (flag == "--scaling") { options.scaling = true; continue; }
+        if (flag == "--broadphase-bench") { options.broadphase_bench = true; continue; }
+        if (flag == "--autopilot-bench") { options.autopilot_bench = true; continue; }
+        if (value == nullptr)
+        {
+            std::cout << "Missing a value after " << flag << std::endl;
+            return false;
+        }
+
+        if (flag == "--population") options.population = std::max(ELITE_COUNT + 1, atoi(value));
+        else if (flag == "--generations") options.generations = std::max(1, atoi(value));
+        else if (flag == "--episodes") options.episodes = std::max(1, atoi(value));
+        else if (flag == "--threads") options.threads = atoi(value);
+        else if (flag == "--top") options.top = std::max(1, atoi(value));
+        else if (flag == "--seed") options.seed = (uint32_t)strtoul(value, nullptr, 10);
+        else if (flag == "--target-success") options.target_success = (float)atof(value);
+        else if (flag == "--target-fuel") options.target_fuel = (float)atof(value);
+        else if (flag == "--out") options.output_dir = value;
+        else
+        {
+            std::cout << "Unknown option " << flag << std::endl;
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cout << "Usage: Tuner [--population N] [--generations N] [--episodes N] [--threads N] [--top N] [--seed N]"
+            " [--target-success F] [--target-fuel F] [--out DIR] [--scaling] [--broadphase-bench] [--autopilot-bench]" << std::endl;
+        return 1;
+    }
+
+    if (options.broadphase_bench) return measure_broadphase(options.seed) ? 0 : 1;
+
+    // The shipped numbers, plus a population scattered across the whole range
+    Random random = { options.seed * 2654435761u + 1u };
+    std::vector<Genome> population(options.population);
+    population[0] = default_genome();
+    for (int i = 1; i < options.population; i++)
+    {
+        for (int gene = 0; gene < GENE_COUNT; gene++)
+        {
+            population[i].genes[gene] = GENES[gene].min + random.unit() * (GENES[gene].max - GENES[gene].min);
+        }
+    }
+
+    // 0 threads means one per core, counting this one
+    ThreadPool pool;
+    if (options.threads != 1) pool.start(options.threads > 0 ? options.threads - 1 : 0);
+
+    EpisodeSet episodes;
+    episodes.seed = options.seed;
+    episodes.episodes.resize(options.episodes);
+    pool.run(options.episodes, build_episode, &episodes);
+
+    if (options.autopilot_bench)
+    {
+        bool passed = measure_autopilot(episodes, pool);
+        pool.stop();
+        return passed ? 0 : 1;
+    }
+
+    if (options.scaling)
+    {
+        pool.stop();
+        measure_scaling(options, episodes, population);
+        return 0;
+    }
+
+    std::cout << "Tuning on " << pool.get_thread_count() << " threads" << std::endl;
+
+    std::vector<BatchResult> results;
+    std::vector<Score> scores;
+    std::vector<Genome> next(options.population);
+    auto start = std::chrono::steady_clock::now();
+
+    for (int generation = 0; generation < options.generations; generation++)
+    {
+        evaluate(pool, options, episodes, population, results, scores);
+        std::vector<int> order = ranked(scores);
+
+        const Score& best = scores[order[0]];
+        std::cout << "Generation " << generation << ": fitness " << best.fitness << ", landed " << best.success_rate
+            << ", fuel left " << best.fuel_left << std::endl;
+
+        if (generation == options.generations - 1) break;
+
+        for (int i = 0; i < ELITE_COUNT; i++) next[i] = population[order[i]];
+        for (int i = ELITE_COUNT; i < options.population; i++)
+        {
+            next[i] = breed(tournament(population, scores, random), tournament(population, scores, random), random);
+        }
+        std::swap(population, next);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long long episode_runs = (long long)options.generations * options.population * options.episodes;
+    std::cout << episode_runs << " episodes in " << seconds << " s" << std::endl;
+
+    std::vector<int> order = ranked(scores);
+    for (int rank = 0; rank < std::min(options.top, options.population); rank++)
+    {
+        std::string path = options.output_dir + "/tuned_" + std::to_string(rank) + ".ini";
+        if (write_config(path, population[order[rank]], scores[order[rank]], options)) std::cout << "Wrote " << path << std::endl;
+    }
+
+    pool.stop();
+    return 0;
+}